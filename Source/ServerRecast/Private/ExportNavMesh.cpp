@@ -4,10 +4,29 @@
 #include "Navmesh/RecastHelpers.h"
 #include "Runtime/Core/Public/GenericPlatform/GenericPlatform.h"
 #include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
+#include "Navmesh/PImplRecastNavMesh.h"
 #include "Runtime/Engine/Classes/Kismet/KismetMathLibrary.h"
 #include "NavigationSystem.h"
 #include "NavMesh/RecastNavMeshGenerator.h"
 #include "NavigationOctree.h"
+#include "ServerRecastGeometryFile.h"
+#include "Async/ParallelFor.h"
+#include "ServerRecastVertexTransform.h"
+#include "Hash/CityHash.h"
+#include "ServerRecastVertexWeld.h"
+#include "ServerRecastNavMeshBuilder.h"
+#include "ServerRecastTileCache.h"
+#include "ServerRecastTilePack.h"
+#include "ServerRecastTileGraph.h"
+#include "ServerRecastStreamWriter.h"
+#include "Async/Async.h"
+#include "ServerRecastStats.h"
+#include "HAL/FileManager.h"
+#include "LandscapeHeightfieldCollisionComponent.h"
+#include "LandscapeDataAccess.h"
+#if WITH_PHYSX
+#include "PhysXIncludes.h"
+#endif
 
 
 FServerRecastGeometryCache::FServerRecastGeometryCache(const uint8* Memory)
@@ -17,159 +36,276 @@ FServerRecastGeometryCache::FServerRecastGeometryCache(const uint8* Memory)
 	Indices = (int32*)(Memory + sizeof(FServerRecastGeometryCache) + (sizeof(float) * Header.NumVerts * 3));
 }
 
-void FExportNavMesh::MyExportNavigationData(const FString& FileName)
+bool FExportNavMesh::ExportWorld(UWorld* World, const FString& FileName, const FServerRecastExportOptions& Options)
+{
+	UNavigationSystemV1* NavSys = World ? Cast<UNavigationSystemV1>(World->GetNavigationSystem()) : nullptr;
+	if (NavSys == nullptr)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to export navigation data, world has no navigation system"));
+		return false;
+	}
+
+	NavSys->GetAbstractNavData();
+	ANavigationData* NavData = NavSys->GetDefaultNavDataInstance(FNavigationSystem::ECreateIfEmpty::Create);
+	if (NavData == nullptr || NavData->GetGenerator() == nullptr)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to export navigation data, no navmesh generator in %s"), *World->GetMapName());
+		return false;
+	}
+
+	FExportNavMesh* Exporter = static_cast<FExportNavMesh*>(NavData->GetGenerator());
+	return Exporter->MyExportNavigationData(FileName, Options);
+}
+
+class ARecastNavMeshTrick : public ARecastNavMesh { public: const FPImplRecastNavMesh* GetRecastNavMeshImplTrick() const { return GetRecastNavMeshImpl(); } };
+
+bool FExportNavMesh::ExportBuiltNavMesh(UWorld* World, const FString& NavMeshFileName, bool bWriteTilePack)
+{
+	UNavigationSystemV1* NavSys = World ? Cast<UNavigationSystemV1>(World->GetNavigationSystem()) : nullptr;
+	if (NavSys == nullptr)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to save built navmesh, world has no navigation system"));
+		return false;
+	}
+
+	// half built navmesh would miss tiles silently
+	if (NavSys->IsNavigationBuildInProgress())
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to save built navmesh of %s, navigation build is still running"), *World->GetMapName());
+		return false;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	int32 NumSaved = 0;
+	bool bSuccess = true;
+	for (int32 Index = 0; Index < NavSys->NavDataSet.Num(); ++Index)
+	{
+		const ARecastNavMeshTrick* NavData = static_cast<const ARecastNavMeshTrick*>(Cast<const ARecastNavMesh>(NavSys->NavDataSet[Index]));
+		const FPImplRecastNavMesh* NavMeshImpl = NavData ? NavData->GetRecastNavMeshImplTrick() : nullptr;
+		const dtNavMesh* DetourNavMesh = NavMeshImpl ? NavMeshImpl->DetourNavMesh : nullptr;
+		if (DetourNavMesh == nullptr || NavData->GetNavMeshTilesCount() == 0)
+		{
+			if (NavData)
+			{
+				UE_LOG(LogNavigation, Warning, TEXT("%s has no built tiles, build paths in the editor first"), *NavData->GetName());
+			}
+			continue;
+		}
+
+		// tiles don't come from the exporter, incremental export must not patch them with its own
+		const FString FileName = GetAgentNavMeshFileName(NavMeshFileName, Index);
+		IFileManager::Get().Delete(*FServerRecastNavMeshBuilder::GetBuildKeyFileName(FileName), false, false, true);
+		if (FServerRecastNavMeshBuilder::SaveNavMeshSet(*DetourNavMesh, FileName) &&
+			(!bWriteTilePack || ServerRecastTilePack::Save(*DetourNavMesh, FPaths::ChangeExtension(FileName, TEXT("navpack")))))
+		{
+			++NumSaved;
+		}
+		else
+		{
+			bSuccess = false;
+		}
+	}
+
+	UE_LOG(LogNavigation, Log, TEXT("ServerRecast: saved built navmesh of %d agents in %.3f sec"), NumSaved, FPlatformTime::Seconds() - StartTime);
+	return bSuccess && NumSaved > 0;
+}
+
+FString FExportNavMesh::GetAgentNavMeshFileName(const FString& NavMeshFileName, int32 NavDataIndex)
+{
+	return NavMeshFileName + (NavDataIndex > 0 ? FString::Printf(TEXT("_NavDataSet%d"), NavDataIndex) : FString()) + TEXT(".navmesh");
+}
+
+TSharedPtr<FServerRecastAsyncExport, ESPMode::ThreadSafe> FExportNavMesh::ExportWorldAsync(UWorld* World, const FString& FileName, const FServerRecastExportOptions& Options, const FServerRecastAsyncExport::FOnCompleted& OnCompleted, bool* bOutUpToDate)
+{
+	check(IsInGameThread());
+
+	if (bOutUpToDate)
+	{
+		*bOutUpToDate = false;
+	}
+
+	UNavigationSystemV1* NavSys = World ? Cast<UNavigationSystemV1>(World->GetNavigationSystem()) : nullptr;
+	ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::ECreateIfEmpty::Create) : nullptr;
+	if (NavData == nullptr || NavData->GetGenerator() == nullptr)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to export navigation data, no navmesh generator in %s"), World ? *World->GetMapName() : TEXT("null world"));
+		return nullptr;
+	}
+
+	TSharedPtr<FServerRecastAsyncExport, ESPMode::ThreadSafe> Export = MakeShareable(new FServerRecastAsyncExport());
+	Export->OnCompleted = OnCompleted;
+
+	FExportNavMesh* Exporter = static_cast<FExportNavMesh*>(NavData->GetGenerator());
+	if (!Exporter->GatherExportJob(FileName, Options, Export->Job))
+	{
+		return nullptr;
+	}
+	if (Export->Job.Agents.Num() == 0)
+	{
+		// without incremental export no agents means no recast navmesh at all
+		if (bOutUpToDate)
+		{
+			*bOutUpToDate = Options.bIncrementalExport;
+		}
+		return nullptr;
+	}
+
+	// export owns its job, world may go away or change while it runs
+	Export->Result = Async<bool>(EAsyncExecution::Thread, [Export]()
+		{
+			const bool bSuccess = RunExportJob(Export->Job, &Export->Progress);
+			const bool bCancelled = Export->Progress.IsCancelled();
+
+			// snapshot references navigation data shared with the game thread, release it there
+			AsyncTask(ENamedThreads::GameThread, [Export, bSuccess, bCancelled]()
+				{
+					Export->Job.Agents.Empty();
+					Export->Job.Snapshot = FServerRecastGatherSnapshot();
+					Export->OnCompleted.ExecuteIfBound(bSuccess, bCancelled);
+				});
+			return bSuccess;
+		});
+
+	return Export;
+}
+
+bool FExportNavMesh::GatherExportJob(const FString& FileName, const FServerRecastExportOptions& Options, FServerRecastExportJob& OutJob)
 {
 	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
 	const FNavigationOctree* NavOctree = NavSys ? NavSys->GetNavOctree() : NULL;
 	if (NavOctree == NULL)
 	{
 		UE_LOG(LogNavigation, Error, TEXT("Failed to export navigation data due to %s being NULL"), NavSys == NULL ? TEXT("NavigationSystem") : TEXT("NavOctree"));
-		return;
+		return false;
 	}
 
-	const double StartExportTime = FPlatformTime::Seconds();
+	OutJob.Options = Options;
+	OutJob.Snapshot = FServerRecastGatherSnapshot();
+	OutJob.Agents.Reset();
+	OutJob.Report = FServerRecastExportReport();
+	OutJob.Report.MapName = GetWorld() ? GetWorld()->GetMapName() : FString();
+	OutJob.ReportFileName = Options.bWriteExportReport ? FileName + TEXT(".report.json") : FString();
+
+	// geometry selection doesn't depend on agent, one gather serves all of them and covers dirty tiles of every incremental agent
+	TArray<const ARecastNavMesh*> AgentNavData;
+	bool bGatherAll = false;
+	FBox DirtyQueryBounds(ForceInit);
 
 	FString CurrentTimeStr = FDateTime::Now().ToString();
 	for (int32 Index = 0; Index < NavSys->NavDataSet.Num(); ++Index)
 	{
-		// feed data from octtree and mark for rebuild				
-		TNavStatArray<float> CoordBuffer;
-		TNavStatArray<int32> IndexBuffer;
 		const ARecastNavMesh* NavData = Cast<const ARecastNavMesh>(NavSys->NavDataSet[Index]);
 		if (NavData)
 		{
-			struct FAreaExportData
+			const FRecastNavMeshGenerator* CurrentGen = static_cast<const FRecastNavMeshGenerator*>(NavData->GetGenerator());
+			check(CurrentGen);
+
+			TUniquePtr<FServerRecastAgentExportJob> AgentJob = MakeUnique<FServerRecastAgentExportJob>();
+			FServerRecastAgentExportJob& Agent = *AgentJob;
+			Agent.NavDataName = NavData->GetName();
+			Agent.Config = CurrentGen->GetConfig();
+			Agent.RecastBounds = Unreal2RecastBox(TotalNavBounds);
+			Agent.InclusionBounds.Append(InclusionBounds.GetData(), InclusionBounds.Num());
+			Agent.FileBaseName = FileName + FString::Printf(TEXT("_NavDataSet%d_%s"), Index, *CurrentTimeStr);
+			Agent.NavMeshFileName = Options.NavMeshFileName.IsEmpty() ? FString() : GetAgentNavMeshFileName(Options.NavMeshFileName, Index);
+			Agent.BuildKey = FServerRecastNavMeshBuilder::GetBuildKey(Agent.Config, Agent.RecastBounds, Agent.InclusionBounds);
+			Agent.bIncremental = Options.bIncrementalExport && !Agent.NavMeshFileName.IsEmpty() && FPaths::FileExists(Agent.NavMeshFileName);
+			// settings or bounds volumes changed since the saved navmesh was built, dirty actors don't cover that
+			if (Agent.bIncremental && FServerRecastNavMeshBuilder::LoadBuildKey(Agent.NavMeshFileName) != Agent.BuildKey)
 			{
-				FConvexNavAreaData Convex;
-				uint8 AreaId;
-			};
-			TArray<FAreaExportData> AreaExport;
+				UE_LOG(LogNavigation, Log, TEXT("%s was built with other settings or navigation bounds, doing full build"), *Agent.NavMeshFileName);
+				Agent.bIncremental = false;
+			}
+			// dirty tiles are few, incremental export keeps using in-memory buffers
+			Agent.bTiled = Options.bTiledGeometryFile && !Agent.bIncremental;
 
-			NavOctree->FindElementsWithBoundsTest(TotalNavBounds, [this, NavData, &IndexBuffer, &CoordBuffer, &AreaExport](const FNavigationOctreeElement& Element)
+			// incremental export needs only geometry touching dirty tiles, bordered tile bounds are gathered
+			if (Agent.bIncremental)
+			{
+				const FServerRecastTileGrid Grid(Agent.Config, Agent.RecastBounds);
+				for (const FBox& Bounds : Options.DirtyBounds)
 				{
-					const bool bExportGeometry = Element.Data->HasGeometry() && Element.ShouldUseGeometry(DestNavMesh->GetConfig());
-
-					TArray<FTransform> InstanceTransforms;
-					Element.Data->NavDataPerInstanceTransformDelegate.ExecuteIfBound(Element.Bounds.GetBox(), InstanceTransforms);
-
-					if (bExportGeometry && Element.Data->CollisionData.Num())
+					FIntPoint MinTile, MaxTile;
+					if (Grid.IsValid() && Grid.GetTileRange(Unreal2RecastBox(Bounds), MinTile, MaxTile))
 					{
-						const int32 NumInstances = FMath::Max(InstanceTransforms.Num(), 1);
-						FServerRecastGeometryCache CachedGeometry(Element.Data->CollisionData.GetData());
-						IndexBuffer.Reserve(IndexBuffer.Num() + (CachedGeometry.Header.NumFaces * 3) * NumInstances);
-						CoordBuffer.Reserve(CoordBuffer.Num() + (CachedGeometry.Header.NumVerts * 3) * NumInstances);
-
-						if (InstanceTransforms.Num() == 0)
+						for (int32 TileY = MinTile.Y; TileY <= MaxTile.Y; ++TileY)
 						{
-							for (int32 i = 0; i < CachedGeometry.Header.NumFaces * 3; i++)
-							{
-								IndexBuffer.Add(CachedGeometry.Indices[i] + CoordBuffer.Num() / 3);
-							}
-							for (int32 i = 0; i < CachedGeometry.Header.NumVerts * 3; i++)
-							{
-								CoordBuffer.Add(CachedGeometry.Verts[i]);
-							}
-						}
-						for (const FTransform& InstanceTransform : InstanceTransforms)
-						{
-							for (int32 i = 0; i < CachedGeometry.Header.NumFaces * 3; i++)
-							{
-								IndexBuffer.Add(CachedGeometry.Indices[i] + CoordBuffer.Num() / 3);
-							}
-
-							FMatrix LocalToRecastWorld = InstanceTransform.ToMatrixWithScale() * Unreal2RecastMatrix();
-
-							for (int32 i = 0; i < CachedGeometry.Header.NumVerts * 3; i += 3)
+							for (int32 TileX = MinTile.X; TileX <= MaxTile.X; ++TileX)
 							{
-								// collision cache stores coordinates in recast space, convert them to unreal and transform to recast world space
-								FVector WorldRecastCoord = LocalToRecastWorld.TransformPosition(Recast2UnrealPoint(&CachedGeometry.Verts[i]));
-
-								CoordBuffer.Add(WorldRecastCoord.X);
-								CoordBuffer.Add(WorldRecastCoord.Y);
-								CoordBuffer.Add(WorldRecastCoord.Z);
+								Agent.DirtyTiles.AddUnique(FIntPoint(TileX, TileY));
+								DirtyQueryBounds += Recast2UnrealBox(Grid.GetTileBounds(TileX, TileY, true));
 							}
 						}
 					}
-					else
-					{
-						for (const FAreaNavModifier& AreaMod : Element.Data->Modifiers.GetAreas())
-						{
-							ENavigationShapeType::Type ShapeType = AreaMod.GetShapeType();
-
-							if (ShapeType == ENavigationShapeType::Convex || ShapeType == ENavigationShapeType::InstancedConvex)
-							{
-								FAreaExportData ExportInfo;
-								ExportInfo.AreaId = NavData->GetAreaID(AreaMod.GetAreaClass());
-
-								auto AddAreaExportDataFunc = [&](const FConvexNavAreaData& InConvexNavAreaData)
-								{
-									TArray<FVector> ConvexVerts;
-									GrowConvexHull(NavData->AgentRadius, ExportInfo.Convex.Points, ConvexVerts);
-									if (ConvexVerts.Num())
-									{
-										ExportInfo.Convex.MinZ -= NavData->CellHeight;
-										ExportInfo.Convex.MaxZ += NavData->CellHeight;
-										ExportInfo.Convex.Points = ConvexVerts;
-
-										AreaExport.Add(ExportInfo);
-									}
-								};
-
-								if (ShapeType == ENavigationShapeType::Convex)
-								{
-									AreaMod.GetConvex(ExportInfo.Convex);
-									AddAreaExportDataFunc(ExportInfo.Convex);
-								}
-								else // ShapeType == ENavigationShapeType::InstancedConvex
-								{
-									for (const FTransform& InstanceTransform : InstanceTransforms)
-									{
-										AreaMod.GetPerInstanceConvex(InstanceTransform, ExportInfo.Convex);
-										AddAreaExportDataFunc(ExportInfo.Convex);
-									}
-								}
-							}
-						}
-					}
-				});
-
-			UWorld* NavigationWorld = GetWorld();
-			for (int32 LevelIndex = 0; LevelIndex < NavigationWorld->GetNumLevels(); ++LevelIndex)
-			{
-				const ULevel* const Level = NavigationWorld->GetLevel(LevelIndex);
-				if (Level == NULL)
-				{
-					continue;
 				}
 
-				const TArray<FVector>* LevelGeom = Level->GetStaticNavigableGeometry();
-				if (LevelGeom != NULL && LevelGeom->Num() > 0)
+				if (Agent.DirtyTiles.Num() == 0)
 				{
-					TNavStatArray<FVector> Verts;
-					TNavStatArray<int32> Faces;
-					// For every ULevel in World take its pre-generated static geometry vertex soup
-					TransformVertexSoupToRecast(*LevelGeom, Verts, Faces); //RecastGeometryExport
-
-					IndexBuffer.Reserve(IndexBuffer.Num() + Faces.Num());
-					CoordBuffer.Reserve(CoordBuffer.Num() + Verts.Num() * 3);
-					for (int32 i = 0; i < Faces.Num(); i++)
-					{
-						IndexBuffer.Add(Faces[i] + CoordBuffer.Num() / 3);
-					}
-					for (int32 i = 0; i < Verts.Num(); i++)
-					{
-						CoordBuffer.Add(Verts[i].X);
-						CoordBuffer.Add(Verts[i].Y);
-						CoordBuffer.Add(Verts[i].Z);
-					}
+					UE_LOG(LogNavigation, Log, TEXT("%s is up to date"), *Agent.NavMeshFileName);
+					continue;
 				}
 			}
+			else
+			{
+				bGatherAll = true;
+			}
+
+			AgentNavData.Add(NavData);
+			OutJob.Agents.Add(MoveTemp(AgentJob));
+		}
+	}
+
+	if (OutJob.Agents.Num() == 0)
+	{
+		return true;
+	}
+
+	// feed data from octtree, the snapshot holds references to collision data so it can be used after octree changes
+	{
+		SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_Gather, OutJob.Report.GatherTime);
+		GatherExportSnapshot(Options, OutJob.Snapshot, bGatherAll ? nullptr : &DirtyQueryBounds);
+	}
+
+	const FServerRecastGatherSnapshot& Snapshot = OutJob.Snapshot;
+	FServerRecastExportReport& Report = OutJob.Report;
+	Report.NumElements = Snapshot.Elements.Num();
+	Report.NumLevelGeometry = Snapshot.LevelGeometry.Num();
+	Report.NumPrototypes = Snapshot.Prototypes.Num();
+	Report.NumInstances = Snapshot.Instances.Num();
+	Report.NumAreas = Snapshot.AreaSources.Num();
+	Report.NumHeightfields = Snapshot.Heightfields.Num();
+	Report.NumHeightfieldSamples = Snapshot.HeightfieldSamples.Num();
+	Report.NumTris = Snapshot.NumIndices / 3;
+	for (const FServerRecastGeometryFileInstance& Instance : Snapshot.Instances)
+	{
+		Report.NumInstanceTris += Snapshot.Prototypes[Instance.PrototypeIndex].NumTris;
+	}
+	Report.Agents.SetNum(OutJob.Agents.Num());
+
+	for (int32 AgentIndex = 0; AgentIndex < OutJob.Agents.Num(); ++AgentIndex)
+	{
+		const ARecastNavMesh* NavData = AgentNavData[AgentIndex];
+		FServerRecastAgentExportJob& Agent = *OutJob.Agents[AgentIndex];
 
+		FServerRecastAgentExportReport& AgentReport = Report.Agents[AgentIndex];
+		AgentReport.NavDataName = Agent.NavDataName;
+		AgentReport.bIncremental = Agent.bIncremental;
+		AgentReport.bTiled = Agent.bTiled;
 
+		// area convexes are grown by agent radius and tagged with agent's area ids
+		{
+			SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_AreaGrow, Report.AreaGrowTime);
+			BuildAgentAreas(NavData, OutJob.Snapshot, Agent.AreaExport);
+		}
+
+		// partial geometry is only good for the tile rebuild
+		if (Options.bExportDebugOBJ && !Agent.bIncremental && !Agent.bTiled)
+		{
+			const TArray<FServerRecastAreaExportData>& AreaExport = Agent.AreaExport;
 			FString AreaExportStr;
 			for (int32 i = 0; i < AreaExport.Num(); i++)
 			{
-				const FAreaExportData& ExportInfo = AreaExport[i];
+				const FServerRecastAreaExportData& ExportInfo = AreaExport[i];
 				AreaExportStr += FString::Printf(TEXT("\nAE %d %d %f %f\n"),
 					ExportInfo.AreaId, ExportInfo.Convex.Points.Num(), ExportInfo.Convex.MinZ, ExportInfo.Convex.MaxZ);
 
@@ -180,16 +316,14 @@ void FExportNavMesh::MyExportNavigationData(const FString& FileName)
 				}
 			}
 
-			FString AdditionalData;
-
 			if (AreaExport.Num())
 			{
-				AdditionalData += "# Area export\n";
-				AdditionalData += AreaExportStr;
-				AdditionalData += "\n";
+				Agent.OBJAdditionalData += "# Area export\n";
+				Agent.OBJAdditionalData += AreaExportStr;
+				Agent.OBJAdditionalData += "\n";
 			}
 
-			AdditionalData += "# RecastDemo specific data\n";
+			Agent.OBJAdditionalData += "# RecastDemo specific data\n";
 #if 0
 			// use this bounds to have accurate navigation data bounds
 			const FVector Center = Unreal2RecastPoint(NavData->GetBounds().GetCenter());
@@ -202,55 +336,397 @@ void FExportNavMesh::MyExportNavigationData(const FString& FileName)
 			const FVector Extent = RCNavBounds.GetExtent();
 #endif
 			const FBox Box = FBox::BuildAABB(Center, Extent);
-			AdditionalData += FString::Printf(
+			Agent.OBJAdditionalData += FString::Printf(
 				TEXT("rd_bbox %7.7f %7.7f %7.7f %7.7f %7.7f %7.7f\n"),
 				Box.Min.X, Box.Min.Y, Box.Min.Z,
 				Box.Max.X, Box.Max.Y, Box.Max.Z
 			);
 
-			const FRecastNavMeshGenerator* CurrentGen = static_cast<const FRecastNavMeshGenerator*>(NavData->GetGenerator());
-			check(CurrentGen);
-			AdditionalData += FString::Printf(TEXT("# AgentHeight\n"));
-			AdditionalData += FString::Printf(TEXT("rd_agh %5.5f\n"), CurrentGen->GetConfig().AgentHeight);
-			AdditionalData += FString::Printf(TEXT("# AgentRadius\n"));
-			AdditionalData += FString::Printf(TEXT("rd_agr %5.5f\n"), CurrentGen->GetConfig().AgentRadius);
-
-			AdditionalData += FString::Printf(TEXT("# Cell Size\n"));
-			AdditionalData += FString::Printf(TEXT("rd_cs %5.5f\n"), CurrentGen->GetConfig().cs);
-			AdditionalData += FString::Printf(TEXT("# Cell Height\n"));
-			AdditionalData += FString::Printf(TEXT("rd_ch %5.5f\n"), CurrentGen->GetConfig().ch);
-
-			AdditionalData += FString::Printf(TEXT("# Agent max climb\n"));
-			AdditionalData += FString::Printf(TEXT("rd_amc %d\n"), (int)CurrentGen->GetConfig().AgentMaxClimb);
-			AdditionalData += FString::Printf(TEXT("# Agent max slope\n"));
-			AdditionalData += FString::Printf(TEXT("rd_ams %5.5f\n"), CurrentGen->GetConfig().walkableSlopeAngle);
-
-			AdditionalData += FString::Printf(TEXT("# Region min size\n"));
-			AdditionalData += FString::Printf(TEXT("rd_rmis %d\n"), (uint32)FMath::Sqrt(CurrentGen->GetConfig().minRegionArea));
-			AdditionalData += FString::Printf(TEXT("# Region merge size\n"));
-			AdditionalData += FString::Printf(TEXT("rd_rmas %d\n"), (uint32)FMath::Sqrt(CurrentGen->GetConfig().mergeRegionArea));
-
-			AdditionalData += FString::Printf(TEXT("# Max edge len\n"));
-			AdditionalData += FString::Printf(TEXT("rd_mel %d\n"), CurrentGen->GetConfig().maxEdgeLen);
-
-			AdditionalData += FString::Printf(TEXT("# Perform Voxel Filtering\n"));
-			AdditionalData += FString::Printf(TEXT("rd_pvf %d\n"), CurrentGen->GetConfig().bPerformVoxelFiltering);
-			AdditionalData += FString::Printf(TEXT("# Generate Detailed Mesh\n"));
-			AdditionalData += FString::Printf(TEXT("rd_gdm %d\n"), CurrentGen->GetConfig().bGenerateDetailedMesh);
-			AdditionalData += FString::Printf(TEXT("# MaxPolysPerTile\n"));
-			AdditionalData += FString::Printf(TEXT("rd_mppt %d\n"), CurrentGen->GetConfig().MaxPolysPerTile);
-			AdditionalData += FString::Printf(TEXT("# maxVertsPerPoly\n"));
-			AdditionalData += FString::Printf(TEXT("rd_mvpp %d\n"), CurrentGen->GetConfig().maxVertsPerPoly);
-			AdditionalData += FString::Printf(TEXT("# Tile size\n"));
-			AdditionalData += FString::Printf(TEXT("rd_ts %d\n"), CurrentGen->GetConfig().tileSize);
-
-			AdditionalData += FString::Printf(TEXT("\n"));
-
-			const FString FilePathName = FileName + FString::Printf(TEXT("_NavDataSet%d_%s.obj"), Index, *CurrentTimeStr);
-			ExportGeomToOBJFile(FilePathName, CoordBuffer, IndexBuffer, AdditionalData);
-		}
-	}
-	UE_LOG(LogNavigation, Log, TEXT("ExportNavigation time: %.3f sec ."), FPlatformTime::Seconds() - StartExportTime);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# AgentHeight\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_agh %5.5f\n"), Agent.Config.AgentHeight);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# AgentRadius\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_agr %5.5f\n"), Agent.Config.AgentRadius);
+
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Cell Size\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_cs %5.5f\n"), Agent.Config.cs);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Cell Height\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_ch %5.5f\n"), Agent.Config.ch);
+
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Agent max climb\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_amc %d\n"), (int)Agent.Config.AgentMaxClimb);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Agent max slope\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_ams %5.5f\n"), Agent.Config.walkableSlopeAngle);
+
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Region min size\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_rmis %d\n"), (uint32)FMath::Sqrt(Agent.Config.minRegionArea));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Region merge size\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_rmas %d\n"), (uint32)FMath::Sqrt(Agent.Config.mergeRegionArea));
+
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Max edge len\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_mel %d\n"), Agent.Config.maxEdgeLen);
+
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Perform Voxel Filtering\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_pvf %d\n"), Agent.Config.bPerformVoxelFiltering);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Generate Detailed Mesh\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_gdm %d\n"), Agent.Config.bGenerateDetailedMesh);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# MaxPolysPerTile\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_mppt %d\n"), Agent.Config.MaxPolysPerTile);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# maxVertsPerPoly\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_mvpp %d\n"), Agent.Config.maxVertsPerPoly);
+			Agent.OBJAdditionalData += FString::Printf(TEXT("# Tile size\n"));
+			Agent.OBJAdditionalData += FString::Printf(TEXT("rd_ts %d\n"), Agent.Config.tileSize);
+
+			Agent.OBJAdditionalData += FString::Printf(TEXT("\n"));
+		}
+	}
+
+	return true;
+}
+
+bool FExportNavMesh::RunExportJob(FServerRecastExportJob& Job, FServerRecastExportProgress* Progress)
+{
+	const FServerRecastExportOptions& Options = Job.Options;
+	const FServerRecastGatherSnapshot& Snapshot = Job.Snapshot;
+	FServerRecastExportReport& Report = Job.Report;
+
+	const double StartExportTime = FPlatformTime::Seconds();
+	ServerRecastStats::ResetGeometryBufferPeak();
+
+	// geometry is expanded once, every agent culls its own copy of indices
+	TNavStatArray<float> CoordBuffer;
+	TNavStatArray<int32> IndexBuffer;
+	const bool bNeedsBuffers = Job.Agents.ContainsByPredicate([](const TUniquePtr<FServerRecastAgentExportJob>& Agent) { return !Agent->bTiled; });
+	if (bNeedsBuffers)
+	{
+		{
+			SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_GeometryBuffers, Report.GeometryBuffersTime);
+			BuildGeometryBuffers(Snapshot, CoordBuffer, IndexBuffer);
+		}
+		Report.GeometryBufferBytes = CoordBuffer.GetAllocatedSize() + IndexBuffer.GetAllocatedSize();
+		ServerRecastStats::AddGeometryBufferMemory(Report.GeometryBufferBytes);
+
+		if (Progress)
+		{
+			Progress->AddTris(IndexBuffer.Num() / 3);
+		}
+	}
+
+	bool bSuccess = true;
+	if (Job.Agents.Num() == 1)
+	{
+		bSuccess = RunAgentExport(Options, Snapshot, *Job.Agents[0], CoordBuffer, IndexBuffer, Progress, Report.Agents[0]);
+	}
+	else
+	{
+		// concurrent agents split the workers, otherwise each builder would spawn one per core
+		const int32 NumAgents = Job.Agents.Num();
+		const int32 NumWorkers = Options.NumBuildWorkers > 0 ? Options.NumBuildWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+		TArray<FServerRecastExportOptions> AgentOptions;
+		AgentOptions.Init(Options, NumAgents);
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			AgentOptions[AgentIndex].NumBuildWorkers = FMath::Max(1, NumWorkers / NumAgents + (AgentIndex < NumWorkers % NumAgents ? 1 : 0));
+		}
+
+		// agents share nothing mutable, each one waits on its own pool tasks so they run on dedicated threads
+		TArray<TFuture<bool>> AgentResults;
+		for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+		{
+			const FServerRecastExportOptions* AgentOption = &AgentOptions[AgentIndex];
+			const FServerRecastAgentExportJob* Agent = Job.Agents[AgentIndex].Get();
+			FServerRecastAgentExportReport* AgentReport = &Report.Agents[AgentIndex];
+			AgentResults.Add(Async<bool>(EAsyncExecution::Thread, [AgentOption, &Snapshot, Agent, &CoordBuffer, &IndexBuffer, Progress, AgentReport]()
+				{
+					return RunAgentExport(*AgentOption, Snapshot, *Agent, CoordBuffer, IndexBuffer, Progress, *AgentReport);
+				}));
+		}
+
+		for (TFuture<bool>& AgentResult : AgentResults)
+		{
+			bSuccess &= AgentResult.Get();
+		}
+	}
+
+	ServerRecastStats::AddGeometryBufferMemory(-Report.GeometryBufferBytes);
+
+	const double RunTime = FPlatformTime::Seconds() - StartExportTime;
+	Report.bCancelled = Progress && Progress->IsCancelled();
+	Report.bSuccess = bSuccess && !Report.bCancelled;
+	Report.GeometryBufferPeakBytes = ServerRecastStats::GetGeometryBufferPeak();
+	Report.TotalTime = Report.GatherTime + Report.AreaGrowTime + RunTime;
+	Report.Log();
+	if (!Job.ReportFileName.IsEmpty())
+	{
+		Report.Save(Job.ReportFileName);
+	}
+
+	if (Report.bCancelled)
+	{
+		UE_LOG(LogNavigation, Log, TEXT("ExportNavigation cancelled after %.3f sec"), RunTime);
+		return false;
+	}
+	UE_LOG(LogNavigation, Log, TEXT("ExportNavigation time: %.3f sec ."), RunTime);
+	return bSuccess;
+}
+
+bool FExportNavMesh::RunAgentExport(const FServerRecastExportOptions& Options, const FServerRecastGatherSnapshot& Snapshot, const FServerRecastAgentExportJob& Agent,
+	const TNavStatArray<float>& SharedCoords, const TNavStatArray<int32>& SharedIndices, FServerRecastExportProgress* Progress, FServerRecastAgentExportReport& OutReport)
+{
+	auto IsCancelled = [Progress]() { return Progress && Progress->IsCancelled(); };
+	if (IsCancelled())
+	{
+		return false;
+	}
+
+	bool bSuccess = true;
+	const double StartAgentTime = FPlatformTime::Seconds();
+
+	// octree only tests element bounds, triangles of big meshes far outside navigable bounds are dropped here
+	TUniquePtr<FServerRecastTriangleFilter> TriangleFilter;
+	FServerRecastTriangleFilterStats FilterStats;
+	if (Options.bCullTriangles)
+	{
+		TriangleFilter = MakeUnique<FServerRecastTriangleFilter>(Agent.Config, Agent.InclusionBounds, Options.bCullUnwalkableTriangles);
+	}
+
+	TNavStatArray<int32> FilteredIndices;
+	const TNavStatArray<int32>* IndexBuffer = &SharedIndices;
+	if (!Agent.bTiled && TriangleFilter.IsValid())
+	{
+		SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_TriangleFilter, OutReport.FilterTime);
+		FilteredIndices = SharedIndices;
+		OutReport.FilteredIndexBytes = FilteredIndices.GetAllocatedSize();
+		ServerRecastStats::AddGeometryBufferMemory(OutReport.FilteredIndexBytes);
+
+		TriangleFilter->FilterBuffer(SharedCoords.GetData(), SharedCoords.Num() / 3, FilteredIndices, FilterStats);
+		IndexBuffer = &FilteredIndices;
+	}
+
+	// files are written in background while navmesh is built
+	TFuture<void> FileWrites;
+	const FString GeometryFileName = Agent.FileBaseName + (Options.bCompressFiles ? TEXT(".srgeomz") : TEXT(".srgeom"));
+	const FString OBJFileName = Agent.FileBaseName + (Options.bCompressFiles ? TEXT(".objz") : TEXT(".obj"));
+	const bool bWriteGeometryFile = Options.bExportGeometryFile && !Agent.bIncremental && !Agent.bTiled;
+	const bool bWriteOBJ = Options.bExportDebugOBJ && !Agent.bIncremental && !Agent.bTiled;
+	if ((bWriteGeometryFile || bWriteOBJ) && !IsCancelled())
+	{
+		const FServerRecastGatherSnapshot* SnapshotData = &Snapshot;
+		const FServerRecastAgentExportJob* AgentData = &Agent;
+		const TNavStatArray<float>* CoordData = &SharedCoords;
+		const TNavStatArray<int32>* IndexData = IndexBuffer;
+		FServerRecastAgentExportReport* Report = &OutReport;
+		const bool bCompress = Options.bCompressFiles;
+		FileWrites = Async<void>(EAsyncExecution::ThreadPool, [SnapshotData, AgentData, CoordData, IndexData, Report, bWriteGeometryFile, bWriteOBJ, bCompress]()
+			{
+				const FString& FileBaseName = AgentData->FileBaseName;
+				if (bWriteGeometryFile)
+				{
+					FScopedDurationTimer WriteTimer(Report->WriteGeometryTime);
+					ExportGeomToBinaryFile(FileBaseName + TEXT(".srgeom"), AgentData->RecastBounds, AgentData->Config, *CoordData, *IndexData, AgentData->AreaExport, SnapshotData, bCompress);
+				}
+
+				if (bWriteOBJ && (SnapshotData->Instances.Num() || SnapshotData->Heightfields.Num()))
+				{
+					// OBJ has no notion of instancing or height grids, expand everything
+					FScopedDurationTimer WriteTimer(Report->WriteOBJTime);
+					TNavStatArray<float> ExpandedCoords(*CoordData);
+					TNavStatArray<int32> ExpandedIndices(*IndexData);
+					SnapshotData->GetInstanceSet().Expand(nullptr, ExpandedCoords, ExpandedIndices);
+					SnapshotData->GetHeightfieldSet().Expand(nullptr, ExpandedCoords, ExpandedIndices);
+					ExportGeomToOBJFile(FileBaseName + TEXT(".obj"), ExpandedCoords, ExpandedIndices, AgentData->OBJAdditionalData, bCompress);
+				}
+				else if (bWriteOBJ)
+				{
+					FScopedDurationTimer WriteTimer(Report->WriteOBJTime);
+					ExportGeomToOBJFile(FileBaseName + TEXT(".obj"), *CoordData, *IndexData, AgentData->OBJAdditionalData, bCompress);
+				}
+			});
+	}
+
+	// tiled geometry goes to disk tile by tile and the build maps it back, whole world triangles are never in memory
+	const FString TiledGeometryFileName = Agent.FileBaseName + TEXT(".srgeom");
+	bool bTiledFileWritten = false;
+	if (Agent.bTiled)
+	{
+		if (Options.bCompressFiles || Options.bExportDebugOBJ)
+		{
+			UE_LOG(LogNavigation, Warning, TEXT("Tiled geometry export writes neither compressed files nor OBJ"));
+		}
+		{
+			FScopedDurationTimer WriteTimer(OutReport.WriteTiledGeometryTime);
+			bTiledFileWritten = ExportTiledGeometryFile(TiledGeometryFileName, Agent.RecastBounds, Agent.Config, Snapshot, Agent.AreaExport, Options.NumBuildWorkers, TriangleFilter.Get(), &FilterStats, Progress);
+		}
+		OutReport.GeometryFileSize = bTiledFileWritten ? FMath::Max<int64>(IFileManager::Get().FileSize(*TiledGeometryFileName), 0) : 0;
+		bSuccess &= bTiledFileWritten;
+	}
+
+	OutReport.FilterStats = FilterStats;
+	if (TriangleFilter.IsValid())
+	{
+		UE_LOG(LogNavigation, Log, TEXT("%s: culled %d of %d triangles, %d outside bounds, %d degenerate, %d unwalkable"), *Agent.NavDataName,
+			FilterStats.GetNumCulled(), FilterStats.NumInput, FilterStats.NumOutsideBounds, FilterStats.NumDegenerate, FilterStats.NumUnwalkable);
+	}
+
+	const bool bBuildNavMesh = !Agent.NavMeshFileName.IsEmpty();
+	const bool bWriteVoxels = Options.bExportVoxelTiles && !Agent.bIncremental;
+	const FString VoxelFileName = Agent.FileBaseName + TEXT(".srvox");
+	if ((bBuildNavMesh || bWriteVoxels) && (!Agent.bTiled || bTiledFileWritten) && !IsCancelled())
+	{
+		TArray<FServerRecastGeometryFileArea> Areas;
+		TArray<float> AreaPoints;
+		FServerRecastGeometryFileView TiledView;
+		FServerRecastGeometryFileView VoxelView;
+
+		FServerRecastBuildInput BuildInput;
+		bool bHasInput = true;
+		if (Agent.bTiled)
+		{
+			bHasInput = TiledView.Open(TiledGeometryFileName);
+			if (bHasInput)
+			{
+				BuildInput.InitFromFile(TiledView);
+			}
+		}
+		else
+		{
+			FlattenAreaExport(Agent.AreaExport, Areas, AreaPoints);
+
+			BuildInput.Config = Agent.Config;
+			BuildInput.Bounds = Agent.RecastBounds;
+			BuildInput.Coords = SharedCoords.GetData();
+			BuildInput.NumVerts = SharedCoords.Num() / 3;
+			BuildInput.Tris = IndexBuffer->GetData();
+			BuildInput.NumTris = IndexBuffer->Num() / 3;
+			BuildInput.Instances = Snapshot.GetInstanceSet();
+			BuildInput.Heightfields = Snapshot.GetHeightfieldSet();
+			BuildInput.Areas = Areas.GetData();
+			BuildInput.NumAreas = Areas.Num();
+			BuildInput.AreaPoints = AreaPoints.GetData();
+		}
+
+		// geometry is rasterized once here, the build below starts from filtered spans
+		if (bHasInput && bWriteVoxels)
+		{
+			FServerRecastNavMeshBuilder Voxelizer(BuildInput);
+			Voxelizer.SetProgress(Progress);
+			{
+				SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_Voxelize, OutReport.VoxelizeTime);
+				bHasInput = Voxelizer.Voxelize(VoxelFileName, Options.NumBuildWorkers) && VoxelView.Open(VoxelFileName);
+			}
+			if (bHasInput)
+			{
+				OutReport.VoxelFileSize = FMath::Max<int64>(IFileManager::Get().FileSize(*VoxelFileName), 0);
+				BuildInput.InitFromFile(VoxelView);
+			}
+		}
+
+		if (!bHasInput)
+		{
+			bSuccess = false;
+		}
+		else if (bBuildNavMesh)
+		{
+			FServerRecastNavMeshBuilder Builder(BuildInput);
+			Builder.SetProgress(Progress);
+
+			TUniquePtr<FServerRecastTileCache> TileCache;
+			if (!Options.TileCacheDir.IsEmpty())
+			{
+				TileCache = MakeUnique<FServerRecastTileCache>(Options.TileCacheDir, Options.TileCacheMaxSize);
+				Builder.SetTileCache(TileCache.Get());
+			}
+
+			bool bBuilt = false;
+			{
+				SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_BuildNavMesh, OutReport.BuildTime);
+				bBuilt = Agent.bIncremental ? Builder.Rebuild(Agent.NavMeshFileName, Agent.DirtyTiles, Options.NumBuildWorkers) : Builder.Build(Options.NumBuildWorkers);
+			}
+
+			if (TileCache.IsValid())
+			{
+				TileCache->LogStats();
+				TileCache->Prune();
+				OutReport.NumTileCacheHits = TileCache->GetNumHits();
+				OutReport.NumTileCacheMisses = TileCache->GetNumMisses();
+			}
+
+			bool bSaved = false;
+			if (bBuilt && !Builder.WasCancelled())
+			{
+				SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_SaveNavMesh, OutReport.SaveTime);
+				// key is written back only once everything is saved
+				IFileManager::Get().Delete(*FServerRecastNavMeshBuilder::GetBuildKeyFileName(Agent.NavMeshFileName), false, true, true);
+				bSaved = Builder.Save(Agent.NavMeshFileName);
+				if (bSaved && Options.bWriteTilePack)
+				{
+					const FString TilePackFileName = FPaths::ChangeExtension(Agent.NavMeshFileName, TEXT("navpack"));
+					bSaved = ServerRecastTilePack::Save(*Builder.GetNavMesh(), TilePackFileName);
+					OutReport.TilePackFileSize = FMath::Max<int64>(IFileManager::Get().FileSize(*TilePackFileName), 0);
+				}
+			}
+
+			if (bSaved && Options.bBuildTileGraph)
+			{
+				SERVERRECAST_SCOPE_PHASE(STAT_ServerRecast_BuildTileGraph, OutReport.TileGraphTime);
+				FServerRecastTileGraphSettings GraphSettings;
+				GraphSettings.NumWorkers = Options.NumBuildWorkers;
+				FServerRecastTileGraph TileGraph;
+				const FString TileGraphFileName = FPaths::ChangeExtension(Agent.NavMeshFileName, TEXT("navgraph"));
+				bSaved = TileGraph.Build(*Builder.GetNavMesh(), GraphSettings) && TileGraph.Save(TileGraphFileName);
+				OutReport.TileGraphFileSize = FMath::Max<int64>(IFileManager::Get().FileSize(*TileGraphFileName), 0);
+			}
+
+			if (Builder.WasCancelled())
+			{
+				bSuccess = false;
+			}
+			else if (!bSaved)
+			{
+				UE_LOG(LogNavigation, Error, TEXT("Failed to build navmesh for %s"), *Agent.NavDataName);
+				bSuccess = false;
+			}
+			else
+			{
+				for (const FServerRecastTileBuildStats& TileStats : Builder.GetTileStats())
+				{
+					OutReport.NumBuiltTiles++;
+					OutReport.NumRasterizedTris += TileStats.NumTris;
+				}
+				OutReport.NavMeshFileSize = FMath::Max<int64>(IFileManager::Get().FileSize(*Agent.NavMeshFileName), 0);
+				FServerRecastNavMeshBuilder::SaveBuildKey(Agent.NavMeshFileName, Agent.BuildKey);
+
+				Builder.LogTileReport();
+				if (Options.bWriteTileBuildReport)
+				{
+					Builder.SaveTileReport(Agent.NavMeshFileName + TEXT(".tiles.csv"));
+				}
+			}
+		}
+	}
+
+	if (FileWrites.IsValid())
+	{
+		FileWrites.Wait();
+		OutReport.GeometryFileSize = bWriteGeometryFile ? FMath::Max<int64>(IFileManager::Get().FileSize(*GeometryFileName), 0) : 0;
+		OutReport.OBJFileSize = bWriteOBJ ? FMath::Max<int64>(IFileManager::Get().FileSize(*OBJFileName), 0) : 0;
+	}
+
+	ServerRecastStats::AddGeometryBufferMemory(-OutReport.FilteredIndexBytes);
+
+	OutReport.bSuccess = bSuccess && !IsCancelled();
+	OutReport.TotalTime = FPlatformTime::Seconds() - StartAgentTime;
+	UE_LOG(LogNavigation, Log, TEXT("%s export time: %.3f sec ."), *Agent.NavDataName, OutReport.TotalTime);
+	return OutReport.bSuccess;
+}
+
+bool FExportNavMesh::MyExportNavigationData(const FString& FileName, const FServerRecastExportOptions& Options)
+{
+	FServerRecastExportJob Job;
+	if (!GatherExportJob(FileName, Options, Job))
+	{
+		return false;
+	}
+	return RunExportJob(Job);
 //	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
 //	const FNavigationOctree* NavOctree = NavSys ? NavSys->GetNavOctree() : NULL;
 //	if (NavOctree == NULL)
@@ -459,6 +935,422 @@ void FExportNavMesh::MyExportNavigationData(const FString& FileName)
 //	UE_LOG(LogNavigation, Log, TEXT("ExportNavigation time: %.3f sec ."), FPlatformTime::Seconds() - StartExportTime);
 }
 
+void FExportNavMesh::GatherExportSnapshot(const FServerRecastExportOptions& Options, FServerRecastGatherSnapshot& Snapshot, const FBox* QueryBounds)
+{
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const FNavigationOctree* NavOctree = NavSys ? NavSys->GetNavOctree() : NULL;
+	check(NavOctree);
+
+	// content hash -> prototype indices with that hash
+	TMultiMap<uint64, int32> PrototypesByHash;
+
+	// phase one: collect elements and their vertex/index counts, area convexes are kept as is until agents grow them
+	NavOctree->FindElementsWithBoundsTest(QueryBounds ? *QueryBounds : TotalNavBounds, [this, &Options, &Snapshot, &PrototypesByHash](const FNavigationOctreeElement& Element)
+		{
+			const bool bExportGeometry = Element.Data->HasGeometry() && Element.ShouldUseGeometry(DestNavMesh->GetConfig());
+
+			// landscapes are found by component, lazily gathered ones have no collision data yet
+			if (bExportGeometry && Options.bExportLandscapeHeightfields)
+			{
+				const ULandscapeHeightfieldCollisionComponent* LandscapeComponent = Cast<const ULandscapeHeightfieldCollisionComponent>(Element.GetOwner());
+				if (LandscapeComponent && AddLandscapeHeightfield(Snapshot, LandscapeComponent))
+				{
+					return;
+				}
+			}
+
+			TArray<FTransform> InstanceTransforms;
+			Element.Data->NavDataPerInstanceTransformDelegate.ExecuteIfBound(Element.Bounds.GetBox(), InstanceTransforms);
+
+			if (bExportGeometry && Element.Data->CollisionData.Num() && InstanceTransforms.Num() && Options.bExportInstancesAsPrototypes)
+			{
+				const int32 PrototypeIndex = FindOrAddPrototype(Element, Snapshot, PrototypesByHash);
+
+				Snapshot.Instances.Reserve(Snapshot.Instances.Num() + InstanceTransforms.Num());
+				for (const FTransform& InstanceTransform : InstanceTransforms)
+				{
+					AddInstance(Snapshot, PrototypeIndex, InstanceTransform);
+				}
+			}
+			else if (bExportGeometry && Element.Data->CollisionData.Num())
+			{
+				const int32 NumInstances = FMath::Max(InstanceTransforms.Num(), 1);
+				FServerRecastGeometryCache CachedGeometry(Element.Data->CollisionData.GetData());
+
+				FServerRecastGatherSnapshot::FGeometryElement& GeometryElement = Snapshot.Elements[Snapshot.Elements.Emplace(Element)];
+				GeometryElement.InstanceTransforms = MoveTemp(InstanceTransforms);
+				GeometryElement.NumCoords = CachedGeometry.Header.NumVerts * 3 * NumInstances;
+				GeometryElement.NumIndices = CachedGeometry.Header.NumFaces * 3 * NumInstances;
+			}
+			else
+			{
+				for (const FAreaNavModifier& AreaMod : Element.Data->Modifiers.GetAreas())
+				{
+					ENavigationShapeType::Type ShapeType = AreaMod.GetShapeType();
+
+					if (ShapeType == ENavigationShapeType::Convex)
+					{
+						FServerRecastAreaSource& AreaSource = Snapshot.AreaSources[Snapshot.AreaSources.AddDefaulted()];
+						AreaSource.AreaClass = AreaMod.GetAreaClass();
+						AreaMod.GetConvex(AreaSource.Convex);
+					}
+					else if (ShapeType == ENavigationShapeType::InstancedConvex)
+					{
+						for (const FTransform& InstanceTransform : InstanceTransforms)
+						{
+							FServerRecastAreaSource& AreaSource = Snapshot.AreaSources[Snapshot.AreaSources.AddDefaulted()];
+							AreaSource.AreaClass = AreaMod.GetAreaClass();
+							AreaMod.GetPerInstanceConvex(InstanceTransform, AreaSource.Convex);
+						}
+					}
+				}
+			}
+		});
+
+	UWorld* NavigationWorld = GetWorld();
+	for (int32 LevelIndex = 0; LevelIndex < NavigationWorld->GetNumLevels(); ++LevelIndex)
+	{
+		const ULevel* const Level = NavigationWorld->GetLevel(LevelIndex);
+		if (Level == NULL)
+		{
+			continue;
+		}
+
+		const TArray<FVector>* LevelGeom = Level->GetStaticNavigableGeometry();
+		if (LevelGeom != NULL && LevelGeom->Num() > 0)
+		{
+			FServerRecastGatherSnapshot::FLevelGeometry& LevelGeometry = Snapshot.LevelGeometry[Snapshot.LevelGeometry.AddDefaulted()];
+			// For every ULevel in World take its pre-generated static geometry vertex soup
+			TransformVertexSoupToRecast(*LevelGeom, LevelGeometry.Verts, LevelGeometry.Faces, Options.LevelGeometryWeldEpsilon); //RecastGeometryExport
+		}
+	}
+
+	// prefix sums, every element knows where its data goes in the final buffers
+	int32 NumCoords = 0;
+	int32 NumIndices = 0;
+	for (FServerRecastGatherSnapshot::FGeometryElement& GeometryElement : Snapshot.Elements)
+	{
+		GeometryElement.CoordOffset = NumCoords;
+		GeometryElement.IndexOffset = NumIndices;
+		NumCoords += GeometryElement.NumCoords;
+		NumIndices += GeometryElement.NumIndices;
+	}
+	for (FServerRecastGatherSnapshot::FLevelGeometry& LevelGeometry : Snapshot.LevelGeometry)
+	{
+		LevelGeometry.CoordOffset = NumCoords;
+		LevelGeometry.IndexOffset = NumIndices;
+		NumCoords += LevelGeometry.Verts.Num() * 3;
+		NumIndices += LevelGeometry.Faces.Num();
+	}
+	Snapshot.NumCoords = NumCoords;
+	Snapshot.NumIndices = NumIndices;
+}
+
+void FExportNavMesh::BuildAgentAreas(const ARecastNavMesh* NavData, const FServerRecastGatherSnapshot& Snapshot, TArray<FServerRecastAreaExportData>& OutAreaExport)
+{
+	OutAreaExport.Reset(Snapshot.AreaSources.Num());
+	for (const FServerRecastAreaSource& AreaSource : Snapshot.AreaSources)
+	{
+		FServerRecastAreaExportData ExportInfo;
+		ExportInfo.AreaId = NavData->GetAreaID(AreaSource.AreaClass);
+		ExportInfo.Convex = AreaSource.Convex;
+
+		TArray<FVector> ConvexVerts;
+		GrowConvexHull(NavData->AgentRadius, ExportInfo.Convex.Points, ConvexVerts);
+		if (ConvexVerts.Num())
+		{
+			ExportInfo.Convex.MinZ -= NavData->CellHeight;
+			ExportInfo.Convex.MaxZ += NavData->CellHeight;
+			ExportInfo.Convex.Points = ConvexVerts;
+
+			OutAreaExport.Add(ExportInfo);
+		}
+	}
+}
+
+int32 FExportNavMesh::FindOrAddPrototype(const FNavigationOctreeElement& Element, FServerRecastGatherSnapshot& Snapshot, TMultiMap<uint64, int32>& PrototypesByHash)
+{
+	const TNavStatArray<uint8>& CollisionData = Element.Data->CollisionData;
+	const uint64 ContentHash = CityHash64((const char*)CollisionData.GetData(), CollisionData.Num());
+
+	TArray<int32, TInlineAllocator<4>> Candidates;
+	PrototypesByHash.MultiFind(ContentHash, Candidates);
+	for (int32 Candidate : Candidates)
+	{
+		// same source data or equal content, e.g. several foliage components of one mesh
+		const TNavStatArray<uint8>& OtherData = Snapshot.PrototypeElements[Candidate].Data->CollisionData;
+		if (OtherData.GetData() == CollisionData.GetData() ||
+			(OtherData.Num() == CollisionData.Num() && FMemory::Memcmp(OtherData.GetData(), CollisionData.GetData(), CollisionData.Num()) == 0))
+		{
+			return Candidate;
+		}
+	}
+
+	FServerRecastGeometryCache CachedGeometry(CollisionData.GetData());
+	const int32 PrototypeIndex = AddPrototype(Snapshot, CachedGeometry.Verts, CachedGeometry.Header.NumVerts, CachedGeometry.Indices, CachedGeometry.Header.NumFaces);
+	Snapshot.PrototypeElements.Add(Element);
+	PrototypesByHash.Add(ContentHash, PrototypeIndex);
+
+	return PrototypeIndex;
+}
+
+int32 FExportNavMesh::AddPrototype(FServerRecastGatherSnapshot& Snapshot, const float* Verts, int32 NumVerts, const int32* Indices, int32 NumTris)
+{
+	FServerRecastGeometryFilePrototype Prototype;
+	Prototype.FirstVert = Snapshot.PrototypeCoords.Num() / 3;
+	Prototype.NumVerts = NumVerts;
+	Prototype.FirstTri = Snapshot.PrototypeIndices.Num() / 3;
+	Prototype.NumTris = NumTris;
+
+	FBox LocalBounds(ForceInit);
+	for (int32 i = 0; i < NumVerts * 3; i += 3)
+	{
+		LocalBounds += FVector(Verts[i + 0], Verts[i + 1], Verts[i + 2]);
+	}
+	Prototype.BoundsMin[0] = LocalBounds.Min.X;
+	Prototype.BoundsMin[1] = LocalBounds.Min.Y;
+	Prototype.BoundsMin[2] = LocalBounds.Min.Z;
+	Prototype.BoundsMax[0] = LocalBounds.Max.X;
+	Prototype.BoundsMax[1] = LocalBounds.Max.Y;
+	Prototype.BoundsMax[2] = LocalBounds.Max.Z;
+
+	Snapshot.PrototypeCoords.Append(Verts, NumVerts * 3);
+	Snapshot.PrototypeIndices.Append(Indices, NumTris * 3);
+
+	return Snapshot.Prototypes.Add(Prototype);
+}
+
+void FExportNavMesh::AddInstance(FServerRecastGatherSnapshot& Snapshot, int32 PrototypeIndex, const FTransform& InstanceTransform)
+{
+	const FServerRecastGeometryFilePrototype& Prototype = Snapshot.Prototypes[PrototypeIndex];
+
+	FServerRecastGeometryFileInstance& Instance = Snapshot.Instances[Snapshot.Instances.AddUninitialized()];
+	Instance.PrototypeIndex = PrototypeIndex;
+	Instance.Transform = FServerRecastAffine3x4::MakeInstanceToRecast(InstanceTransform);
+
+	FBox WorldBounds(ForceInit);
+	for (int32 Corner = 0; Corner < 8; ++Corner)
+	{
+		const float LocalCorner[3] = {
+			(Corner & 1) ? Prototype.BoundsMax[0] : Prototype.BoundsMin[0],
+			(Corner & 2) ? Prototype.BoundsMax[1] : Prototype.BoundsMin[1],
+			(Corner & 4) ? Prototype.BoundsMax[2] : Prototype.BoundsMin[2] };
+		float WorldCorner[3];
+		Instance.Transform.TransformPoint(LocalCorner, WorldCorner);
+		WorldBounds += FVector(WorldCorner[0], WorldCorner[1], WorldCorner[2]);
+	}
+	Instance.BoundsMin[0] = WorldBounds.Min.X;
+	Instance.BoundsMin[1] = WorldBounds.Min.Y;
+	Instance.BoundsMin[2] = WorldBounds.Min.Z;
+	Instance.BoundsMax[0] = WorldBounds.Max.X;
+	Instance.BoundsMax[1] = WorldBounds.Max.Y;
+	Instance.BoundsMax[2] = WorldBounds.Max.Z;
+}
+
+bool FExportNavMesh::AddLandscapeHeightfield(FServerRecastGatherSnapshot& Snapshot, const ULandscapeHeightfieldCollisionComponent* Component)
+{
+#if WITH_PHYSX
+	const FPhysXHeightfieldRef* HeightfieldRef = Component->HeightfieldRef.GetReference();
+	if (HeightfieldRef == nullptr || HeightfieldRef->RBHeightfield == nullptr)
+	{
+		return false;
+	}
+
+	// same heightfield and transform as ULandscapeHeightfieldCollisionComponent::DoCustomNavigableGeometryExport
+	const bool bSimpleCollision = HeightfieldRef->RBHeightfieldSimple != nullptr;
+	const physx::PxHeightField* PxHeightfield = bSimpleCollision ? HeightfieldRef->RBHeightfieldSimple : HeightfieldRef->RBHeightfield;
+	const float GridScale = bSimpleCollision ? Component->CollisionScale * Component->CollisionSizeQuads / Component->SimpleCollisionSizeQuads : Component->CollisionScale;
+	FTransform HFToW = Component->GetComponentTransform();
+	HFToW.MultiplyScale3D(FVector(GridScale, GridScale, LANDSCAPE_ZSCALE));
+
+	const int32 NumRows = PxHeightfield->getNbRows();
+	const int32 NumCols = PxHeightfield->getNbColumns();
+	const int32 NumSamples = NumRows * NumCols;
+	if (NumRows < 2 || NumCols < 2)
+	{
+		return false;
+	}
+
+	TArray<physx::PxHeightFieldSample> PxSamples;
+	PxSamples.SetNumUninitialized(NumSamples);
+	PxHeightfield->saveCells(PxSamples.GetData(), NumSamples * sizeof(physx::PxHeightFieldSample));
+
+	auto IsHoleSample = [&PxSamples](int32 SampleIndex) { return PxSamples[SampleIndex].materialIndex0 == physx::PxHeightFieldMaterial::eHOLE; };
+
+	// PhysX rows run against local X: grid point (X, Y) is sample (NumRows - 1 - X, Y), quad (X, Y) keeps its hole
+	// and tessellation flags in sample (NumRows - 2 - X, Y) and the mirror turns the flagged diagonal into the other one
+	auto GetSampleIndex = [NumRows, NumCols](int32 X, int32 Y) { return (NumRows - 1 - X) * NumCols + Y; };
+	auto GetQuadSampleIndex = [NumRows, NumCols](int32 X, int32 Y) { return (NumRows - 2 - X) * NumCols + Y; };
+
+	const FVector Scale = HFToW.GetScale3D();
+	if (!HFToW.GetRotation().IsIdentity(KINDA_SMALL_NUMBER) || Scale.X <= 0.f || Scale.Y <= 0.f || Scale.Z <= 0.f)
+	{
+		// rotated grid doesn't line up with recast axes, export it as triangles
+		FServerRecastGatherSnapshot::FLevelGeometry& LevelGeometry = Snapshot.LevelGeometry[Snapshot.LevelGeometry.AddDefaulted()];
+		LevelGeometry.Verts.SetNumUninitialized(NumSamples);
+		for (int32 VertIndex = 0; VertIndex < NumSamples; ++VertIndex)
+		{
+			const int32 X = VertIndex / NumCols;
+			const int32 Y = VertIndex % NumCols;
+			LevelGeometry.Verts[VertIndex] = Unreal2RecastPoint(HFToW.TransformPosition(FVector(X, Y, PxSamples[GetSampleIndex(X, Y)].height)));
+		}
+
+		const bool bMirrored = HFToW.GetDeterminant() < 0.f;
+		for (int32 Row = 0; Row < NumRows - 1; ++Row)
+		{
+			for (int32 Col = 0; Col < NumCols - 1; ++Col)
+			{
+				const int32 QuadSample = GetQuadSampleIndex(Row, Col);
+				if (IsHoleSample(QuadSample))
+				{
+					continue;
+				}
+
+				const int32 V00 = Row * NumCols + Col;
+				const int32 V01 = V00 + 1;
+				const int32 V10 = V00 + NumCols;
+				const int32 V11 = V10 + 1;
+				const int32 QuadTris[2][3][3] = {
+					{ { V11, V10, V00 }, { V01, V11, V00 } },
+					{ { V01, V10, V00 }, { V01, V11, V10 } } };
+				const int32 (&Tris)[2][3] = QuadTris[PxSamples[QuadSample].tessFlag() ? 1 : 0];
+				for (int32 TriIndex = 0; TriIndex < 2; ++TriIndex)
+				{
+					LevelGeometry.Faces.Add(Tris[TriIndex][bMirrored ? 2 : 0]);
+					LevelGeometry.Faces.Add(Tris[TriIndex][1]);
+					LevelGeometry.Faces.Add(Tris[TriIndex][bMirrored ? 0 : 2]);
+				}
+			}
+		}
+		return true;
+	}
+
+	// local X and Y grow along grid rows and columns, recast X and Z are negated
+	const FVector Origin = Unreal2RecastPoint(HFToW.GetLocation());
+	FServerRecastGeometryFileHeightfield Heightfield;
+	Heightfield.Origin[0] = Origin.X;
+	Heightfield.Origin[1] = Origin.Y;
+	Heightfield.Origin[2] = Origin.Z;
+	Heightfield.StepX = -Scale.X;
+	Heightfield.StepZ = -Scale.Y;
+	Heightfield.HeightScale = Scale.Z;
+	Heightfield.NumRows = NumRows;
+	Heightfield.NumCols = NumCols;
+	Heightfield.FirstSample = Snapshot.HeightfieldSamples.Num();
+	Heightfield.FirstMaskWord = Snapshot.HeightfieldMasks.Num();
+
+	int16 MinHeight = MAX_int16;
+	int16 MaxHeight = MIN_int16;
+	int16* Samples = Snapshot.HeightfieldSamples.GetData() + Snapshot.HeightfieldSamples.AddUninitialized(NumSamples);
+	for (int32 SampleIndex = 0; SampleIndex < NumSamples; ++SampleIndex)
+	{
+		Samples[SampleIndex] = PxSamples[GetSampleIndex(SampleIndex / NumCols, SampleIndex % NumCols)].height;
+		MinHeight = FMath::Min(MinHeight, Samples[SampleIndex]);
+		MaxHeight = FMath::Max(MaxHeight, Samples[SampleIndex]);
+	}
+
+	const int32 NumMaskWords = Heightfield.GetNumMaskWords();
+	uint32* HoleMask = Snapshot.HeightfieldMasks.GetData() + Snapshot.HeightfieldMasks.AddZeroed(NumMaskWords * 2);
+	uint32* SplitMask = HoleMask + NumMaskWords;
+	for (int32 Row = 0; Row < NumRows - 1; ++Row)
+	{
+		for (int32 Col = 0; Col < NumCols - 1; ++Col)
+		{
+			const int32 Quad = Row * (NumCols - 1) + Col;
+			const int32 QuadSample = GetQuadSampleIndex(Row, Col);
+			if (IsHoleSample(QuadSample))
+			{
+				HoleMask[Quad / 32] |= 1u << (Quad & 31);
+			}
+			if (!PxSamples[QuadSample].tessFlag())
+			{
+				SplitMask[Quad / 32] |= 1u << (Quad & 31);
+			}
+		}
+	}
+
+	Heightfield.BoundsMin[0] = Origin.X + (NumRows - 1) * Heightfield.StepX;
+	Heightfield.BoundsMin[1] = Origin.Y + MinHeight * Heightfield.HeightScale;
+	Heightfield.BoundsMin[2] = Origin.Z + (NumCols - 1) * Heightfield.StepZ;
+	Heightfield.BoundsMax[0] = Origin.X;
+	Heightfield.BoundsMax[1] = Origin.Y + MaxHeight * Heightfield.HeightScale;
+	Heightfield.BoundsMax[2] = Origin.Z;
+	Snapshot.Heightfields.Add(Heightfield);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FExportNavMesh::BuildGeometryBuffers(const FServerRecastGatherSnapshot& Snapshot, TNavStatArray<float>& CoordBuffer, TNavStatArray<int32>& IndexBuffer)
+{
+	CoordBuffer.SetNumUninitialized(Snapshot.NumCoords);
+	IndexBuffer.SetNumUninitialized(Snapshot.NumIndices);
+
+	float* Coords = CoordBuffer.GetData();
+	int32* Indices = IndexBuffer.GetData();
+
+	// phase two: every job writes only its own exactly-sized range, output matches serial gather
+	const int32 NumElements = Snapshot.Elements.Num();
+	ParallelFor(NumElements + Snapshot.LevelGeometry.Num(), [&Snapshot, NumElements, Coords, Indices](int32 JobIndex)
+		{
+			if (JobIndex >= NumElements)
+			{
+				const FServerRecastGatherSnapshot::FLevelGeometry& LevelGeometry = Snapshot.LevelGeometry[JobIndex - NumElements];
+				const int32 BaseVert = LevelGeometry.CoordOffset / 3;
+
+				int32* IndexDest = Indices + LevelGeometry.IndexOffset;
+				for (int32 i = 0; i < LevelGeometry.Faces.Num(); i++)
+				{
+					IndexDest[i] = LevelGeometry.Faces[i] + BaseVert;
+				}
+
+				float* CoordDest = Coords + LevelGeometry.CoordOffset;
+				for (int32 i = 0; i < LevelGeometry.Verts.Num(); i++)
+				{
+					CoordDest[i * 3 + 0] = LevelGeometry.Verts[i].X;
+					CoordDest[i * 3 + 1] = LevelGeometry.Verts[i].Y;
+					CoordDest[i * 3 + 2] = LevelGeometry.Verts[i].Z;
+				}
+				return;
+			}
+
+			const FServerRecastGatherSnapshot::FGeometryElement& GeometryElement = Snapshot.Elements[JobIndex];
+			WriteElementGeometry(GeometryElement, Coords + GeometryElement.CoordOffset, Indices + GeometryElement.IndexOffset, GeometryElement.CoordOffset / 3);
+		});
+}
+
+void FExportNavMesh::WriteElementGeometry(const FServerRecastGatherSnapshot::FGeometryElement& GeometryElement, float* CoordDest, int32* IndexDest, int32 BaseVert)
+{
+	FServerRecastGeometryCache CachedGeometry(GeometryElement.Element.Data->CollisionData.GetData());
+	const int32 NumCachedCoords = CachedGeometry.Header.NumVerts * 3;
+	const int32 NumCachedIndices = CachedGeometry.Header.NumFaces * 3;
+
+	if (GeometryElement.InstanceTransforms.Num() == 0)
+	{
+		for (int32 i = 0; i < NumCachedIndices; i++)
+		{
+			IndexDest[i] = CachedGeometry.Indices[i] + BaseVert;
+		}
+		FMemory::Memcpy(CoordDest, CachedGeometry.Verts, NumCachedCoords * sizeof(float));
+	}
+	for (const FTransform& InstanceTransform : GeometryElement.InstanceTransforms)
+	{
+		for (int32 i = 0; i < NumCachedIndices; i++)
+		{
+			IndexDest[i] = CachedGeometry.Indices[i] + BaseVert;
+		}
+
+		// collision cache stores coordinates in recast space, convert them to unreal and transform to recast world space
+		const FServerRecastAffine3x4 LocalToRecastWorld = FServerRecastAffine3x4::MakeInstanceToRecast(InstanceTransform);
+		ServerRecastVertexTransform::TransformPoints(LocalToRecastWorld, CachedGeometry.Verts, CoordDest, CachedGeometry.Header.NumVerts);
+
+		CoordDest += NumCachedCoords;
+		IndexDest += NumCachedIndices;
+		BaseVert += CachedGeometry.Header.NumVerts;
+	}
+}
+
 void FExportNavMesh::GrowConvexHull(const float ExpandBy, const TArray<FVector>& Verts, TArray<FVector>& OutResult)
 {
 	if (Verts.Num() < 3)
@@ -592,7 +1484,7 @@ void FExportNavMesh::GrowConvexHull(const float ExpandBy, const TArray<FVector>&
 	}
 }
 
-void FExportNavMesh::TransformVertexSoupToRecast(const TArray<FVector>& VertexSoup, TNavStatArray<FVector>& Verts, TNavStatArray<int32>& Faces)
+void FExportNavMesh::TransformVertexSoupToRecast(const TArray<FVector>& VertexSoup, TNavStatArray<FVector>& Verts, TNavStatArray<int32>& Faces, float WeldEpsilon)
 {
 	if (VertexSoup.Num() == 0)
 	{
@@ -601,6 +1493,12 @@ void FExportNavMesh::TransformVertexSoupToRecast(const TArray<FVector>& VertexSo
 
 	check(VertexSoup.Num() % 3 == 0);
 
+	if (WeldEpsilon > 0.f)
+	{
+		ServerRecastVertexWeld::WeldVertexSoupToRecast(VertexSoup, WeldEpsilon, Verts, Faces);
+		return;
+	}
+
 	const int32 StaticFacesCount = VertexSoup.Num() / 3;
 	int32 VertsCount = Verts.Num();
 	const FVector* Vertex = VertexSoup.GetData();
@@ -618,102 +1516,401 @@ void FExportNavMesh::TransformVertexSoupToRecast(const TArray<FVector>& VertexSo
 	}
 }
 
-void FExportNavMesh::ExportGeomToOBJFile(const FString& InFileName, const TNavStatArray<float>& GeomCoords, const TNavStatArray<int32>& GeomFaces, const FString& AdditionalData)
+void FExportNavMesh::ExportGeomToOBJFile(const FString& InFileName, const TNavStatArray<float>& GeomCoords, const TNavStatArray<int32>& GeomFaces, const FString& AdditionalData, bool bCompress)
 {
-#define USE_COMPRESSION 0
-
 #if ALLOW_DEBUG_FILES
-	//SCOPE_CYCLE_COUNTER(STAT_Navigation_TileGeometryExportToObjAsync);
+	SERVERRECAST_SCOPE_STAT(STAT_ServerRecast_WriteOBJ);
 
 	FString FileName = InFileName;
+	if (bCompress)
+	{
+		FileName += TEXT("z");
+	}
 
-#if USE_COMPRESSION
-	FileName += TEXT("z");
-	struct FDataChunk
+	// formats straight into writer buffers, disk writes run on the writer's I/O thread
+	FServerRecastStreamWriter Writer;
+	if (Writer.Open(FileName, bCompress))
 	{
-		TArray<uint8> UncompressedBuffer;
-		TArray<uint8> CompressedBuffer;
-		void CompressBuffer()
-		{
-			const int32 HeaderSize = sizeof(int32);
-			const int32 UncompressedSize = UncompressedBuffer.Num();
-			CompressedBuffer.Init(0, HeaderSize + FMath::Trunc(1.1f * UncompressedSize));
+		using namespace ServerRecastTextFormat;
+		static const int32 MaxLineLength = 3 * (MaxNumberLength + 1) + 4;
 
-			int32 CompressedSize = CompressedBuffer.Num() - HeaderSize;
-			uint8* DestBuffer = CompressedBuffer.GetData();
-			FMemory::Memcpy(DestBuffer, &UncompressedSize, HeaderSize);
-			DestBuffer += HeaderSize;
+		for (int32 Index = 0; Index < GeomCoords.Num(); Index += 3)
+		{
+			ANSICHAR* Line = Writer.Reserve(MaxLineLength);
+			*Line++ = 'v';
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				*Line++ = ' ';
+				Line += FormatFloat(GeomCoords[Index + Axis], Line);
+			}
+			*Line++ = ' ';
+			*Line++ = '\n';
+			Writer.Commit(Line);
+		}
 
-			FCompression::CompressMemory((ECompressionFlags)(COMPRESS_ZLIB | COMPRESS_BiasMemory), (void*)DestBuffer, CompressedSize, (void*)UncompressedBuffer.GetData(), UncompressedSize);
-			CompressedBuffer.SetNum(CompressedSize + HeaderSize, false);
+		for (int32 Index = 0; Index < GeomFaces.Num(); Index += 3)
+		{
+			ANSICHAR* Line = Writer.Reserve(MaxLineLength);
+			*Line++ = 'f';
+			for (int32 Corner = 0; Corner < 3; ++Corner)
+			{
+				*Line++ = ' ';
+				Line += FormatInt(GeomFaces[Index + Corner] + 1, Line);
+			}
+			*Line++ = ' ';
+			*Line++ = '\n';
+			Writer.Commit(Line);
 		}
-	};
-	FDataChunk AllDataChunks[3];
-	const int32 NumberOfChunks = sizeof(AllDataChunks) / sizeof(FDataChunk);
-	{
-		FMemoryWriter ArWriter(AllDataChunks[0].UncompressedBuffer);
-		for (int32 i = 0; i < GeomCoords.Num(); i += 3)
+
+		auto AnsiAdditionalData = StringCast<ANSICHAR>(*AdditionalData);
+		Writer.Write(AnsiAdditionalData.Get(), AnsiAdditionalData.Length());
+		if (!Writer.Close())
 		{
-			FVector Vertex(GeomCoords[i + 0], GeomCoords[i + 1], GeomCoords[i + 2]);
-			ArWriter << Vertex;
+			UE_LOG(LogNavigation, Error, TEXT("Failed to write %s"), *FileName);
 		}
 	}
+#endif
+}
 
+void FExportNavMesh::FlattenAreaExport(const TArray<FServerRecastAreaExportData>& AreaExport, TArray<FServerRecastGeometryFileArea>& OutAreas, TArray<float>& OutAreaPoints)
+{
+	// area convexes are small, flatten them to recast coords so the builder doesn't need any conversion
+	OutAreas.Reset(AreaExport.Num());
+	OutAreaPoints.Reset();
+	for (const FServerRecastAreaExportData& ExportInfo : AreaExport)
 	{
-		FMemoryWriter ArWriter(AllDataChunks[1].UncompressedBuffer);
-		for (int32 i = 0; i < GeomFaces.Num(); i += 3)
+		FServerRecastGeometryFileArea& Area = OutAreas[OutAreas.AddZeroed()];
+		Area.AreaId = ExportInfo.AreaId;
+		Area.FirstPoint = OutAreaPoints.Num() / 3;
+		Area.NumPoints = ExportInfo.Convex.Points.Num();
+		Area.MinZ = ExportInfo.Convex.MinZ;
+		Area.MaxZ = ExportInfo.Convex.MaxZ;
+
+		for (const FVector& Point : ExportInfo.Convex.Points)
 		{
-			FVector Face(GeomFaces[i + 0] + 1, GeomFaces[i + 1] + 1, GeomFaces[i + 2] + 1);
-			ArWriter << Face;
+			const FVector Pt = Unreal2RecastPoint(Point);
+			OutAreaPoints.Add(Pt.X);
+			OutAreaPoints.Add(Pt.Y);
+			OutAreaPoints.Add(Pt.Z);
 		}
 	}
+}
+
+bool FExportNavMesh::ExportGeomToBinaryFile(const FString& InFileName, const FBox& RecastBounds, const FRecastBuildConfig& Config, const TNavStatArray<float>& GeomCoords, const TNavStatArray<int32>& GeomFaces, const TArray<FServerRecastAreaExportData>& AreaExport, const FServerRecastGatherSnapshot* InstancedGeometry, bool bCompress)
+{
+	SERVERRECAST_SCOPE_STAT(STAT_ServerRecast_WriteGeometry);
+	TArray<FServerRecastGeometryFileArea> Areas;
+	TArray<float> AreaPoints;
+	FlattenAreaExport(AreaExport, Areas, AreaPoints);
+
+	FServerRecastGeometryFileWriter Writer(RecastBounds, Config);
+	Writer.AddSection(EServerRecastGeometrySection::Vertices, GeomCoords.GetData(), GeomCoords.Num() * sizeof(float), GeomCoords.Num() / 3);
+	Writer.AddSection(EServerRecastGeometrySection::Triangles, GeomFaces.GetData(), GeomFaces.Num() * sizeof(int32), GeomFaces.Num() / 3);
+	Writer.AddSection(EServerRecastGeometrySection::Areas, Areas.GetData(), Areas.Num() * sizeof(FServerRecastGeometryFileArea), Areas.Num());
+	Writer.AddSection(EServerRecastGeometrySection::AreaPoints, AreaPoints.GetData(), AreaPoints.Num() * sizeof(float), AreaPoints.Num() / 3);
+
+	if (InstancedGeometry && InstancedGeometry->Instances.Num())
+	{
+		const FServerRecastGatherSnapshot& Instanced = *InstancedGeometry;
+		Writer.AddSection(EServerRecastGeometrySection::Prototypes, Instanced.Prototypes.GetData(), Instanced.Prototypes.Num() * sizeof(FServerRecastGeometryFilePrototype), Instanced.Prototypes.Num());
+		Writer.AddSection(EServerRecastGeometrySection::PrototypeVertices, Instanced.PrototypeCoords.GetData(), Instanced.PrototypeCoords.Num() * sizeof(float), Instanced.PrototypeCoords.Num() / 3);
+		Writer.AddSection(EServerRecastGeometrySection::PrototypeTriangles, Instanced.PrototypeIndices.GetData(), Instanced.PrototypeIndices.Num() * sizeof(int32), Instanced.PrototypeIndices.Num() / 3);
+		Writer.AddSection(EServerRecastGeometrySection::Instances, Instanced.Instances.GetData(), Instanced.Instances.Num() * sizeof(FServerRecastGeometryFileInstance), Instanced.Instances.Num());
+	}
 
+	if (InstancedGeometry && InstancedGeometry->Heightfields.Num())
 	{
-		auto AnsiAdditionalData = StringCast<ANSICHAR>(*AdditionalData);
-		FMemoryWriter ArWriter(AllDataChunks[2].UncompressedBuffer);
-		ArWriter.Serialize((ANSICHAR*)AnsiAdditionalData.Get(), AnsiAdditionalData.Length());
+		AddHeightfieldSections(Writer, *InstancedGeometry);
 	}
 
-	FArchive* FileAr = IFileManager::Get().CreateDebugFileWriter(*FileName);
-	if (FileAr != NULL)
+	return Writer.Write(bCompress ? InFileName + TEXT("z") : InFileName, bCompress);
+}
+
+void FExportNavMesh::AddHeightfieldSections(FServerRecastGeometryFileWriter& Writer, const FServerRecastGatherSnapshot& Snapshot)
+{
+	Writer.AddSection(EServerRecastGeometrySection::Heightfields, Snapshot.Heightfields.GetData(), Snapshot.Heightfields.Num() * sizeof(FServerRecastGeometryFileHeightfield), Snapshot.Heightfields.Num());
+	Writer.AddSection(EServerRecastGeometrySection::HeightfieldSamples, Snapshot.HeightfieldSamples.GetData(), Snapshot.HeightfieldSamples.Num() * sizeof(int16), Snapshot.HeightfieldSamples.Num());
+	Writer.AddSection(EServerRecastGeometrySection::HeightfieldMasks, Snapshot.HeightfieldMasks.GetData(), Snapshot.HeightfieldMasks.Num() * sizeof(uint32), Snapshot.HeightfieldMasks.Num());
+}
+
+bool FExportNavMesh::ExportTiledGeometryFile(const FString& InFileName, const FBox& RecastBounds, const FRecastBuildConfig& Config, const FServerRecastGatherSnapshot& Snapshot, const TArray<FServerRecastAreaExportData>& AreaExport, int32 NumWorkers,
+	const FServerRecastTriangleFilter* TriangleFilter, FServerRecastTriangleFilterStats* OutFilterStats, FServerRecastExportProgress* Progress)
+{
+	SERVERRECAST_SCOPE_STAT(STAT_ServerRecast_WriteTiledGeometry);
+	const double StartTime = FPlatformTime::Seconds();
+
+	const FServerRecastTileGrid Grid(Config, RecastBounds);
+	if (!Grid.IsValid())
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to write %s, empty navigation bounds"), *InFileName);
+		return false;
+	}
+
+	// bin sources by bounds, elements by octree bounds and level geometry per triangle (level index, first index).
+	// The first tile of a source owns it, filter stats count each source triangle once there, not once per border copy
+	struct FTileSources
+	{
+		TArray<int32> OwnedElements;
+		TArray<int32> Elements;
+		TArray<FIntPoint> OwnedLevelTris;
+		TArray<FIntPoint> LevelTris;
+	};
+	TArray<FTileSources> TileSources;
+	TileSources.SetNum(Grid.GetNumTiles());
+
+	auto ForEachTile = [&Grid](const FBox& RecastBox, TFunctionRef<void(int32, bool)> Func)
+	{
+		FIntPoint MinTile, MaxTile;
+		if (!Grid.GetTileRange(RecastBox, MinTile, MaxTile))
+		{
+			return false;
+		}
+		for (int32 TileY = MinTile.Y; TileY <= MaxTile.Y; ++TileY)
+		{
+			for (int32 TileX = MinTile.X; TileX <= MaxTile.X; ++TileX)
+			{
+				Func(TileY * Grid.TilesWidth + TileX, TileX == MinTile.X && TileY == MinTile.Y);
+			}
+		}
+		return true;
+	};
+
+	// sources missing the whole grid never reach a tile
+	FServerRecastTriangleFilterStats OutsideGridStats;
+	for (int32 ElementIndex = 0; ElementIndex < Snapshot.Elements.Num(); ++ElementIndex)
+	{
+		const bool bBinned = ForEachTile(Unreal2RecastBox(Snapshot.Elements[ElementIndex].Element.Bounds.GetBox()), [&](int32 TileIndex, bool bOwner)
+			{
+				(bOwner ? TileSources[TileIndex].OwnedElements : TileSources[TileIndex].Elements).Add(ElementIndex);
+			});
+		if (!bBinned)
+		{
+			OutsideGridStats.NumInput += Snapshot.Elements[ElementIndex].NumIndices / 3;
+			OutsideGridStats.NumOutsideBounds += Snapshot.Elements[ElementIndex].NumIndices / 3;
+		}
+	}
+	for (int32 LevelIndex = 0; LevelIndex < Snapshot.LevelGeometry.Num(); ++LevelIndex)
 	{
-		for (int32 Index = 0; Index < NumberOfChunks; ++Index)
+		const FServerRecastGatherSnapshot::FLevelGeometry& LevelGeometry = Snapshot.LevelGeometry[LevelIndex];
+		for (int32 i = 0; i < LevelGeometry.Faces.Num(); i += 3)
 		{
-			AllDataChunks[Index].CompressBuffer();
-			int32 BufferSize = AllDataChunks[Index].CompressedBuffer.Num();
-			FileAr->Serialize(&BufferSize, sizeof(int32));
-			FileAr->Serialize((void*)AllDataChunks[Index].CompressedBuffer.GetData(), AllDataChunks[Index].CompressedBuffer.Num());
+			FBox TriBounds(ForceInit);
+			TriBounds += LevelGeometry.Verts[LevelGeometry.Faces[i + 0]];
+			TriBounds += LevelGeometry.Verts[LevelGeometry.Faces[i + 1]];
+			TriBounds += LevelGeometry.Verts[LevelGeometry.Faces[i + 2]];
+			const bool bBinned = ForEachTile(TriBounds, [&](int32 TileIndex, bool bOwner)
+				{
+					(bOwner ? TileSources[TileIndex].OwnedLevelTris : TileSources[TileIndex].LevelTris).Add(FIntPoint(LevelIndex, i));
+				});
+			if (!bBinned)
+			{
+				OutsideGridStats.NumInput++;
+				OutsideGridStats.NumOutsideBounds++;
+			}
 		}
-		UE_LOG(LogNavigation, Error, TEXT("UncompressedBuffer size:: %d "), AllDataChunks[0].UncompressedBuffer.Num() + AllDataChunks[1].UncompressedBuffer.Num() + AllDataChunks[2].UncompressedBuffer.Num());
-		FileAr->Close();
 	}
 
-#else
-	FArchive* FileAr = IFileManager::Get().CreateDebugFileWriter(*FileName);
-	if (FileAr != NULL)
+	// areas, instances and height grids are small, they stay global
+	TArray<FServerRecastGeometryFileArea> Areas;
+	TArray<float> AreaPoints;
+	FlattenAreaExport(AreaExport, Areas, AreaPoints);
+
+	FServerRecastGeometryFileWriter Writer(Grid.Bounds, Config);
+	Writer.AddSection(EServerRecastGeometrySection::Areas, Areas.GetData(), Areas.Num() * sizeof(FServerRecastGeometryFileArea), Areas.Num());
+	Writer.AddSection(EServerRecastGeometrySection::AreaPoints, AreaPoints.GetData(), AreaPoints.Num() * sizeof(float), AreaPoints.Num() / 3);
+	if (Snapshot.Instances.Num())
 	{
-		for (int32 Index = 0; Index < GeomCoords.Num(); Index += 3)
+		Writer.AddSection(EServerRecastGeometrySection::Prototypes, Snapshot.Prototypes.GetData(), Snapshot.Prototypes.Num() * sizeof(FServerRecastGeometryFilePrototype), Snapshot.Prototypes.Num());
+		Writer.AddSection(EServerRecastGeometrySection::PrototypeVertices, Snapshot.PrototypeCoords.GetData(), Snapshot.PrototypeCoords.Num() * sizeof(float), Snapshot.PrototypeCoords.Num() / 3);
+		Writer.AddSection(EServerRecastGeometrySection::PrototypeTriangles, Snapshot.PrototypeIndices.GetData(), Snapshot.PrototypeIndices.Num() * sizeof(int32), Snapshot.PrototypeIndices.Num() / 3);
+		Writer.AddSection(EServerRecastGeometrySection::Instances, Snapshot.Instances.GetData(), Snapshot.Instances.Num() * sizeof(FServerRecastGeometryFileInstance), Snapshot.Instances.Num());
+	}
+	if (Snapshot.Heightfields.Num())
+	{
+		AddHeightfieldSections(Writer, Snapshot);
+	}
+
+	if (!Writer.BeginStream(InFileName, Grid.GetNumTiles()))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to write %s"), *InFileName);
+		return false;
+	}
+
+	struct FBucketScratch
+	{
+		TArray<float> Coords;
+		TArray<int32> Indices;
+		TMap<FIntPoint, int32> LevelVertRemap;
+		TArray<int32> Remap;
+		TArray<float> BucketCoords;
+		TArray<int32> BucketIndices;
+		TArray<uint8> Bucket;
+		FServerRecastTriangleFilterStats FilterStats;
+	};
+
+	// one batch of tiles is built in parallel and written in row order, memory is bounded by the batch
+	const int32 NumSlots = 2 * (NumWorkers > 0 ? NumWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+	TArray<FBucketScratch> Slots;
+	Slots.SetNum(NumSlots);
+
+	int64 NumBucketTris = 0;
+	int32 NumBuckets = 0;
+	bool bCancelled = false;
+	bool bWritten = true;
+	for (int32 FirstTile = 0; FirstTile < Grid.GetNumTiles() && bWritten; FirstTile += NumSlots)
+	{
+		if (Progress && Progress->IsCancelled())
 		{
-			FString LineToSave = FString::Printf(TEXT("v %f %f %f \n"), GeomCoords[Index + 0], GeomCoords[Index + 1], GeomCoords[Index + 2]);
-			auto AnsiLineToSave = StringCast<ANSICHAR>(*LineToSave);
-			FileAr->Serialize((ANSICHAR*)AnsiLineToSave.Get(), AnsiLineToSave.Length());
+			bCancelled = true;
+			break;
 		}
 
-		for (int32 Index = 0; Index < GeomFaces.Num(); Index += 3)
+		const int32 NumBatchTiles = FMath::Min(NumSlots, Grid.GetNumTiles() - FirstTile);
+		ParallelFor(NumBatchTiles, [&](int32 SlotIndex)
+			{
+				const int32 TileIndex = FirstTile + SlotIndex;
+				const FTileSources& Sources = TileSources[TileIndex];
+				FBucketScratch& Scratch = Slots[SlotIndex];
+
+				Scratch.Coords.Reset();
+				Scratch.Indices.Reset();
+				Scratch.Bucket.Reset();
+				Scratch.LevelVertRemap.Reset();
+				auto AddSources = [&Snapshot, &Scratch](const TArray<int32>& Elements, const TArray<FIntPoint>& LevelTris)
+				{
+					for (int32 ElementIndex : Elements)
+					{
+						const FServerRecastGatherSnapshot::FGeometryElement& GeometryElement = Snapshot.Elements[ElementIndex];
+						const int32 CoordStart = Scratch.Coords.AddUninitialized(GeometryElement.NumCoords);
+						const int32 IndexStart = Scratch.Indices.AddUninitialized(GeometryElement.NumIndices);
+						WriteElementGeometry(GeometryElement, Scratch.Coords.GetData() + CoordStart, Scratch.Indices.GetData() + IndexStart, CoordStart / 3);
+					}
+
+					// level vertices are shared between triangles, keep them shared inside the tile
+					for (const FIntPoint& LevelTri : LevelTris)
+					{
+						const FServerRecastGatherSnapshot::FLevelGeometry& LevelGeometry = Snapshot.LevelGeometry[LevelTri.X];
+						for (int32 Corner = 0; Corner < 3; ++Corner)
+						{
+							const int32 LevelVert = LevelGeometry.Faces[LevelTri.Y + Corner];
+							int32* Existing = Scratch.LevelVertRemap.Find(FIntPoint(LevelTri.X, LevelVert));
+							if (Existing == nullptr)
+							{
+								const FVector& Vert = LevelGeometry.Verts[LevelVert];
+								Existing = &Scratch.LevelVertRemap.Add(FIntPoint(LevelTri.X, LevelVert), Scratch.Coords.Num() / 3);
+								Scratch.Coords.Add(Vert.X);
+								Scratch.Coords.Add(Vert.Y);
+								Scratch.Coords.Add(Vert.Z);
+							}
+							Scratch.Indices.Add(*Existing);
+						}
+					}
+				};
+				AddSources(Sources.OwnedElements, Sources.OwnedLevelTris);
+				const int32 NumOwnedTris = Scratch.Indices.Num() / 3;
+				AddSources(Sources.Elements, Sources.LevelTris);
+
+				if (TriangleFilter)
+				{
+					// border copies are filtered the same way, but counted by the tile owning them
+					FServerRecastTriangleFilterStats CopyStats;
+					const int32 NumVerts = Scratch.Coords.Num() / 3;
+					const int32 NumKeptOwned = TriangleFilter->Filter(Scratch.Coords.GetData(), NumVerts, Scratch.Indices.GetData(), NumOwnedTris, Scratch.FilterStats);
+					const int32 NumKeptCopies = TriangleFilter->Filter(Scratch.Coords.GetData(), NumVerts, Scratch.Indices.GetData() + NumOwnedTris * 3, Scratch.Indices.Num() / 3 - NumOwnedTris, CopyStats);
+					if (NumKeptOwned != NumOwnedTris)
+					{
+						FMemory::Memmove(Scratch.Indices.GetData() + NumKeptOwned * 3, Scratch.Indices.GetData() + NumOwnedTris * 3, NumKeptCopies * 3 * sizeof(int32));
+					}
+					Scratch.Indices.SetNum((NumKeptOwned + NumKeptCopies) * 3, false);
+				}
+
+				// elements are binned by bounds, drop their triangles that miss the bordered tile
+				const FBox TileBounds = Grid.GetTileBounds(TileIndex % Grid.TilesWidth, TileIndex / Grid.TilesWidth, true);
+				Scratch.Remap.Reset();
+				Scratch.Remap.Init(INDEX_NONE, Scratch.Coords.Num() / 3);
+				Scratch.BucketCoords.Reset();
+				Scratch.BucketIndices.Reset();
+				for (int32 i = 0; i < Scratch.Indices.Num(); i += 3)
+				{
+					const float* V0 = &Scratch.Coords[Scratch.Indices[i + 0] * 3];
+					const float* V1 = &Scratch.Coords[Scratch.Indices[i + 1] * 3];
+					const float* V2 = &Scratch.Coords[Scratch.Indices[i + 2] * 3];
+					if (FMath::Max3(V0[0], V1[0], V2[0]) < TileBounds.Min.X || FMath::Min3(V0[0], V1[0], V2[0]) > TileBounds.Max.X ||
+						FMath::Max3(V0[2], V1[2], V2[2]) < TileBounds.Min.Z || FMath::Min3(V0[2], V1[2], V2[2]) > TileBounds.Max.Z)
+					{
+						continue;
+					}
+
+					for (int32 Corner = 0; Corner < 3; ++Corner)
+					{
+						const int32 Vert = Scratch.Indices[i + Corner];
+						if (Scratch.Remap[Vert] == INDEX_NONE)
+						{
+							Scratch.Remap[Vert] = Scratch.BucketCoords.Num() / 3;
+							Scratch.BucketCoords.Append(&Scratch.Coords[Vert * 3], 3);
+						}
+						Scratch.BucketIndices.Add(Scratch.Remap[Vert]);
+					}
+				}
+
+				if (Scratch.BucketIndices.Num() == 0)
+				{
+					return;
+				}
+
+				FServerRecastGeometryFileTileBucket Header;
+				Header.TileX = TileIndex % Grid.TilesWidth;
+				Header.TileY = TileIndex / Grid.TilesWidth;
+				Header.NumVerts = Scratch.BucketCoords.Num() / 3;
+				Header.NumTris = Scratch.BucketIndices.Num() / 3;
+
+				Scratch.Bucket.SetNumUninitialized(FServerRecastGeometryFileTileBucket::GetSize(Header.NumVerts, Header.NumTris));
+				uint8* Dest = Scratch.Bucket.GetData();
+				FMemory::Memcpy(Dest, &Header, sizeof(Header));
+				FMemory::Memcpy(Dest + sizeof(Header), Scratch.BucketCoords.GetData(), Scratch.BucketCoords.Num() * sizeof(float));
+				FMemory::Memcpy(Dest + sizeof(Header) + Scratch.BucketCoords.Num() * sizeof(float), Scratch.BucketIndices.GetData(), Scratch.BucketIndices.Num() * sizeof(int32));
+			});
+
+		for (int32 SlotIndex = 0; SlotIndex < NumBatchTiles; ++SlotIndex)
 		{
-			FString LineToSave = FString::Printf(TEXT("f %d %d %d \n"), GeomFaces[Index + 0] + 1, GeomFaces[Index + 1] + 1, GeomFaces[Index + 2] + 1);
-			auto AnsiLineToSave = StringCast<ANSICHAR>(*LineToSave);
-			FileAr->Serialize((ANSICHAR*)AnsiLineToSave.Get(), AnsiLineToSave.Length());
+			const TArray<uint8>& Bucket = Slots[SlotIndex].Bucket;
+			if (Bucket.Num())
+			{
+				if (!Writer.StreamSection(EServerRecastGeometrySection::TileBucket, Bucket.GetData(), Bucket.Num(), 1))
+				{
+					bWritten = false;
+					break;
+				}
+				const int32 NumTris = ((const FServerRecastGeometryFileTileBucket*)Bucket.GetData())->NumTris;
+				NumBucketTris += NumTris;
+				++NumBuckets;
+				if (Progress)
+				{
+					Progress->AddTris(NumTris);
+				}
+			}
 		}
+	}
 
-		auto AnsiAdditionalData = StringCast<ANSICHAR>(*AdditionalData);
-		FileAr->Serialize((ANSICHAR*)AnsiAdditionalData.Get(), AnsiAdditionalData.Length());
-		FileAr->Close();
+	if (OutFilterStats)
+	{
+		*OutFilterStats += OutsideGridStats;
+		for (const FBucketScratch& Scratch : Slots)
+		{
+			*OutFilterStats += Scratch.FilterStats;
+		}
 	}
-#endif
 
-#undef USE_COMPRESSION
-#endif
+	const bool bSuccess = Writer.EndStream() && bWritten;
+	if (bCancelled || !bWritten)
+	{
+		IFileManager::Get().Delete(*InFileName);
+		return false;
+	}
+
+	UE_LOG(LogNavigation, Log, TEXT("%s: %d tile buckets of %d tiles, %lld triangles including border copies, %.3f sec"),
+		*InFileName, NumBuckets, Grid.GetNumTiles(), NumBucketTris, FPlatformTime::Seconds() - StartTime);
+	return bSuccess;
 }
 
 FVector FExportNavMesh::ChangeDirectionOfPoint(FVector Coord)
@@ -5,6 +5,10 @@
 #include "ServerRecastCommands.h"
 #include "Misc/MessageDialog.h"
 #include "Framework/MultiBox/MultiBoxBuilder.h"
+#include "Misc/CoreDelegates.h"
+#include "Containers/Ticker.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
 
 // Nav Data
 #include "NavigationData.h"
@@ -23,9 +27,6 @@
 #include "UnrealEd.h"
 #include "LevelEditor.h"
 
-#include "Runtime/Core/Public/GenericPlatform/GenericPlatformProcess.h"
-#include <windows.h>
-
 static const FName ServerRecastTabName("ServerRecast");
 
 #define LOCTEXT_NAMESPACE "FServerRecastModule"
@@ -44,7 +45,18 @@ void FServerRecastModule::StartupModule()
 	PluginCommands->MapAction(
 		FServerRecastCommands::Get().PluginAction,
 		FExecuteAction::CreateRaw(this, &FServerRecastModule::PluginButtonClicked),
-		FCanExecuteAction());
+		FCanExecuteAction::CreateRaw(this, &FServerRecastModule::CanExportNavigation));
+
+	PluginCommands->MapAction(
+		FServerRecastCommands::Get().SaveBuiltNavMeshAction,
+		FExecuteAction::CreateRaw(this, &FServerRecastModule::SaveBuiltNavMeshClicked),
+		FCanExecuteAction::CreateRaw(this, &FServerRecastModule::CanExportNavigation));
+
+	// headless export (ServerRecastExport commandlet) needs neither the toolbar nor edit tracking
+	if (IsRunningCommandlet())
+	{
+		return;
+	}
 		
 	FLevelEditorModule& LevelEditorModule = FModuleManager::LoadModuleChecked<FLevelEditorModule>("LevelEditor");
 	
@@ -61,63 +73,179 @@ void FServerRecastModule::StartupModule()
 		
 		LevelEditorModule.GetToolBarExtensibilityManager()->AddExtender(ToolbarExtender);
 	}
+
+	// engine delegates need GEngine, which doesn't exist yet when editor loads plugins on startup
+	if (GEngine)
+	{
+		DirtyTracker.Register();
+	}
+	else
+	{
+		FCoreDelegates::OnPostEngineInit.AddRaw(&DirtyTracker, &FServerRecastDirtyTracker::Register);
+	}
 }
 
 void FServerRecastModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FCoreDelegates::OnPostEngineInit.RemoveAll(&DirtyTracker);
+	DirtyTracker.Unregister();
+
+	if (ActiveExport.IsValid())
+	{
+		ActiveExport->OnCompleted.Unbind();
+		ActiveExport->Cancel();
+		ActiveExport->Wait();
+		ActiveExport.Reset();
+	}
+	FTicker::GetCoreTicker().RemoveTicker(ExportTickerHandle);
+
 	FServerRecastStyle::Shutdown();
 
 	FServerRecastCommands::Unregister();
 }
 
-class ARecastNavMeshTrick : public ARecastNavMesh { public: const FPImplRecastNavMesh* GetRecastNavMeshImplTrick() const { return GetRecastNavMeshImpl(); } };
-
 void FServerRecastModule::PluginButtonClicked()
 {
+	if (!CanExportNavigation())
+	{
+		return;
+	}
 
 	if (UWorld* World = GEditor->GetEditorWorldContext().World())
 	{
-		// Create mesh
-		if (UNavigationSystemV1* NavSys = Cast<UNavigationSystemV1>(World->GetNavigationSystem()))
+		const FString Name = World->GetMapName();
+		const FString Path = FPaths::ProjectDir() / TEXT("Navmeshes");
+
+		// Build tiles in-process, navmesh lands where RecastDemo used to save it
+		FServerRecastExportOptions ExportOptions;
+		ExportOptions.bExportGeometryFile = false;
+		ExportOptions.NavMeshFileName = Path / Name;
+		ExportOptions.bWriteTilePack = true;
+		ExportOptions.LevelGeometryWeldEpsilon = 0.1f;
+		ExportOptions.TileCacheDir = FPaths::ProjectSavedDir() / TEXT("ServerRecast") / TEXT("TileCache");
+
+		// after the first export of this map only tiles touched by edits are rebuilt
+		if (DirtyTracker.IsTracking(World) && !DirtyTracker.NeedsFullExport())
 		{
-			NavSys->GetAbstractNavData();
-			if (ANavigationData* NavData = NavSys->GetDefaultNavDataInstance(FNavigationSystem::ECreateIfEmpty::Create))
+			ExportOptions.bIncrementalExport = true;
+			ExportOptions.DirtyBounds = DirtyTracker.GetDirtyBounds();
+		}
+		// only the snapshot is taken here, the rest runs in background
+		bool bUpToDate = false;
+		ActiveExport = FExportNavMesh::ExportWorldAsync(World, Path / Name, ExportOptions, FServerRecastAsyncExport::FOnCompleted::CreateRaw(this, &FServerRecastModule::OnExportCompleted), &bUpToDate);
+		if (!ActiveExport.IsValid())
+		{
+			if (bUpToDate)
 			{
-				const FString Name =  World->GetMapName() ;// "UE_ExportingLevel";//NavData->GetName();
-				const FString Path =  FPaths::ProjectPluginsDir() + "/ServerRecast/recastnavigation/RecastDemo/Bin/Meshes";
+				DirtyTracker.Reset(World);
+			}
 
-				FExportNavMesh* NewRecast = static_cast<FExportNavMesh*>(NavData->GetGenerator());
-				
-				// Export Landscape
-				NewRecast->MyExportNavigationData(FString::Printf(TEXT("%s/%s"), *Path, *Name));
+			FNotificationInfo Info(bUpToDate ? LOCTEXT("ExportUpToDate", "Navigation is up to date") : LOCTEXT("ExportNotStarted", "Navigation export failed, see log"));
+			Info.ExpireDuration = 3.f;
+			if (TSharedPtr<SNotificationItem> Notification = FSlateNotificationManager::Get().AddNotification(Info))
+			{
+				Notification->SetCompletionState(bUpToDate ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+			}
+			return;
+		}
 
-				// Create PathToExecutable. Adding "..." 
-				FString PathToExecutable = "\"" + FPaths::ProjectPluginsDir() + TEXT("ServerRecast/recastnavigation/RecastDemo/Bin/\" RecastDemo.exe");
-				PathToExecutable = PathToExecutable.Replace(TEXT("/"), TEXT("\\"), ESearchCase::IgnoreCase);
+		// edits made while export runs belong to the next one
+		DirtyTracker.Reset(World);
 
-				// Create SaveNavmeshPath
-				FString SaveNavmeshPath = FPaths::ProjectDir();
-				//SaveNavmeshPath.RemoveFromEnd(FApp::GetProjectName() + FString("/"));
-				SaveNavmeshPath = SaveNavmeshPath.Replace(TEXT("/"), TEXT("\\"), ESearchCase::IgnoreCase);
+		FNotificationInfo Info(LOCTEXT("ExportStarted", "Exporting navigation..."));
+		Info.bFireAndForget = false;
+		Info.ButtonDetails.Add(FNotificationButtonInfo(LOCTEXT("CancelExport", "Cancel"), LOCTEXT("CancelExportTooltip", "Stop navigation export, existing navmesh file is kept"),
+			FSimpleDelegate::CreateRaw(this, &FServerRecastModule::CancelExport), SNotificationItem::CS_Pending));
+		ExportNotification = FSlateNotificationManager::Get().AddNotification(Info);
+		if (ExportNotification.IsValid())
+		{
+			ExportNotification.Pin()->SetCompletionState(SNotificationItem::CS_Pending);
+		}
 
-				// Create PathToExecutable. SaveNavmeshPath haven't "...". It already adding to Sample_TileMesh 
-				FString EndCommand = TEXT("cmd /c start /D ") + PathToExecutable + TEXT(" 1 ") + Name + TEXT(".obj ") + Name + TEXT(".navmesh ") + "\"" + SaveNavmeshPath + TEXT("Navmeshes\\") ;
+		ExportTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FServerRecastModule::TickExportProgress), 0.25f);
+	}
+}
 
-				UE_LOG(LogTemp, Log, TEXT(" %s "), *EndCommand);
-				system(TCHAR_TO_ANSI(*EndCommand));
-				///FPlatformProcess::CreateProc(*PathToExecutable, NULL, true, false, false, NULL, 0, NULL, NULL);
-			}
+void FServerRecastModule::SaveBuiltNavMeshClicked()
+{
+	if (UWorld* World = GEditor->GetEditorWorldContext().World())
+	{
+		const FString Path = FPaths::ProjectDir() / TEXT("Navmeshes");
+		const bool bSuccess = FExportNavMesh::ExportBuiltNavMesh(World, Path / World->GetMapName(), true);
+
+		FNotificationInfo Info(bSuccess ? LOCTEXT("SaveBuiltSucceeded", "Built navmesh saved") : LOCTEXT("SaveBuiltFailed", "Built navmesh not saved, see log"));
+		Info.ExpireDuration = 3.f;
+		if (TSharedPtr<SNotificationItem> Notification = FSlateNotificationManager::Get().AddNotification(Info))
+		{
+			Notification->SetCompletionState(bSuccess ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
 		}
 	}
+}
+
+bool FServerRecastModule::CanExportNavigation() const
+{
+	return !ActiveExport.IsValid();
+}
+
+void FServerRecastModule::CancelExport()
+{
+	if (ActiveExport.IsValid())
+	{
+		ActiveExport->Cancel();
+	}
+	if (ExportNotification.IsValid())
+	{
+		ExportNotification.Pin()->SetText(LOCTEXT("ExportCancelling", "Cancelling navigation export..."));
+	}
+}
 
+bool FServerRecastModule::TickExportProgress(float DeltaTime)
+{
+	TSharedPtr<SNotificationItem> Notification = ExportNotification.Pin();
+	if (!ActiveExport.IsValid() || !Notification.IsValid())
+	{
+		return true;
+	}
+
+	const FServerRecastExportProgress& Progress = ActiveExport->GetProgress();
+	if (!Progress.IsCancelled())
+	{
+		Notification->SetText(FText::Format(LOCTEXT("ExportProgress", "Exporting navigation: {0} triangles, {1} tris/sec"),
+			FText::AsNumber(Progress.NumProcessedTris.GetValue()), FText::AsNumber((int64)Progress.GetTrisPerSecond())));
+	}
+	return true;
+}
+
+void FServerRecastModule::OnExportCompleted(bool bSuccess, bool bCancelled)
+{
+	FTicker::GetCoreTicker().RemoveTicker(ExportTickerHandle);
+	ExportTickerHandle.Reset();
+	ActiveExport.Reset();
+
+	// dirty bounds of a failed export are gone, next export rebuilds everything
+	if (!bSuccess)
+	{
+		DirtyTracker.Reset(nullptr);
+	}
+
+	if (TSharedPtr<SNotificationItem> Notification = ExportNotification.Pin())
+	{
+		const FText Text = bCancelled ? LOCTEXT("ExportCancelled", "Navigation export cancelled") :
+			bSuccess ? LOCTEXT("ExportSucceeded", "Navigation exported") : LOCTEXT("ExportFailed", "Navigation export failed, see log");
+		Notification->SetText(Text);
+		Notification->SetCompletionState(bSuccess ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+		Notification->ExpireAndFadeout();
+	}
+	ExportNotification.Reset();
 }
 
 
 void FServerRecastModule::AddMenuExtension(FMenuBuilder& Builder)
 {
 	Builder.AddMenuEntry(FServerRecastCommands::Get().PluginAction);
+	Builder.AddMenuEntry(FServerRecastCommands::Get().SaveBuiltNavMeshAction);
 }
 
 void FServerRecastModule::AddToolbarExtension(FToolBarBuilder& Builder)
@@ -0,0 +1,471 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastBenchmark.h"
+#include "Navmesh/RecastHelpers.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "NavigationSystem.h"
+#include "ServerRecastNavMeshBuilder.h"
+#include "ServerRecastTriangleFilter.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+FServerRecastBenchmark::FServerRecastBenchmark(const FServerRecastBenchmarkParams& InParams)
+	: Params(InParams)
+	, RecastBounds(ForceInit)
+	, TotalTime(0.)
+	, PeakUsedPhysical(0)
+{
+}
+
+template<typename FuncType>
+FServerRecastBenchmarkStage& FServerRecastBenchmark::RunStage(const TCHAR* Name, FuncType Func)
+{
+	const int64 UsedBefore = (int64)FPlatformMemory::GetStats().UsedPhysical;
+	const double StartTime = FPlatformTime::Seconds();
+
+	const int64 NumItems = Func();
+
+	FServerRecastBenchmarkStage& Stage = Stages[Stages.AddDefaulted()];
+	Stage.Name = Name;
+	Stage.Seconds = FPlatformTime::Seconds() - StartTime;
+	Stage.NumItems = NumItems;
+	Stage.OutputSize = 0;
+	Stage.MemoryDelta = (int64)FPlatformMemory::GetStats().UsedPhysical - UsedBefore;
+	return Stage;
+}
+
+bool FServerRecastBenchmark::Run(UWorld* World)
+{
+	Stages.Reset();
+	const double StartTime = FPlatformTime::Seconds();
+	IFileManager::Get().MakeDirectory(*Params.OutDir, true);
+
+	FServerRecastExportJob Job;
+	FServerRecastGatherSnapshot& Snapshot = Job.Snapshot;
+	if (World)
+	{
+		UNavigationSystemV1* NavSys = Cast<UNavigationSystemV1>(World->GetNavigationSystem());
+		ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::ECreateIfEmpty::Create) : nullptr;
+		if (NavData == nullptr || NavData->GetGenerator() == nullptr)
+		{
+			UE_LOG(LogNavigation, Error, TEXT("Benchmark: no navmesh generator in %s"), *World->GetMapName());
+			return false;
+		}
+
+		FServerRecastExportOptions Options;
+		Options.LevelGeometryWeldEpsilon = Params.LevelGeometryWeldEpsilon;
+
+		FExportNavMesh* Exporter = static_cast<FExportNavMesh*>(NavData->GetGenerator());
+		bool bGathered = false;
+		RunStage(TEXT("gather"), [&]() -> int64
+			{
+				bGathered = Exporter->GatherExportJob(Params.OutDir / TEXT("Benchmark"), Options, Job);
+				return Snapshot.NumIndices / 3;
+			});
+
+		if (!bGathered || Job.Agents.Num() == 0)
+		{
+			UE_LOG(LogNavigation, Error, TEXT("Benchmark: nothing to gather in %s"), *World->GetMapName());
+			return false;
+		}
+		Config = Job.Agents[0]->Config;
+		RecastBounds = Job.Agents[0]->RecastBounds;
+	}
+	else
+	{
+		MakeDefaultConfig(Config);
+		const float HalfSize = Params.WorldSize * 0.5f;
+		RecastBounds = Unreal2RecastBox(FBox(FVector(-HalfSize, -HalfSize, -1000.f), FVector(HalfSize, HalfSize, 1000.f)));
+	}
+
+	// generation is not timed, only the stages real exports go through
+	FRandomStream Random(Params.Seed);
+	TArray<FVector> Soup;
+	GenerateSoup(Random, Soup);
+	GeneratePrototypesAndInstances(Random, Snapshot);
+	GenerateAreas(Random, Snapshot);
+
+	RunStage(TEXT("soup_conversion"), [&]() -> int64
+		{
+			FServerRecastGatherSnapshot::FLevelGeometry& LevelGeometry = Snapshot.LevelGeometry[Snapshot.LevelGeometry.AddDefaulted()];
+			FExportNavMesh::TransformVertexSoupToRecast(Soup, LevelGeometry.Verts, LevelGeometry.Faces, Params.LevelGeometryWeldEpsilon);
+
+			LevelGeometry.CoordOffset = Snapshot.NumCoords;
+			LevelGeometry.IndexOffset = Snapshot.NumIndices;
+			Snapshot.NumCoords += LevelGeometry.Verts.Num() * 3;
+			Snapshot.NumIndices += LevelGeometry.Faces.Num();
+			return Soup.Num() / 3;
+		});
+	Soup.Empty();
+
+	TArray<FServerRecastAreaExportData> AreaExport;
+	RunStage(TEXT("area_grow"), [&]() -> int64
+		{
+			for (const FServerRecastAreaSource& AreaSource : Snapshot.AreaSources)
+			{
+				FServerRecastAreaExportData ExportInfo;
+				ExportInfo.AreaId = RECAST_DEFAULT_AREA;
+				ExportInfo.Convex = AreaSource.Convex;
+
+				TArray<FVector> ConvexVerts;
+				FExportNavMesh::GrowConvexHull(Config.AgentRadius, ExportInfo.Convex.Points, ConvexVerts);
+				if (ConvexVerts.Num())
+				{
+					ExportInfo.Convex.MinZ -= Config.ch;
+					ExportInfo.Convex.MaxZ += Config.ch;
+					ExportInfo.Convex.Points = ConvexVerts;
+					AreaExport.Add(ExportInfo);
+				}
+			}
+			return Snapshot.AreaSources.Num();
+		});
+
+	// what build and OBJ export do with every instance
+	RunStage(TEXT("instance_transform"), [&]() -> int64
+		{
+			TNavStatArray<float> ExpandedCoords;
+			TNavStatArray<int32> ExpandedIndices;
+			Snapshot.GetInstanceSet().Expand(nullptr, ExpandedCoords, ExpandedIndices);
+			Snapshot.GetHeightfieldSet().Expand(nullptr, ExpandedCoords, ExpandedIndices);
+			return ExpandedIndices.Num() / 3;
+		});
+
+	TNavStatArray<float> CoordBuffer;
+	TNavStatArray<int32> IndexBuffer;
+	RunStage(TEXT("geometry_buffers"), [&]() -> int64
+		{
+			FExportNavMesh::BuildGeometryBuffers(Snapshot, CoordBuffer, IndexBuffer);
+			return IndexBuffer.Num() / 3;
+		});
+
+	TArray<FBox> InclusionBounds;
+	InclusionBounds.Add(Recast2UnrealBox(RecastBounds));
+	const FServerRecastTriangleFilter TriangleFilter(Config, InclusionBounds, false);
+	FServerRecastTriangleFilterStats FilterStats;
+	RunStage(TEXT("triangle_filter"), [&]() -> int64
+		{
+			const int64 NumInput = IndexBuffer.Num() / 3;
+			TriangleFilter.FilterBuffer(CoordBuffer.GetData(), CoordBuffer.Num() / 3, IndexBuffer, FilterStats);
+			return NumInput;
+		});
+
+	const FString GeometryFileName = Params.OutDir / TEXT("Benchmark.srgeom");
+	bool bWritten = false;
+	RunStage(TEXT("serialization"), [&]() -> int64
+		{
+			bWritten = FExportNavMesh::ExportGeomToBinaryFile(GeometryFileName, RecastBounds, Config, CoordBuffer, IndexBuffer, AreaExport, &Snapshot, Params.bCompressFiles);
+			return IndexBuffer.Num() / 3;
+		}).OutputSize = IFileManager::Get().FileSize(*(Params.bCompressFiles ? GeometryFileName + TEXT("z") : GeometryFileName));
+
+	if (!bWritten)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Benchmark: failed to write %s"), *GeometryFileName);
+		return false;
+	}
+
+	if (Params.bBuildNavMesh)
+	{
+		TArray<FServerRecastGeometryFileArea> Areas;
+		TArray<float> AreaPoints;
+		FExportNavMesh::FlattenAreaExport(AreaExport, Areas, AreaPoints);
+
+		FServerRecastBuildInput BuildInput;
+		BuildInput.Config = Config;
+		BuildInput.Bounds = RecastBounds;
+		BuildInput.Coords = CoordBuffer.GetData();
+		BuildInput.NumVerts = CoordBuffer.Num() / 3;
+		BuildInput.Tris = IndexBuffer.GetData();
+		BuildInput.NumTris = IndexBuffer.Num() / 3;
+		BuildInput.Instances = Snapshot.GetInstanceSet();
+		BuildInput.Heightfields = Snapshot.GetHeightfieldSet();
+		BuildInput.Areas = Areas.GetData();
+		BuildInput.NumAreas = Areas.Num();
+		BuildInput.AreaPoints = AreaPoints.GetData();
+
+		FServerRecastNavMeshBuilder Builder(BuildInput);
+		bool bBuilt = false;
+		RunStage(TEXT("build"), [&]() -> int64
+			{
+				bBuilt = Builder.Build(Params.NumBuildWorkers);
+
+				int64 NumRasterizedTris = 0;
+				for (const FServerRecastTileBuildStats& TileStats : Builder.GetTileStats())
+				{
+					NumRasterizedTris += TileStats.NumTris;
+				}
+				return NumRasterizedTris;
+			});
+
+		const FString NavMeshFileName = Params.OutDir / TEXT("Benchmark.navmesh");
+		bool bSaved = false;
+		RunStage(TEXT("navmesh_save"), [&]() -> int64
+			{
+				bSaved = bBuilt && Builder.Save(NavMeshFileName);
+				return Builder.GetTileStats().Num();
+			}).OutputSize = bBuilt ? IFileManager::Get().FileSize(*NavMeshFileName) : 0;
+
+		if (!bSaved)
+		{
+			UE_LOG(LogNavigation, Error, TEXT("Benchmark: navmesh build failed"));
+			return false;
+		}
+
+		// same navmesh from pre-rasterized tiles, build time without rasterization
+		if (Params.bVoxelize)
+		{
+			const FString VoxelFileName = Params.OutDir / TEXT("Benchmark.srvox");
+			bool bVoxelized = false;
+			RunStage(TEXT("voxelize"), [&]() -> int64
+				{
+					FServerRecastNavMeshBuilder Voxelizer(BuildInput);
+					bVoxelized = Voxelizer.Voxelize(VoxelFileName, Params.NumBuildWorkers);
+					return Voxelizer.GetTileGrid().GetNumTiles();
+				}).OutputSize = IFileManager::Get().FileSize(*VoxelFileName);
+
+			FServerRecastGeometryFileView VoxelView;
+			if (!bVoxelized || !VoxelView.Open(VoxelFileName))
+			{
+				UE_LOG(LogNavigation, Error, TEXT("Benchmark: failed to write %s"), *VoxelFileName);
+				return false;
+			}
+
+			FServerRecastBuildInput VoxelInput;
+			VoxelInput.InitFromFile(VoxelView);
+			FServerRecastNavMeshBuilder VoxelBuilder(VoxelInput);
+			bool bVoxelBuilt = false;
+			RunStage(TEXT("build_from_voxels"), [&]() -> int64
+				{
+					bVoxelBuilt = VoxelBuilder.Build(Params.NumBuildWorkers);
+					return VoxelInput.VoxelTiles.Num();
+				});
+
+			if (!bVoxelBuilt)
+			{
+				UE_LOG(LogNavigation, Error, TEXT("Benchmark: navmesh build from %s failed"), *VoxelFileName);
+				return false;
+			}
+		}
+	}
+
+	TotalTime = FPlatformTime::Seconds() - StartTime;
+	PeakUsedPhysical = FPlatformMemory::GetStats().PeakUsedPhysical;
+	return true;
+}
+
+void FServerRecastBenchmark::MakeDefaultConfig(FRecastBuildConfig& OutConfig) const
+{
+	// same derivation as FRecastNavMeshGenerator::ConfigureBuildProperties for a default navmesh
+	const ARecastNavMesh* NavMeshDefaults = GetDefault<ARecastNavMesh>();
+	const float CellSize = NavMeshDefaults->CellSize;
+	const float CellHeight = NavMeshDefaults->CellHeight;
+
+	OutConfig = FRecastBuildConfig();
+	OutConfig.cs = CellSize;
+	OutConfig.ch = CellHeight;
+	OutConfig.walkableSlopeAngle = NavMeshDefaults->AgentMaxSlope;
+	OutConfig.walkableHeight = FMath::CeilToInt(NavMeshDefaults->AgentHeight / CellHeight);
+	OutConfig.walkableClimb = FMath::CeilToInt(NavMeshDefaults->AgentMaxStepHeight / CellHeight);
+	OutConfig.walkableRadius = FMath::CeilToInt(NavMeshDefaults->AgentRadius / CellSize);
+
+	OutConfig.AgentHeight = NavMeshDefaults->AgentHeight;
+	OutConfig.AgentMaxClimb = NavMeshDefaults->AgentMaxStepHeight;
+	OutConfig.AgentRadius = NavMeshDefaults->AgentRadius;
+
+	OutConfig.borderSize = OutConfig.walkableRadius + 3;
+	OutConfig.maxEdgeLen = (int32)(1200.f / CellSize);
+	OutConfig.maxSimplificationError = NavMeshDefaults->MaxSimplificationError;
+	OutConfig.minRegionArea = (int32)FMath::Square(NavMeshDefaults->MinRegionArea / CellSize);
+	OutConfig.mergeRegionArea = (int32)FMath::Square(NavMeshDefaults->MergeRegionSize / CellSize);
+	OutConfig.maxVertsPerPoly = 6;
+	OutConfig.detailSampleDist = 600.f;
+	OutConfig.detailSampleMaxError = 1.f;
+	OutConfig.bPerformVoxelFiltering = NavMeshDefaults->bPerformVoxelFiltering;
+	OutConfig.bGenerateDetailedMesh = true;
+	OutConfig.MaxPolysPerTile = 0;
+
+	OutConfig.tileSize = FMath::Max(FMath::TruncToInt(NavMeshDefaults->TileSizeUU / CellSize), 1);
+	OutConfig.width = OutConfig.tileSize + OutConfig.borderSize * 2;
+	OutConfig.height = OutConfig.tileSize + OutConfig.borderSize * 2;
+}
+
+void FServerRecastBenchmark::GenerateSoup(FRandomStream& Random, TArray<FVector>& OutSoup) const
+{
+	const int32 NumQuads = FMath::DivideAndRoundUp(Params.NumSoupTris, 2);
+	if (NumQuads <= 0)
+	{
+		return;
+	}
+
+	const int32 GridSize = FMath::Max(FMath::CeilToInt(FMath::Sqrt((float)NumQuads)), 1);
+	const float QuadSize = Params.WorldSize / GridSize;
+	const float HalfSize = Params.WorldSize * 0.5f;
+
+	// heights live on grid points so neighbouring quads share edges
+	TArray<float> Heights;
+	Heights.SetNumUninitialized((GridSize + 1) * (GridSize + 1));
+	for (float& Height : Heights)
+	{
+		Height = Random.FRandRange(-20.f, 20.f);
+	}
+
+	auto GridPoint = [&](int32 X, int32 Y)
+	{
+		return FVector(-HalfSize + X * QuadSize, -HalfSize + Y * QuadSize, Heights[Y * (GridSize + 1) + X]);
+	};
+
+	OutSoup.Reserve(NumQuads * 6);
+	for (int32 QuadIndex = 0; QuadIndex < NumQuads; ++QuadIndex)
+	{
+		const int32 X = QuadIndex % GridSize;
+		const int32 Y = QuadIndex / GridSize;
+
+		// counter clockwise seen from above, faces up once converted to recast
+		OutSoup.Add(GridPoint(X, Y));
+		OutSoup.Add(GridPoint(X + 1, Y));
+		OutSoup.Add(GridPoint(X, Y + 1));
+		if (OutSoup.Num() / 3 < Params.NumSoupTris)
+		{
+			OutSoup.Add(GridPoint(X + 1, Y));
+			OutSoup.Add(GridPoint(X + 1, Y + 1));
+			OutSoup.Add(GridPoint(X, Y + 1));
+		}
+	}
+}
+
+void FServerRecastBenchmark::GeneratePrototypesAndInstances(FRandomStream& Random, FServerRecastGatherSnapshot& Snapshot) const
+{
+	if (Params.NumPrototypes <= 0 || Params.NumInstances <= 0)
+	{
+		return;
+	}
+
+	// box faces as corner quads, counter clockwise seen from outside, corner bits are X, Y, Z
+	static const int32 BoxQuads[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+
+	const int32 FirstPrototype = Snapshot.Prototypes.Num();
+	for (int32 PrototypeIndex = 0; PrototypeIndex < Params.NumPrototypes; ++PrototypeIndex)
+	{
+		const FVector Extent(Random.FRandRange(50.f, 300.f), Random.FRandRange(50.f, 300.f), Random.FRandRange(50.f, 400.f));
+
+		float Verts[8 * 3];
+		for (int32 Corner = 0; Corner < 8; ++Corner)
+		{
+			const FVector LocalCorner = Unreal2RecastPoint(FVector(
+				(Corner & 1) ? Extent.X : -Extent.X,
+				(Corner & 2) ? Extent.Y : -Extent.Y,
+				(Corner & 4) ? Extent.Z * 2.f : 0.f));
+			Verts[Corner * 3 + 0] = LocalCorner.X;
+			Verts[Corner * 3 + 1] = LocalCorner.Y;
+			Verts[Corner * 3 + 2] = LocalCorner.Z;
+		}
+
+		// reversed like TransformVertexSoupToRecast does, so tops are walkable
+		int32 Indices[12 * 3];
+		for (int32 Face = 0; Face < 6; ++Face)
+		{
+			const int32* Quad = BoxQuads[Face];
+			int32* Tri = Indices + Face * 6;
+			Tri[0] = Quad[2]; Tri[1] = Quad[1]; Tri[2] = Quad[0];
+			Tri[3] = Quad[3]; Tri[4] = Quad[2]; Tri[5] = Quad[0];
+		}
+
+		FExportNavMesh::AddPrototype(Snapshot, Verts, 8, Indices, 12);
+	}
+
+	const float HalfSize = Params.WorldSize * 0.5f;
+	Snapshot.Instances.Reserve(Snapshot.Instances.Num() + Params.NumInstances);
+	for (int32 InstanceIndex = 0; InstanceIndex < Params.NumInstances; ++InstanceIndex)
+	{
+		const FVector Location(Random.FRandRange(-HalfSize, HalfSize), Random.FRandRange(-HalfSize, HalfSize), 0.f);
+		const FRotator Rotation(0.f, Random.FRandRange(0.f, 360.f), 0.f);
+		const FTransform InstanceTransform(Rotation, Location, FVector(Random.FRandRange(0.8f, 1.2f)));
+		FExportNavMesh::AddInstance(Snapshot, FirstPrototype + Random.RandHelper(Params.NumPrototypes), InstanceTransform);
+	}
+}
+
+void FServerRecastBenchmark::GenerateAreas(FRandomStream& Random, FServerRecastGatherSnapshot& Snapshot) const
+{
+	const float HalfSize = Params.WorldSize * 0.5f;
+	for (int32 AreaIndex = 0; AreaIndex < Params.NumAreas; ++AreaIndex)
+	{
+		const FVector Center(Random.FRandRange(-HalfSize, HalfSize), Random.FRandRange(-HalfSize, HalfSize), 0.f);
+		const float Yaw = Random.FRandRange(0.f, 2.f * PI);
+		const FVector AxisX = FVector(FMath::Cos(Yaw), FMath::Sin(Yaw), 0.f) * Random.FRandRange(50.f, 300.f);
+		const FVector AxisY = FVector(-FMath::Sin(Yaw), FMath::Cos(Yaw), 0.f) * Random.FRandRange(50.f, 300.f);
+
+		FServerRecastAreaSource& AreaSource = Snapshot.AreaSources[Snapshot.AreaSources.AddDefaulted()];
+		AreaSource.Convex.MinZ = -50.f;
+		AreaSource.Convex.MaxZ = 250.f;
+		AreaSource.Convex.Points.Add(Center - AxisX - AxisY);
+		AreaSource.Convex.Points.Add(Center + AxisX - AxisY);
+		AreaSource.Convex.Points.Add(Center + AxisX + AxisY);
+		AreaSource.Convex.Points.Add(Center - AxisX + AxisY);
+	}
+}
+
+void FServerRecastBenchmark::LogReport() const
+{
+	for (const FServerRecastBenchmarkStage& Stage : Stages)
+	{
+		UE_LOG(LogNavigation, Display, TEXT("%-20s %9.3f sec %12lld items %14.0f items/sec %12lld bytes %+12lld memory"),
+			*Stage.Name, Stage.Seconds, Stage.NumItems, Stage.GetItemsPerSecond(), Stage.OutputSize, Stage.MemoryDelta);
+	}
+	UE_LOG(LogNavigation, Display, TEXT("Benchmark total %.3f sec, peak used physical %llu MB"), TotalTime, PeakUsedPhysical / (1024 * 1024));
+}
+
+bool FServerRecastBenchmark::SaveReport(const FString& FileName) const
+{
+	TSharedRef<FJsonObject> ParamsObject = MakeShareable(new FJsonObject());
+	ParamsObject->SetNumberField(TEXT("seed"), Params.Seed);
+	ParamsObject->SetNumberField(TEXT("prototypes"), Params.NumPrototypes);
+	ParamsObject->SetNumberField(TEXT("instances"), Params.NumInstances);
+	ParamsObject->SetNumberField(TEXT("soup_tris"), Params.NumSoupTris);
+	ParamsObject->SetNumberField(TEXT("areas"), Params.NumAreas);
+	ParamsObject->SetNumberField(TEXT("world_size"), Params.WorldSize);
+	ParamsObject->SetNumberField(TEXT("weld_epsilon"), Params.LevelGeometryWeldEpsilon);
+	ParamsObject->SetNumberField(TEXT("build_workers"), Params.NumBuildWorkers);
+	ParamsObject->SetBoolField(TEXT("build_navmesh"), Params.bBuildNavMesh);
+	ParamsObject->SetBoolField(TEXT("compress"), Params.bCompressFiles);
+
+	TSharedRef<FJsonObject> ConfigObject = MakeShareable(new FJsonObject());
+	ConfigObject->SetNumberField(TEXT("cell_size"), Config.cs);
+	ConfigObject->SetNumberField(TEXT("cell_height"), Config.ch);
+	ConfigObject->SetNumberField(TEXT("tile_size"), Config.tileSize);
+	ConfigObject->SetNumberField(TEXT("agent_radius"), Config.AgentRadius);
+	ConfigObject->SetNumberField(TEXT("agent_height"), Config.AgentHeight);
+
+	TArray<TSharedPtr<FJsonValue>> StageValues;
+	for (const FServerRecastBenchmarkStage& Stage : Stages)
+	{
+		TSharedRef<FJsonObject> StageObject = MakeShareable(new FJsonObject());
+		StageObject->SetStringField(TEXT("name"), Stage.Name);
+		StageObject->SetNumberField(TEXT("seconds"), Stage.Seconds);
+		StageObject->SetNumberField(TEXT("items"), (double)Stage.NumItems);
+		StageObject->SetNumberField(TEXT("items_per_second"), Stage.GetItemsPerSecond());
+		StageObject->SetNumberField(TEXT("output_size"), (double)Stage.OutputSize);
+		StageObject->SetNumberField(TEXT("memory_delta"), (double)Stage.MemoryDelta);
+		StageValues.Add(MakeShareable(new FJsonValueObject(StageObject)));
+	}
+
+	TSharedRef<FJsonObject> Root = MakeShareable(new FJsonObject());
+	Root->SetStringField(TEXT("cpu"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	Root->SetNumberField(TEXT("cores"), FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	Root->SetObjectField(TEXT("params"), ParamsObject);
+	Root->SetObjectField(TEXT("config"), ConfigObject);
+	Root->SetArrayField(TEXT("stages"), StageValues);
+	Root->SetNumberField(TEXT("total_seconds"), TotalTime);
+	Root->SetNumberField(TEXT("peak_used_physical"), (double)PeakUsedPhysical);
+
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (!FJsonSerializer::Serialize(Root, Writer) || !FFileHelper::SaveStringToFile(Output, *FileName))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Benchmark: failed to write %s"), *FileName);
+		return false;
+	}
+
+	UE_LOG(LogNavigation, Display, TEXT("Benchmark report saved to %s"), *FileName);
+	return true;
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastBenchmarkCommandlet.h"
+#include "ServerRecastBenchmark.h"
+#include "ServerRecastExportCommandlet.h"
+#include "Engine/World.h"
+#include "Misc/Paths.h"
+
+UServerRecastBenchmarkCommandlet::UServerRecastBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UServerRecastBenchmarkCommandlet::Main(const FString& Params)
+{
+	FServerRecastBenchmarkParams BenchmarkParams;
+	FParse::Value(*Params, TEXT("Seed="), BenchmarkParams.Seed);
+	FParse::Value(*Params, TEXT("Prototypes="), BenchmarkParams.NumPrototypes);
+	FParse::Value(*Params, TEXT("Instances="), BenchmarkParams.NumInstances);
+	FParse::Value(*Params, TEXT("SoupTris="), BenchmarkParams.NumSoupTris);
+	FParse::Value(*Params, TEXT("Areas="), BenchmarkParams.NumAreas);
+	FParse::Value(*Params, TEXT("WorldSize="), BenchmarkParams.WorldSize);
+	FParse::Value(*Params, TEXT("Weld="), BenchmarkParams.LevelGeometryWeldEpsilon);
+	FParse::Value(*Params, TEXT("Workers="), BenchmarkParams.NumBuildWorkers);
+	BenchmarkParams.bBuildNavMesh = !FParse::Param(*Params, TEXT("NoBuild"));
+	BenchmarkParams.bCompressFiles = FParse::Param(*Params, TEXT("Compress"));
+	BenchmarkParams.bVoxelize = FParse::Param(*Params, TEXT("Voxelize"));
+
+	BenchmarkParams.OutDir = FPaths::ProjectSavedDir() / TEXT("ServerRecastBenchmark");
+	FParse::Value(*Params, TEXT("Out="), BenchmarkParams.OutDir);
+
+	FString ReportFileName = BenchmarkParams.OutDir / FString::Printf(TEXT("Benchmark_%s.json"), *FDateTime::Now().ToString());
+	FParse::Value(*Params, TEXT("Report="), ReportFileName);
+
+	UWorld* World = nullptr;
+	FString MapName;
+	if (FParse::Value(*Params, TEXT("Map="), MapName))
+	{
+		World = UServerRecastExportCommandlet::LoadWorld(MapName);
+		if (World == nullptr)
+		{
+			return 1;
+		}
+	}
+
+	FServerRecastBenchmark Benchmark(BenchmarkParams);
+	const bool bSuccess = Benchmark.Run(World);
+
+	if (World)
+	{
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+		CollectGarbage(RF_NoFlags);
+	}
+
+	if (!bSuccess)
+	{
+		return 1;
+	}
+
+	Benchmark.LogReport();
+	return Benchmark.SaveReport(ReportFileName) ? 0 : 1;
+}
@@ -7,6 +7,7 @@
 void FServerRecastCommands::RegisterCommands()
 {
 	UI_COMMAND(PluginAction, "ServerRecast", "Execute ServerRecast action", EUserInterfaceActionType::Button, FInputGesture());
+	UI_COMMAND(SaveBuiltNavMeshAction, "ServerRecast: Save Built Navmesh", "Save navmesh tiles already built by the editor without rebuilding them", EUserInterfaceActionType::Button, FInputGesture());
 }
 
 #undef LOCTEXT_NAMESPACE
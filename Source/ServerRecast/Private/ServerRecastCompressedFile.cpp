@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastCompressedFile.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Misc/Compression.h"
+
+FServerRecastCompressedFileReader::FServerRecastCompressedFileReader()
+	: File(nullptr)
+{
+	FMemory::Memzero(Header);
+}
+
+FServerRecastCompressedFileReader::~FServerRecastCompressedFileReader()
+{
+	Close();
+}
+
+bool FServerRecastCompressedFileReader::Open(const FString& FileName)
+{
+	Close();
+
+	File = FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FileName);
+	if (File == nullptr)
+	{
+		return false;
+	}
+
+	// offsets are compared by subtracting from known sizes, crafted values can't wrap the sums
+	const uint64 FileSize = FMath::Max<int64>(File->Size(), 0);
+	if (!File->Read((uint8*)&Header, sizeof(Header)) ||
+		Header.Magic != SERVERRECAST_COMPRESSED_MAGIC || Header.Version != SERVERRECAST_COMPRESSED_VERSION ||
+		Header.ChunkSize == 0 || Header.ChunkSize > SERVERRECAST_COMPRESSED_MAX_CHUNK_SIZE ||
+		Header.NumChunks > (uint32)MAX_int32 || Header.TableOffset < sizeof(Header) || Header.TableOffset > FileSize ||
+		(uint64)Header.NumChunks * sizeof(FServerRecastCompressedChunk) > FileSize - Header.TableOffset)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("%s is not a valid compressed file"), *FileName);
+		Close();
+		return false;
+	}
+
+	Chunks.SetNumUninitialized(Header.NumChunks);
+	if (!File->Seek(Header.TableOffset) || !File->Read((uint8*)Chunks.GetData(), Chunks.Num() * sizeof(FServerRecastCompressedChunk)))
+	{
+		Close();
+		return false;
+	}
+
+	// chunks may be shorter than ChunkSize, writer flushes before a record would cross the chunk end.
+	// They are stored back to back from the header to the table, batches are read with one call
+	uint64 CompressedOffset = sizeof(Header);
+	uint64 UncompressedOffset = 0;
+	UncompressedOffsets.SetNumUninitialized(Chunks.Num());
+	for (int32 Index = 0; Index < Chunks.Num(); ++Index)
+	{
+		const FServerRecastCompressedChunk& Chunk = Chunks[Index];
+		if (Chunk.Offset != CompressedOffset || Chunk.CompressedSize > Header.TableOffset - Chunk.Offset ||
+			Chunk.UncompressedSize > Header.ChunkSize || Chunk.CompressedSize > Chunk.UncompressedSize)
+		{
+			UE_LOG(LogNavigation, Error, TEXT("%s has a corrupted chunk table"), *FileName);
+			Close();
+			return false;
+		}
+		UncompressedOffsets[Index] = UncompressedOffset;
+		UncompressedOffset += Chunk.UncompressedSize;
+		CompressedOffset += Chunk.CompressedSize;
+	}
+
+	if (UncompressedOffset != Header.UncompressedSize || CompressedOffset != Header.TableOffset)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("%s has a corrupted chunk table"), *FileName);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void FServerRecastCompressedFileReader::Close()
+{
+	delete File;
+	File = nullptr;
+	FMemory::Memzero(Header);
+	Chunks.Empty();
+	UncompressedOffsets.Empty();
+	CompressedScratch.Empty();
+}
+
+bool FServerRecastCompressedFileReader::DecodeBatch(int32 FirstChunk, int32 NumChunks, TFunctionRef<uint8*(int32 ChunkIndex)> Dest)
+{
+	// chunks are stored back to back, one read covers the whole batch
+	const FServerRecastCompressedChunk& First = Chunks[FirstChunk];
+	const FServerRecastCompressedChunk& Last = Chunks[FirstChunk + NumChunks - 1];
+	const int64 BatchSize = Last.Offset + Last.CompressedSize - First.Offset;
+	if (BatchSize > MAX_int32)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Compressed batch of %lld bytes is too big, decode fewer chunks at once"), BatchSize);
+		return false;
+	}
+
+	CompressedScratch.SetNumUninitialized(BatchSize, false);
+	if (!File->Seek(First.Offset) || !File->Read(CompressedScratch.GetData(), BatchSize))
+	{
+		return false;
+	}
+
+	FThreadSafeBool bFailed = false;
+	ParallelFor(NumChunks, [&](int32 Index)
+		{
+			const FServerRecastCompressedChunk& Chunk = Chunks[FirstChunk + Index];
+			const uint8* Src = CompressedScratch.GetData() + (Chunk.Offset - First.Offset);
+			uint8* Dst = Dest(FirstChunk + Index);
+
+			if (Chunk.CompressedSize == Chunk.UncompressedSize)
+			{
+				FMemory::Memcpy(Dst, Src, Chunk.UncompressedSize);
+			}
+			else if (!FCompression::UncompressMemory(COMPRESS_ZLIB, Dst, Chunk.UncompressedSize, Src, Chunk.CompressedSize))
+			{
+				bFailed = true;
+			}
+		});
+
+	return !bFailed;
+}
+
+bool FServerRecastCompressedFileReader::Decompress(TFunctionRef<bool(const uint8* Data, int32 Size)> Consumer, int32 ChunksPerBatch)
+{
+	if (File == nullptr)
+	{
+		return false;
+	}
+
+	ChunksPerBatch = ChunksPerBatch > 0 ? ChunksPerBatch : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	// decode buffer is a plain TArray
+	ChunksPerBatch = FMath::Max(1, FMath::Min<int32>(ChunksPerBatch, MAX_int32 / Header.ChunkSize));
+
+	TArray<uint8> Uncompressed;
+	Uncompressed.SetNumUninitialized((int64)ChunksPerBatch * Header.ChunkSize);
+
+	for (int32 FirstChunk = 0; FirstChunk < Chunks.Num(); FirstChunk += ChunksPerBatch)
+	{
+		const int32 NumChunks = FMath::Min(ChunksPerBatch, Chunks.Num() - FirstChunk);
+		const bool bDecoded = DecodeBatch(FirstChunk, NumChunks, [&](int32 ChunkIndex)
+			{
+				return Uncompressed.GetData() + (int64)(ChunkIndex - FirstChunk) * Header.ChunkSize;
+			});
+		if (!bDecoded)
+		{
+			return false;
+		}
+
+		for (int32 Index = 0; Index < NumChunks; ++Index)
+		{
+			if (!Consumer(Uncompressed.GetData() + (int64)Index * Header.ChunkSize, Chunks[FirstChunk + Index].UncompressedSize))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool FServerRecastCompressedFileReader::DecompressToMemory(TArray<uint8>& OutData)
+{
+	if (File == nullptr)
+	{
+		return false;
+	}
+
+	if (Header.UncompressedSize > (uint64)MAX_int32)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Compressed file is too big to decode in memory, use Decompress"));
+		return false;
+	}
+	OutData.SetNumUninitialized(Header.UncompressedSize);
+
+	// bound the compressed scratch buffer, same as streaming
+	const int32 ChunksPerBatch = FMath::Max(1, FMath::Min<int32>(4 * (FTaskGraphInterface::Get().GetNumWorkerThreads() + 1), MAX_int32 / Header.ChunkSize));
+	for (int32 FirstChunk = 0; FirstChunk < Chunks.Num(); FirstChunk += ChunksPerBatch)
+	{
+		const int32 NumChunks = FMath::Min(ChunksPerBatch, Chunks.Num() - FirstChunk);
+		const bool bDecoded = DecodeBatch(FirstChunk, NumChunks, [&](int32 ChunkIndex)
+			{
+				return OutData.GetData() + UncompressedOffsets[ChunkIndex];
+			});
+		if (!bDecoded)
+		{
+			OutData.Empty();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FServerRecastCompressedFileReader::IsCompressedFile(const FString& FileName)
+{
+	TUniquePtr<IFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FileName));
+	uint32 Magic = 0;
+	return Handle.IsValid() && Handle->Read((uint8*)&Magic, sizeof(Magic)) && Magic == SERVERRECAST_COMPRESSED_MAGIC;
+}
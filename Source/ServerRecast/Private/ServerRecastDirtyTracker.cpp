@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastDirtyTracker.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Components/PrimitiveComponent.h"
+#include "Editor.h"
+#include "NavMesh/NavMeshBoundsVolume.h"
+#include "NavigationData.h"
+#include "NavigationSystem.h"
+
+void FServerRecastDirtyTracker::Register()
+{
+	if (GEngine)
+	{
+		ActorAddedHandle = GEngine->OnLevelActorAdded().AddRaw(this, &FServerRecastDirtyTracker::OnActorAdded);
+		ActorDeletedHandle = GEngine->OnLevelActorDeleted().AddRaw(this, &FServerRecastDirtyTracker::OnActorDeleted);
+		ActorMovedHandle = GEngine->OnActorMoved().AddRaw(this, &FServerRecastDirtyTracker::OnActorMoved);
+	}
+	PropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &FServerRecastDirtyTracker::OnObjectPropertyChanged);
+	MapChangedHandle = FEditorDelegates::MapChange.AddRaw(this, &FServerRecastDirtyTracker::OnMapChanged);
+	NavigationDirtiedHandle = UNavigationSystemV1::NavigationDirtyEvent.AddRaw(this, &FServerRecastDirtyTracker::OnNavigationDirtied);
+}
+
+void FServerRecastDirtyTracker::Unregister()
+{
+	if (GEngine)
+	{
+		GEngine->OnLevelActorAdded().Remove(ActorAddedHandle);
+		GEngine->OnLevelActorDeleted().Remove(ActorDeletedHandle);
+		GEngine->OnActorMoved().Remove(ActorMovedHandle);
+	}
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(PropertyChangedHandle);
+	FEditorDelegates::MapChange.Remove(MapChangedHandle);
+	UNavigationSystemV1::NavigationDirtyEvent.Remove(NavigationDirtiedHandle);
+
+	TrackedWorld.Reset();
+	ActorBounds.Reset();
+	DirtyBounds.Reset();
+	bNeedsFullExport = false;
+}
+
+void FServerRecastDirtyTracker::Reset(UWorld* World)
+{
+	TrackedWorld = World;
+	ActorBounds.Reset();
+	DirtyBounds.Reset();
+	bNeedsFullExport = false;
+
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	// without the octree navigation system dirties nothing, landscape and foliage edits would go unnoticed
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+	if (NavSys == nullptr || NavSys->GetNavOctree() == nullptr)
+	{
+		bNeedsFullExport = true;
+	}
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		FBox Bounds;
+		if (GetActorNavigationBounds(*It, Bounds))
+		{
+			ActorBounds.Add(*It, Bounds);
+		}
+	}
+}
+
+void FServerRecastDirtyTracker::OnActorAdded(AActor* Actor)
+{
+	MarkActorDirty(Actor, false);
+}
+
+void FServerRecastDirtyTracker::OnActorDeleted(AActor* Actor)
+{
+	MarkActorDirty(Actor, true);
+}
+
+void FServerRecastDirtyTracker::OnActorMoved(AActor* Actor)
+{
+	MarkActorDirty(Actor, false);
+}
+
+void FServerRecastDirtyTracker::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	AActor* Actor = Cast<AActor>(Object);
+	if (Actor == nullptr)
+	{
+		const UActorComponent* Component = Cast<UActorComponent>(Object);
+		Actor = Component ? Component->GetOwner() : nullptr;
+	}
+
+	if (Actor)
+	{
+		MarkActorDirty(Actor, false);
+	}
+}
+
+void FServerRecastDirtyTracker::OnMapChanged(uint32 MapChangeFlags)
+{
+	// nothing is known about the new map until it is exported once
+	TrackedWorld.Reset();
+	ActorBounds.Reset();
+	DirtyBounds.Reset();
+	bNeedsFullExport = false;
+}
+
+void FServerRecastDirtyTracker::OnNavigationDirtied(const FBox& Bounds)
+{
+	// event doesn't tell the world, PIE worlds dirty navigation all the time
+	if (!TrackedWorld.IsValid() || !Bounds.IsValid || (GEditor && GEditor->PlayWorld))
+	{
+		return;
+	}
+
+	DirtyBounds.AddUnique(Bounds);
+}
+
+void FServerRecastDirtyTracker::MarkActorDirty(AActor* Actor, bool bRemoved)
+{
+	if (Actor == nullptr || !TrackedWorld.IsValid() || Actor->GetWorld() != TrackedWorld.Get())
+	{
+		return;
+	}
+
+	// tile grid or build settings change, actor bounds don't tell which tiles
+	if (Actor->IsA<ANavMeshBoundsVolume>() || Actor->IsA<ANavigationData>())
+	{
+		bNeedsFullExport = true;
+		return;
+	}
+
+	if (const FBox* OldBounds = ActorBounds.Find(Actor))
+	{
+		DirtyBounds.AddUnique(*OldBounds);
+	}
+
+	FBox NewBounds;
+	if (!bRemoved && GetActorNavigationBounds(Actor, NewBounds))
+	{
+		DirtyBounds.AddUnique(NewBounds);
+		ActorBounds.Add(Actor, NewBounds);
+	}
+	else
+	{
+		ActorBounds.Remove(Actor);
+	}
+}
+
+bool FServerRecastDirtyTracker::GetActorNavigationBounds(const AActor* Actor, FBox& OutBounds)
+{
+	OutBounds.Init();
+	for (const UActorComponent* Component : Actor->GetComponents())
+	{
+		const UPrimitiveComponent* Primitive = Cast<const UPrimitiveComponent>(Component);
+		if (Primitive && Primitive->IsRegistered() && Primitive->CanEverAffectNavigation())
+		{
+			OutBounds += Primitive->Bounds.GetBox();
+		}
+	}
+	return OutBounds.IsValid != 0;
+}
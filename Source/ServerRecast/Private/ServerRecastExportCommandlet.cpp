@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastExportCommandlet.h"
+#include "ExportNavMesh.h"
+#include "Engine/World.h"
+#include "Engine/LevelStreaming.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+
+UServerRecastExportCommandlet::UServerRecastExportCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UServerRecastExportCommandlet::Main(const FString& Params)
+{
+	FString MapName;
+	if (!FParse::Value(*Params, TEXT("Map="), MapName))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecastExport: -Map=<map> is required"));
+		return 1;
+	}
+
+	FString OutDir = FPaths::ProjectDir() / TEXT("Navmeshes");
+	FParse::Value(*Params, TEXT("Out="), OutDir);
+
+	UWorld* World = LoadWorld(MapName);
+	if (World == nullptr)
+	{
+		return 1;
+	}
+
+	const FString FileBaseName = OutDir / World->GetMapName();
+
+	// tiles saved with the map are written as they are
+	if (FParse::Param(*Params, TEXT("FromBuiltNavMesh")))
+	{
+		const bool bSaved = FExportNavMesh::ExportBuiltNavMesh(World, FileBaseName, FParse::Param(*Params, TEXT("TilePack")));
+
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+		CollectGarbage(RF_NoFlags);
+
+		return bSaved ? 0 : 1;
+	}
+
+	FServerRecastExportOptions ExportOptions;
+	ExportOptions.bExportGeometryFile = FParse::Param(*Params, TEXT("Geometry"));
+	ExportOptions.bExportDebugOBJ = FParse::Param(*Params, TEXT("OBJ"));
+	ExportOptions.bCompressFiles = FParse::Param(*Params, TEXT("Compress"));
+	ExportOptions.bWriteTileBuildReport = FParse::Param(*Params, TEXT("TileReport"));
+	ExportOptions.bTiledGeometryFile = FParse::Param(*Params, TEXT("Tiled"));
+	ExportOptions.bCullUnwalkableTriangles = FParse::Param(*Params, TEXT("CullUnwalkable"));
+	ExportOptions.bWriteExportReport = !FParse::Param(*Params, TEXT("NoReport"));
+	ExportOptions.bExportLandscapeHeightfields = !FParse::Param(*Params, TEXT("LandscapeTriangles"));
+	ExportOptions.bExportVoxelTiles = FParse::Param(*Params, TEXT("Voxelize"));
+	ExportOptions.bWriteTilePack = FParse::Param(*Params, TEXT("TilePack"));
+	ExportOptions.bBuildTileGraph = FParse::Param(*Params, TEXT("TileGraph"));
+	ExportOptions.NavMeshFileName = FileBaseName;
+	FParse::Value(*Params, TEXT("Workers="), ExportOptions.NumBuildWorkers);
+	FParse::Value(*Params, TEXT("Weld="), ExportOptions.LevelGeometryWeldEpsilon);
+	ExportOptions.TileCacheDir = FPaths::ProjectSavedDir() / TEXT("ServerRecast") / TEXT("TileCache");
+	FParse::Value(*Params, TEXT("TileCache="), ExportOptions.TileCacheDir);
+	int64 TileCacheSizeMB = 0;
+	if (FParse::Value(*Params, TEXT("TileCacheSizeMB="), TileCacheSizeMB))
+	{
+		ExportOptions.TileCacheMaxSize = TileCacheSizeMB * 1024 * 1024;
+	}
+	if (FParse::Param(*Params, TEXT("NoTileCache")))
+	{
+		ExportOptions.TileCacheDir.Empty();
+	}
+
+	const bool bSuccess = FExportNavMesh::ExportWorld(World, FileBaseName, ExportOptions);
+
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	CollectGarbage(RF_NoFlags);
+
+	return bSuccess ? 0 : 1;
+}
+
+UWorld* UServerRecastExportCommandlet::LoadWorld(const FString& MapName)
+{
+	FString PackageName = MapName;
+	if (FPackageName::IsShortPackageName(PackageName) && !FPackageName::SearchForPackageOnDisk(MapName, &PackageName))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecastExport: map %s not found"), *MapName);
+		return nullptr;
+	}
+
+	UPackage* Package = LoadPackage(nullptr, *PackageName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (World == nullptr)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecastExport: failed to load world from %s"), *PackageName);
+		return nullptr;
+	}
+
+	World->AddToRoot();
+	World->WorldType = EWorldType::Editor;
+
+	if (!World->bIsWorldInitialized)
+	{
+		UWorld::InitializationValues IVS;
+		IVS.RequiresHitProxies(false)
+			.ShouldSimulatePhysics(false)
+			.EnableTraceCollision(false)
+			.CreateNavigation(true)
+			.CreateAISystem(false)
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(true);
+		World->InitWorld(IVS);
+	}
+
+	// geometry of sublevels goes to navigation octree only when they are loaded and visible
+	for (ULevelStreaming* StreamingLevel : World->GetStreamingLevels())
+	{
+		if (StreamingLevel)
+		{
+			StreamingLevel->SetShouldBeLoaded(true);
+			StreamingLevel->SetShouldBeVisible(true);
+		}
+	}
+	World->FlushLevelStreaming();
+	World->UpdateWorldComponents(true, false);
+
+	// editor mode registers navigation data and fills the octree without running a build
+	FNavigationSystem::AddNavigationSystemToWorld(*World, FNavigationSystemRunMode::EditorMode);
+	if (UNavigationSystemV1* NavSys = Cast<UNavigationSystemV1>(World->GetNavigationSystem()))
+	{
+		for (ANavigationData* NavData : NavSys->NavDataSet)
+		{
+			if (NavData)
+			{
+				NavData->ConditionalConstructGenerator();
+			}
+		}
+	}
+
+	return World;
+}
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastExportReport.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "Misc/FileHelper.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+FServerRecastAgentExportReport::FServerRecastAgentExportReport()
+	: bIncremental(false)
+	, bTiled(false)
+	, bSuccess(false)
+	, FilteredIndexBytes(0)
+	, GeometryFileSize(0)
+	, OBJFileSize(0)
+	, NavMeshFileSize(0)
+	, VoxelFileSize(0)
+	, TilePackFileSize(0)
+	, TileGraphFileSize(0)
+	, NumBuiltTiles(0)
+	, NumRasterizedTris(0)
+	, NumTileCacheHits(0)
+	, NumTileCacheMisses(0)
+	, FilterTime(0.)
+	, WriteGeometryTime(0.)
+	, WriteOBJTime(0.)
+	, WriteTiledGeometryTime(0.)
+	, VoxelizeTime(0.)
+	, BuildTime(0.)
+	, SaveTime(0.)
+	, TileGraphTime(0.)
+	, TotalTime(0.)
+{
+}
+
+FServerRecastExportReport::FServerRecastExportReport()
+	: bSuccess(false)
+	, bCancelled(false)
+	, NumElements(0)
+	, NumLevelGeometry(0)
+	, NumPrototypes(0)
+	, NumInstances(0)
+	, NumAreas(0)
+	, NumHeightfields(0)
+	, NumHeightfieldSamples(0)
+	, NumTris(0)
+	, NumInstanceTris(0)
+	, GeometryBufferBytes(0)
+	, GeometryBufferPeakBytes(0)
+	, GatherTime(0.)
+	, AreaGrowTime(0.)
+	, GeometryBuffersTime(0.)
+	, TotalTime(0.)
+{
+}
+
+void FServerRecastExportReport::Log() const
+{
+	UE_LOG(LogNavigation, Log, TEXT("Export %s: %d elements, %d instances of %d prototypes, %d heightfields, %lld triangles, %lld instance triangles, buffers peak %lld KB"),
+		*MapName, NumElements, NumInstances, NumPrototypes, NumHeightfields, NumTris, NumInstanceTris, GeometryBufferPeakBytes / 1024);
+	UE_LOG(LogNavigation, Log, TEXT("Export %s: gather %.3f, area grow %.3f, geometry buffers %.3f, total %.3f sec"),
+		*MapName, GatherTime, AreaGrowTime, GeometryBuffersTime, TotalTime);
+
+	for (const FServerRecastAgentExportReport& Agent : Agents)
+	{
+		UE_LOG(LogNavigation, Log, TEXT("%s: filter %.3f, geometry file %.3f, OBJ %.3f, tiled file %.3f, voxelize %.3f, build %.3f, save %.3f, tile graph %.3f sec, %lld bytes written, tile cache %d hits %d misses"),
+			*Agent.NavDataName, Agent.FilterTime, Agent.WriteGeometryTime, Agent.WriteOBJTime, Agent.WriteTiledGeometryTime, Agent.VoxelizeTime, Agent.BuildTime, Agent.SaveTime, Agent.TileGraphTime, Agent.GetBytesWritten(),
+			Agent.NumTileCacheHits, Agent.NumTileCacheMisses);
+	}
+}
+
+bool FServerRecastExportReport::Save(const FString& FileName) const
+{
+	TArray<TSharedPtr<FJsonValue>> AgentValues;
+	for (const FServerRecastAgentExportReport& Agent : Agents)
+	{
+		TSharedRef<FJsonObject> PhasesObject = MakeShareable(new FJsonObject());
+		PhasesObject->SetNumberField(TEXT("filter"), Agent.FilterTime);
+		PhasesObject->SetNumberField(TEXT("write_geometry"), Agent.WriteGeometryTime);
+		PhasesObject->SetNumberField(TEXT("write_obj"), Agent.WriteOBJTime);
+		PhasesObject->SetNumberField(TEXT("write_tiled_geometry"), Agent.WriteTiledGeometryTime);
+		PhasesObject->SetNumberField(TEXT("voxelize"), Agent.VoxelizeTime);
+		PhasesObject->SetNumberField(TEXT("build"), Agent.BuildTime);
+		PhasesObject->SetNumberField(TEXT("save"), Agent.SaveTime);
+		PhasesObject->SetNumberField(TEXT("tile_graph"), Agent.TileGraphTime);
+		PhasesObject->SetNumberField(TEXT("total"), Agent.TotalTime);
+
+		TSharedRef<FJsonObject> AgentObject = MakeShareable(new FJsonObject());
+		AgentObject->SetStringField(TEXT("name"), Agent.NavDataName);
+		AgentObject->SetBoolField(TEXT("incremental"), Agent.bIncremental);
+		AgentObject->SetBoolField(TEXT("tiled"), Agent.bTiled);
+		AgentObject->SetBoolField(TEXT("success"), Agent.bSuccess);
+		AgentObject->SetNumberField(TEXT("input_tris"), Agent.FilterStats.NumInput);
+		AgentObject->SetNumberField(TEXT("culled_tris"), Agent.FilterStats.GetNumCulled());
+		AgentObject->SetNumberField(TEXT("culled_outside_bounds"), Agent.FilterStats.NumOutsideBounds);
+		AgentObject->SetNumberField(TEXT("culled_degenerate"), Agent.FilterStats.NumDegenerate);
+		AgentObject->SetNumberField(TEXT("culled_unwalkable"), Agent.FilterStats.NumUnwalkable);
+		AgentObject->SetNumberField(TEXT("filtered_index_bytes"), (double)Agent.FilteredIndexBytes);
+		AgentObject->SetNumberField(TEXT("built_tiles"), Agent.NumBuiltTiles);
+		AgentObject->SetNumberField(TEXT("rasterized_tris"), (double)Agent.NumRasterizedTris);
+		AgentObject->SetNumberField(TEXT("tile_cache_hits"), Agent.NumTileCacheHits);
+		AgentObject->SetNumberField(TEXT("tile_cache_misses"), Agent.NumTileCacheMisses);
+		AgentObject->SetNumberField(TEXT("geometry_file_bytes"), (double)Agent.GeometryFileSize);
+		AgentObject->SetNumberField(TEXT("obj_file_bytes"), (double)Agent.OBJFileSize);
+		AgentObject->SetNumberField(TEXT("navmesh_file_bytes"), (double)Agent.NavMeshFileSize);
+		AgentObject->SetNumberField(TEXT("voxel_file_bytes"), (double)Agent.VoxelFileSize);
+		AgentObject->SetNumberField(TEXT("tile_pack_bytes"), (double)Agent.TilePackFileSize);
+		AgentObject->SetNumberField(TEXT("tile_graph_bytes"), (double)Agent.TileGraphFileSize);
+		AgentObject->SetNumberField(TEXT("bytes_written"), (double)Agent.GetBytesWritten());
+		AgentObject->SetObjectField(TEXT("seconds"), PhasesObject);
+		AgentValues.Add(MakeShareable(new FJsonValueObject(AgentObject)));
+	}
+
+	TSharedRef<FJsonObject> PhasesObject = MakeShareable(new FJsonObject());
+	PhasesObject->SetNumberField(TEXT("gather"), GatherTime);
+	PhasesObject->SetNumberField(TEXT("area_grow"), AreaGrowTime);
+	PhasesObject->SetNumberField(TEXT("geometry_buffers"), GeometryBuffersTime);
+	PhasesObject->SetNumberField(TEXT("total"), TotalTime);
+
+	TSharedRef<FJsonObject> Root = MakeShareable(new FJsonObject());
+	Root->SetStringField(TEXT("map"), MapName);
+	Root->SetBoolField(TEXT("success"), bSuccess);
+	Root->SetBoolField(TEXT("cancelled"), bCancelled);
+	Root->SetNumberField(TEXT("elements"), NumElements);
+	Root->SetNumberField(TEXT("level_geometry"), NumLevelGeometry);
+	Root->SetNumberField(TEXT("prototypes"), NumPrototypes);
+	Root->SetNumberField(TEXT("instances"), NumInstances);
+	Root->SetNumberField(TEXT("areas"), NumAreas);
+	Root->SetNumberField(TEXT("heightfields"), NumHeightfields);
+	Root->SetNumberField(TEXT("heightfield_samples"), (double)NumHeightfieldSamples);
+	Root->SetNumberField(TEXT("tris"), (double)NumTris);
+	Root->SetNumberField(TEXT("instance_tris"), (double)NumInstanceTris);
+	Root->SetNumberField(TEXT("geometry_buffer_bytes"), (double)GeometryBufferBytes);
+	Root->SetNumberField(TEXT("geometry_buffer_peak_bytes"), (double)GeometryBufferPeakBytes);
+	Root->SetObjectField(TEXT("seconds"), PhasesObject);
+	Root->SetArrayField(TEXT("agents"), AgentValues);
+
+	FString Output;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (!FJsonSerializer::Serialize(Root, Writer) || !FFileHelper::SaveStringToFile(Output, *FileName))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to write export report %s"), *FileName);
+		return false;
+	}
+	return true;
+}
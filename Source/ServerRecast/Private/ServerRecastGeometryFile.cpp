@@ -0,0 +1,655 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastGeometryFile.h"
+#include "ServerRecastStreamWriter.h"
+#include "ServerRecastCompressedFile.h"
+#include "NavMesh/RecastNavMeshGenerator.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+
+void FServerRecastGeometryFileConfig::Init(const FRecastBuildConfig& Config)
+{
+	AgentHeight = Config.AgentHeight;
+	AgentRadius = Config.AgentRadius;
+	CellSize = Config.cs;
+	CellHeight = Config.ch;
+	AgentMaxClimb = Config.AgentMaxClimb;
+	AgentMaxSlope = Config.walkableSlopeAngle;
+	RegionMinSize = (int32)FMath::Sqrt(Config.minRegionArea);
+	RegionMergeSize = (int32)FMath::Sqrt(Config.mergeRegionArea);
+	MaxEdgeLen = Config.maxEdgeLen;
+	bPerformVoxelFiltering = Config.bPerformVoxelFiltering;
+	bGenerateDetailedMesh = Config.bGenerateDetailedMesh;
+	MaxPolysPerTile = Config.MaxPolysPerTile;
+	MaxVertsPerPoly = Config.maxVertsPerPoly;
+	TileSize = Config.tileSize;
+
+	WalkableHeight = Config.walkableHeight;
+	WalkableClimb = Config.walkableClimb;
+	WalkableRadius = Config.walkableRadius;
+	BorderSize = Config.borderSize;
+	MinRegionArea = Config.minRegionArea;
+	MergeRegionArea = Config.mergeRegionArea;
+	MaxSimplificationError = Config.maxSimplificationError;
+	DetailSampleDist = Config.detailSampleDist;
+	DetailSampleMaxError = Config.detailSampleMaxError;
+}
+
+void FServerRecastGeometryFileConfig::ToRecastConfig(FRecastBuildConfig& OutConfig) const
+{
+	OutConfig.AgentHeight = AgentHeight;
+	OutConfig.AgentRadius = AgentRadius;
+	OutConfig.AgentMaxClimb = AgentMaxClimb;
+	OutConfig.cs = CellSize;
+	OutConfig.ch = CellHeight;
+	OutConfig.walkableSlopeAngle = AgentMaxSlope;
+	OutConfig.maxEdgeLen = MaxEdgeLen;
+	OutConfig.bPerformVoxelFiltering = bPerformVoxelFiltering != 0;
+	OutConfig.bGenerateDetailedMesh = bGenerateDetailedMesh != 0;
+	OutConfig.MaxPolysPerTile = MaxPolysPerTile;
+	OutConfig.maxVertsPerPoly = MaxVertsPerPoly;
+	OutConfig.tileSize = TileSize;
+
+	OutConfig.walkableHeight = WalkableHeight;
+	OutConfig.walkableClimb = WalkableClimb;
+	OutConfig.walkableRadius = WalkableRadius;
+	OutConfig.borderSize = BorderSize;
+	OutConfig.minRegionArea = MinRegionArea;
+	OutConfig.mergeRegionArea = MergeRegionArea;
+	OutConfig.maxSimplificationError = MaxSimplificationError;
+	OutConfig.detailSampleDist = DetailSampleDist;
+	OutConfig.detailSampleMaxError = DetailSampleMaxError;
+
+	OutConfig.width = TileSize + BorderSize * 2;
+	OutConfig.height = TileSize + BorderSize * 2;
+}
+
+bool FServerRecastHeightfieldSet::GetHeight(const FServerRecastGeometryFileHeightfield& Heightfield, float X, float Z, float& OutHeight, bool& bOutHole) const
+{
+	if (Heightfield.NumRows < 2 || Heightfield.NumCols < 2)
+	{
+		return false;
+	}
+
+	const float GridRow = (X - Heightfield.Origin[0]) / Heightfield.StepX;
+	const float GridCol = (Z - Heightfield.Origin[2]) / Heightfield.StepZ;
+	if (GridRow < 0.f || GridCol < 0.f || GridRow > Heightfield.NumRows - 1 || GridCol > Heightfield.NumCols - 1)
+	{
+		return false;
+	}
+
+	const int32 Row = FMath::Min(FMath::FloorToInt(GridRow), Heightfield.NumRows - 2);
+	const int32 Col = FMath::Min(FMath::FloorToInt(GridCol), Heightfield.NumCols - 2);
+	const float U = GridRow - Row;
+	const float V = GridCol - Col;
+
+	const float H00 = GetSampleHeight(Heightfield, Row, Col);
+	const float H01 = GetSampleHeight(Heightfield, Row, Col + 1);
+	const float H10 = GetSampleHeight(Heightfield, Row + 1, Col);
+	const float H11 = GetSampleHeight(Heightfield, Row + 1, Col + 1);
+
+	if (IsSplit(Heightfield, Row, Col))
+	{
+		OutHeight = U >= V ? H00 + U * (H10 - H00) + V * (H11 - H10) : H00 + V * (H01 - H00) + U * (H11 - H01);
+	}
+	else
+	{
+		OutHeight = U + V <= 1.f ? H00 + U * (H10 - H00) + V * (H01 - H00) : H11 + (1.f - U) * (H01 - H11) + (1.f - V) * (H10 - H11);
+	}
+
+	bOutHole = IsHole(Heightfield, Row, Col);
+	return true;
+}
+
+FServerRecastGeometryFileWriter::FServerRecastGeometryFileWriter(const FBox& InRecastBounds, const FRecastBuildConfig& InConfig)
+	: MaxStreamTableSize(0)
+{
+	FMemory::Memzero(Header);
+	Header.Magic = SERVERRECAST_GEOMFILE_MAGIC;
+	Header.Version = SERVERRECAST_GEOMFILE_VERSION;
+	Header.HeaderSize = sizeof(FServerRecastGeometryFileHeader);
+
+	Header.BoundsMin[0] = InRecastBounds.Min.X;
+	Header.BoundsMin[1] = InRecastBounds.Min.Y;
+	Header.BoundsMin[2] = InRecastBounds.Min.Z;
+	Header.BoundsMax[0] = InRecastBounds.Max.X;
+	Header.BoundsMax[1] = InRecastBounds.Max.Y;
+	Header.BoundsMax[2] = InRecastBounds.Max.Z;
+
+	Header.Config.Init(InConfig);
+}
+
+FServerRecastGeometryFileWriter::~FServerRecastGeometryFileWriter()
+{
+	if (Stream.IsValid())
+	{
+		Stream->Close();
+	}
+}
+
+void FServerRecastGeometryFileWriter::AddSection(EServerRecastGeometrySection::Type Type, const void* Data, uint64 Size, uint32 Count)
+{
+	FPendingSection& Section = Sections[Sections.AddZeroed()];
+	Section.Desc.Type = Type;
+	Section.Desc.Size = Size;
+	Section.Desc.Count = Count;
+	Section.Data = Data;
+}
+
+bool FServerRecastGeometryFileWriter::Write(const FString& FileName, bool bCompress) const
+{
+	FServerRecastGeometryFileHeader FinalHeader = Header;
+	FinalHeader.NumSections = Sections.Num();
+
+	TArray<FServerRecastGeometryFileSection> SectionTable;
+	SectionTable.Reserve(Sections.Num());
+
+	uint64 Offset = Align(sizeof(FServerRecastGeometryFileHeader) + sizeof(FServerRecastGeometryFileSection) * Sections.Num(), SERVERRECAST_GEOMFILE_ALIGNMENT);
+	for (const FPendingSection& Section : Sections)
+	{
+		FServerRecastGeometryFileSection Desc = Section.Desc;
+		Desc.Offset = Offset;
+		SectionTable.Add(Desc);
+
+		Offset = Align(Offset + Desc.Size, SERVERRECAST_GEOMFILE_ALIGNMENT);
+	}
+
+	FServerRecastStreamWriter Writer;
+	if (!Writer.Open(FileName, bCompress))
+	{
+		return false;
+	}
+
+	static const uint8 Zeros[SERVERRECAST_GEOMFILE_ALIGNMENT] = { 0 };
+
+	Writer.Write(&FinalHeader, sizeof(FinalHeader));
+	Writer.Write(SectionTable.GetData(), sizeof(FServerRecastGeometryFileSection) * SectionTable.Num());
+	for (int32 Index = 0; Index < Sections.Num(); ++Index)
+	{
+		const int64 Padding = SectionTable[Index].Offset - Writer.Tell();
+		check(Padding >= 0 && Padding < SERVERRECAST_GEOMFILE_ALIGNMENT);
+		Writer.Write(Zeros, Padding);
+		Writer.Write(Sections[Index].Data, SectionTable[Index].Size);
+	}
+
+	const bool bSuccess = Writer.Close();
+	if (!bSuccess)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to write %s"), *FileName);
+	}
+	return bSuccess;
+}
+
+bool FServerRecastGeometryFileWriter::BeginStream(const FString& FileName, int32 MaxStreamedSections)
+{
+	check(!Stream.IsValid());
+
+	Stream = MakeUnique<FServerRecastStreamWriter>();
+	if (!Stream->Open(FileName, false))
+	{
+		Stream.Reset();
+		return false;
+	}
+	StreamFileName = FileName;
+	MaxStreamTableSize = Sections.Num() + MaxStreamedSections;
+	StreamTable.Reset(MaxStreamTableSize);
+
+	// placeholder header and table, real ones are written by EndStream
+	const int64 TableEnd = sizeof(FServerRecastGeometryFileHeader) + sizeof(FServerRecastGeometryFileSection) * MaxStreamTableSize;
+	TArray<uint8> Placeholder;
+	Placeholder.SetNumZeroed(TableEnd);
+	Stream->Write(Placeholder.GetData(), Placeholder.Num());
+
+	bool bSuccess = true;
+	for (const FPendingSection& Section : Sections)
+	{
+		bSuccess = bSuccess && StreamSection((EServerRecastGeometrySection::Type)Section.Desc.Type, Section.Data, Section.Desc.Size, Section.Desc.Count);
+	}
+	Sections.Empty();
+
+	return bSuccess;
+}
+
+void FServerRecastGeometryFileWriter::WritePadding()
+{
+	static const uint8 Zeros[SERVERRECAST_GEOMFILE_ALIGNMENT] = { 0 };
+	const int64 Position = Stream->Tell();
+	Stream->Write(Zeros, Align(Position, SERVERRECAST_GEOMFILE_ALIGNMENT) - Position);
+}
+
+bool FServerRecastGeometryFileWriter::StreamSection(EServerRecastGeometrySection::Type Type, const void* Data, uint64 Size, uint32 Count)
+{
+	check(Stream.IsValid());
+	if (StreamTable.Num() >= MaxStreamTableSize)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to write %s, more than %d sections"), *StreamFileName, MaxStreamTableSize);
+		return false;
+	}
+
+	WritePadding();
+
+	FServerRecastGeometryFileSection& Desc = StreamTable[StreamTable.AddZeroed()];
+	Desc.Offset = Stream->Tell();
+	Desc.Size = Size;
+	Desc.Type = Type;
+	Desc.Count = Count;
+
+	Stream->Write(Data, Size);
+	return !Stream->HasFailed();
+}
+
+bool FServerRecastGeometryFileWriter::EndStream()
+{
+	check(Stream.IsValid());
+
+	// unused table slots stay zeroed after the real entries, NumSections skips them
+	FServerRecastGeometryFileHeader FinalHeader = Header;
+	FinalHeader.NumSections = StreamTable.Num();
+
+	TArray<uint8> Head;
+	Head.Append((const uint8*)&FinalHeader, sizeof(FinalHeader));
+	Head.Append((const uint8*)StreamTable.GetData(), sizeof(FServerRecastGeometryFileSection) * StreamTable.Num());
+
+	const bool bSuccess = Stream->Close(Head.GetData(), Head.Num());
+	Stream.Reset();
+	StreamTable.Empty();
+
+	if (!bSuccess)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to write %s"), *StreamFileName);
+	}
+	return bSuccess;
+}
+
+FServerRecastGeometryFileView::FServerRecastGeometryFileView()
+	: MappedHandle(nullptr)
+	, MappedRegion(nullptr)
+	, Data(nullptr)
+	, DataSize(0)
+{
+}
+
+FServerRecastGeometryFileView::~FServerRecastGeometryFileView()
+{
+	Close();
+}
+
+bool FServerRecastGeometryFileView::Open(const FString& FileName)
+{
+	Close();
+
+	// compressed container is decoded in parallel, mapping makes no sense there
+	FServerRecastCompressedFileReader CompressedReader;
+	const bool bCompressed = FServerRecastCompressedFileReader::IsCompressedFile(FileName);
+	if (!bCompressed)
+	{
+		MappedHandle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FileName);
+		if (MappedHandle)
+		{
+			MappedRegion = MappedHandle->MapRegion();
+		}
+	}
+
+	if (bCompressed)
+	{
+		if (CompressedReader.Open(FileName) && CompressedReader.DecompressToMemory(LoadedData))
+		{
+			Data = LoadedData.GetData();
+			DataSize = LoadedData.Num();
+		}
+	}
+	else if (MappedRegion)
+	{
+		Data = MappedRegion->GetMappedPtr();
+		DataSize = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedData, *FileName))
+	{
+		Data = LoadedData.GetData();
+		DataSize = LoadedData.Num();
+	}
+
+	if (!Validate())
+	{
+		UE_LOG(LogNavigation, Error, TEXT("%s is not a valid ServerRecast geometry file"), *FileName);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void FServerRecastGeometryFileView::Close()
+{
+	delete MappedRegion;
+	MappedRegion = nullptr;
+	delete MappedHandle;
+	MappedHandle = nullptr;
+
+	LoadedData.Empty();
+	Data = nullptr;
+	DataSize = 0;
+}
+
+bool FServerRecastGeometryFileView::Validate() const
+{
+	if (Data == nullptr || DataSize < (int64)sizeof(FServerRecastGeometryFileHeader))
+	{
+		return false;
+	}
+
+	const FServerRecastGeometryFileHeader& Header = GetHeader();
+	if (Header.Magic != SERVERRECAST_GEOMFILE_MAGIC || Header.Version != SERVERRECAST_GEOMFILE_VERSION || Header.HeaderSize != sizeof(FServerRecastGeometryFileHeader))
+	{
+		return false;
+	}
+
+	const int64 TableEnd = sizeof(FServerRecastGeometryFileHeader) + (int64)sizeof(FServerRecastGeometryFileSection) * Header.NumSections;
+	if (TableEnd > DataSize)
+	{
+		return false;
+	}
+
+	const FServerRecastGeometryFileSection* SectionTable = (const FServerRecastGeometryFileSection*)(Data + sizeof(FServerRecastGeometryFileHeader));
+	for (uint32 Index = 0; Index < Header.NumSections; ++Index)
+	{
+		const FServerRecastGeometryFileSection& Section = SectionTable[Index];
+		// Offset + Size may wrap for a crafted table
+		if (Section.Offset % SERVERRECAST_GEOMFILE_ALIGNMENT != 0 || Section.Offset > (uint64)DataSize || Section.Size > (uint64)DataSize - Section.Offset)
+		{
+			return false;
+		}
+	}
+
+	// builder indexes global geometry without checks
+	uint32 NumVerts = 0, NumTris = 0, NumAreas = 0, NumAreaPoints = 0;
+	uint64 VertsSize = 0, TrisSize = 0, AreasSize = 0, AreaPointsSize = 0;
+	FindSection(EServerRecastGeometrySection::Vertices, &NumVerts, &VertsSize);
+	const int32* Tris = (const int32*)FindSection(EServerRecastGeometrySection::Triangles, &NumTris, &TrisSize);
+	const FServerRecastGeometryFileArea* Areas = (const FServerRecastGeometryFileArea*)FindSection(EServerRecastGeometrySection::Areas, &NumAreas, &AreasSize);
+	FindSection(EServerRecastGeometrySection::AreaPoints, &NumAreaPoints, &AreaPointsSize);
+	if (NumVerts > MAX_int32 / 3 || NumTris > MAX_int32 / 3 || NumAreas > MAX_int32 || NumAreaPoints > MAX_int32 / 3 ||
+		(uint64)NumVerts * 3 * sizeof(float) > VertsSize ||
+		(uint64)NumTris * 3 * sizeof(int32) > TrisSize ||
+		(uint64)NumAreas * sizeof(FServerRecastGeometryFileArea) > AreasSize ||
+		(uint64)NumAreaPoints * 3 * sizeof(float) > AreaPointsSize)
+	{
+		return false;
+	}
+
+	for (uint32 Index = 0; Tris && Index < NumTris * 3; ++Index)
+	{
+		if ((uint32)Tris[Index] >= NumVerts)
+		{
+			return false;
+		}
+	}
+
+	for (uint32 Index = 0; Areas && Index < NumAreas; ++Index)
+	{
+		if (Areas[Index].FirstPoint < 0 || Areas[Index].NumPoints < 0 || (int64)Areas[Index].FirstPoint + Areas[Index].NumPoints > NumAreaPoints)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const void* FServerRecastGeometryFileView::FindSection(EServerRecastGeometrySection::Type Type, uint32* OutCount, uint64* OutSize) const
+{
+	if (Data == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FServerRecastGeometryFileHeader& Header = GetHeader();
+	const FServerRecastGeometryFileSection* SectionTable = (const FServerRecastGeometryFileSection*)(Data + sizeof(FServerRecastGeometryFileHeader));
+	for (uint32 Index = 0; Index < Header.NumSections; ++Index)
+	{
+		if (SectionTable[Index].Type == Type)
+		{
+			if (OutCount)
+			{
+				*OutCount = SectionTable[Index].Count;
+			}
+			if (OutSize)
+			{
+				*OutSize = SectionTable[Index].Size;
+			}
+			return Data + SectionTable[Index].Offset;
+		}
+	}
+
+	return nullptr;
+}
+
+const float* FServerRecastGeometryFileView::GetVertices(int32& OutNumVerts) const
+{
+	uint32 Count = 0;
+	const void* Section = FindSection(EServerRecastGeometrySection::Vertices, &Count);
+	OutNumVerts = Count;
+	return (const float*)Section;
+}
+
+const int32* FServerRecastGeometryFileView::GetTriangles(int32& OutNumTris) const
+{
+	uint32 Count = 0;
+	const void* Section = FindSection(EServerRecastGeometrySection::Triangles, &Count);
+	OutNumTris = Count;
+	return (const int32*)Section;
+}
+
+const FServerRecastGeometryFileArea* FServerRecastGeometryFileView::GetAreas(int32& OutNumAreas) const
+{
+	uint32 Count = 0;
+	const void* Section = FindSection(EServerRecastGeometrySection::Areas, &Count);
+	OutNumAreas = Count;
+	return (const FServerRecastGeometryFileArea*)Section;
+}
+
+const float* FServerRecastGeometryFileView::GetAreaPoints(int32& OutNumPoints) const
+{
+	uint32 Count = 0;
+	const void* Section = FindSection(EServerRecastGeometrySection::AreaPoints, &Count);
+	OutNumPoints = Count;
+	return (const float*)Section;
+}
+
+FServerRecastInstanceSet FServerRecastGeometryFileView::GetInstanceSet() const
+{
+	FServerRecastInstanceSet InstanceSet;
+
+	uint32 NumInstances = 0, NumPrototypes = 0, NumVerts = 0, NumTris = 0;
+	uint64 InstancesSize = 0, PrototypesSize = 0, VertsSize = 0, TrisSize = 0;
+	InstanceSet.Instances = (const FServerRecastGeometryFileInstance*)FindSection(EServerRecastGeometrySection::Instances, &NumInstances, &InstancesSize);
+	InstanceSet.Prototypes = (const FServerRecastGeometryFilePrototype*)FindSection(EServerRecastGeometrySection::Prototypes, &NumPrototypes, &PrototypesSize);
+	InstanceSet.Verts = (const float*)FindSection(EServerRecastGeometrySection::PrototypeVertices, &NumVerts, &VertsSize);
+	InstanceSet.Tris = (const int32*)FindSection(EServerRecastGeometrySection::PrototypeTriangles, &NumTris, &TrisSize);
+
+	const bool bComplete = InstanceSet.Instances && InstanceSet.Prototypes && InstanceSet.Verts && InstanceSet.Tris;
+	if (bComplete && !ValidateInstanceSet(InstanceSet, NumInstances, NumPrototypes, NumVerts, NumTris, InstancesSize, PrototypesSize, VertsSize, TrisSize))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Instance table of ServerRecast geometry file is corrupt, instances are skipped"));
+		return FServerRecastInstanceSet();
+	}
+	InstanceSet.NumInstances = bComplete ? NumInstances : 0;
+
+	return InstanceSet;
+}
+
+bool FServerRecastGeometryFileView::ValidateInstanceSet(const FServerRecastInstanceSet& InstanceSet, uint32 NumInstances, uint32 NumPrototypes, uint32 NumVerts, uint32 NumTris,
+	uint64 InstancesSize, uint64 PrototypesSize, uint64 VertsSize, uint64 TrisSize)
+{
+	if (NumInstances > MAX_int32 || NumPrototypes > MAX_int32 || NumVerts > MAX_int32 / 3 || NumTris > MAX_int32 / 3 ||
+		(uint64)NumInstances * sizeof(FServerRecastGeometryFileInstance) > InstancesSize ||
+		(uint64)NumPrototypes * sizeof(FServerRecastGeometryFilePrototype) > PrototypesSize ||
+		(uint64)NumVerts * 3 * sizeof(float) > VertsSize ||
+		(uint64)NumTris * 3 * sizeof(int32) > TrisSize)
+	{
+		return false;
+	}
+
+	// prototype ranges and their local indices are used to index the shared vertex and triangle sections
+	for (uint32 PrototypeIndex = 0; PrototypeIndex < NumPrototypes; ++PrototypeIndex)
+	{
+		const FServerRecastGeometryFilePrototype& Prototype = InstanceSet.Prototypes[PrototypeIndex];
+		if (Prototype.FirstVert < 0 || Prototype.NumVerts < 0 || (int64)Prototype.FirstVert + Prototype.NumVerts > NumVerts ||
+			Prototype.FirstTri < 0 || Prototype.NumTris < 0 || (int64)Prototype.FirstTri + Prototype.NumTris > NumTris)
+		{
+			return false;
+		}
+
+		const int32* PrototypeTris = InstanceSet.Tris + Prototype.FirstTri * 3;
+		for (int32 Index = 0; Index < Prototype.NumTris * 3; ++Index)
+		{
+			if (PrototypeTris[Index] < 0 || PrototypeTris[Index] >= Prototype.NumVerts)
+			{
+				return false;
+			}
+		}
+	}
+
+	for (uint32 InstanceIndex = 0; InstanceIndex < NumInstances; ++InstanceIndex)
+	{
+		if ((uint32)InstanceSet.Instances[InstanceIndex].PrototypeIndex >= NumPrototypes)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+FServerRecastHeightfieldSet FServerRecastGeometryFileView::GetHeightfieldSet() const
+{
+	FServerRecastHeightfieldSet HeightfieldSet;
+
+	uint32 NumHeightfields = 0, NumSamples = 0, NumMaskWords = 0;
+	uint64 HeightfieldsSize = 0, SamplesSize = 0, MasksSize = 0;
+	HeightfieldSet.Heightfields = (const FServerRecastGeometryFileHeightfield*)FindSection(EServerRecastGeometrySection::Heightfields, &NumHeightfields, &HeightfieldsSize);
+	HeightfieldSet.Samples = (const int16*)FindSection(EServerRecastGeometrySection::HeightfieldSamples, &NumSamples, &SamplesSize);
+	HeightfieldSet.Masks = (const uint32*)FindSection(EServerRecastGeometrySection::HeightfieldMasks, &NumMaskWords, &MasksSize);
+
+	const bool bComplete = HeightfieldSet.Heightfields && HeightfieldSet.Samples && HeightfieldSet.Masks;
+	if (bComplete && !ValidateHeightfieldSet(HeightfieldSet, NumHeightfields, NumSamples, NumMaskWords, HeightfieldsSize, SamplesSize, MasksSize))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Heightfield table of ServerRecast geometry file is corrupt, heightfields are skipped"));
+		return FServerRecastHeightfieldSet();
+	}
+	HeightfieldSet.NumHeightfields = bComplete ? NumHeightfields : 0;
+
+	return HeightfieldSet;
+}
+
+bool FServerRecastGeometryFileView::ValidateHeightfieldSet(const FServerRecastHeightfieldSet& HeightfieldSet, uint32 NumHeightfields, uint32 NumSamples, uint32 NumMaskWords,
+	uint64 HeightfieldsSize, uint64 SamplesSize, uint64 MasksSize)
+{
+	if (NumHeightfields > MAX_int32 || NumSamples > MAX_int32 || NumMaskWords > MAX_int32 ||
+		(uint64)NumHeightfields * sizeof(FServerRecastGeometryFileHeightfield) > HeightfieldsSize ||
+		(uint64)NumSamples * sizeof(int16) > SamplesSize ||
+		(uint64)NumMaskWords * sizeof(uint32) > MasksSize)
+	{
+		return false;
+	}
+
+	for (uint32 HeightfieldIndex = 0; HeightfieldIndex < NumHeightfields; ++HeightfieldIndex)
+	{
+		const FServerRecastGeometryFileHeightfield& Heightfield = HeightfieldSet.Heightfields[HeightfieldIndex];
+		if (Heightfield.NumRows < 2 || Heightfield.NumCols < 2 || (int64)Heightfield.NumRows * Heightfield.NumCols > MAX_int32)
+		{
+			return false;
+		}
+
+		// hole words are followed by split words
+		const int64 NumGridSamples = (int64)Heightfield.NumRows * Heightfield.NumCols;
+		if (Heightfield.FirstSample < 0 || Heightfield.FirstSample + NumGridSamples > NumSamples ||
+			Heightfield.FirstMaskWord < 0 || Heightfield.FirstMaskWord + 2 * (int64)Heightfield.GetNumMaskWords() > NumMaskWords)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TArray<const FServerRecastGeometryFileTileBucket*> FServerRecastGeometryFileView::GetTileBuckets() const
+{
+	TArray<const FServerRecastGeometryFileTileBucket*> Buckets;
+	if (Data == nullptr)
+	{
+		return Buckets;
+	}
+
+	const FServerRecastGeometryFileHeader& Header = GetHeader();
+	const FServerRecastGeometryFileSection* SectionTable = (const FServerRecastGeometryFileSection*)(Data + sizeof(FServerRecastGeometryFileHeader));
+	for (uint32 Index = 0; Index < Header.NumSections; ++Index)
+	{
+		const FServerRecastGeometryFileSection& Section = SectionTable[Index];
+		if (Section.Type != EServerRecastGeometrySection::TileBucket || Section.Size < sizeof(FServerRecastGeometryFileTileBucket))
+		{
+			continue;
+		}
+
+		const FServerRecastGeometryFileTileBucket* Bucket = (const FServerRecastGeometryFileTileBucket*)(Data + Section.Offset);
+		if (ValidateTileBucket(*Bucket, Section.Size))
+		{
+			Buckets.Add(Bucket);
+		}
+		else
+		{
+			UE_LOG(LogNavigation, Error, TEXT("Tile bucket %d,%d of ServerRecast geometry file is corrupt, its geometry is skipped"), Bucket->TileX, Bucket->TileY);
+		}
+	}
+
+	return Buckets;
+}
+
+bool FServerRecastGeometryFileView::ValidateTileBucket(const FServerRecastGeometryFileTileBucket& Bucket, uint64 SectionSize)
+{
+	if (Bucket.NumVerts < 0 || Bucket.NumTris < 0 || Bucket.NumVerts > MAX_int32 / 3 || Bucket.NumTris > MAX_int32 / 3 ||
+		FServerRecastGeometryFileTileBucket::GetSize(Bucket.NumVerts, Bucket.NumTris) > SectionSize)
+	{
+		return false;
+	}
+
+	const int32* Tris = Bucket.GetTris();
+	for (int32 Index = 0; Index < Bucket.NumTris * 3; ++Index)
+	{
+		if (Tris[Index] < 0 || Tris[Index] >= Bucket.NumVerts)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+TArray<const FServerRecastGeometryFileVoxelTile*> FServerRecastGeometryFileView::GetVoxelTiles() const
+{
+	TArray<const FServerRecastGeometryFileVoxelTile*> Tiles;
+	if (Data == nullptr)
+	{
+		return Tiles;
+	}
+
+	const FServerRecastGeometryFileHeader& Header = GetHeader();
+	const FServerRecastGeometryFileSection* SectionTable = (const FServerRecastGeometryFileSection*)(Data + sizeof(FServerRecastGeometryFileHeader));
+	for (uint32 Index = 0; Index < Header.NumSections; ++Index)
+	{
+		const FServerRecastGeometryFileSection& Section = SectionTable[Index];
+		if (Section.Type != EServerRecastGeometrySection::VoxelTile || Section.Size < sizeof(FServerRecastGeometryFileVoxelTile))
+		{
+			continue;
+		}
+
+		const FServerRecastGeometryFileVoxelTile* Tile = (const FServerRecastGeometryFileVoxelTile*)(Data + Section.Offset);
+		if (Tile->DataSize >= 0 && FServerRecastGeometryFileVoxelTile::GetSize(Tile->DataSize) <= Section.Size)
+		{
+			Tiles.Add(Tile);
+		}
+	}
+
+	return Tiles;
+}
@@ -0,0 +1,1269 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastNavMeshBuilder.h"
+#include "ServerRecastStats.h"
+#include "ServerRecastVoxelTile.h"
+#include "ServerRecastTileCache.h"
+#include "Runtime/Navmesh/Public/Recast/Recast.h"
+#include "Runtime/Navmesh/Public/Detour/DetourAlloc.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMeshBuilder.h"
+#include "HAL/FileManager.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Async/ParallelFor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ByteSwap.h"
+
+namespace ServerRecastNavMeshSet
+{
+	// same layout as RecastDemo's Sample_TileMesh::saveAll
+	static const int32 Magic = 'M' << 24 | 'S' << 16 | 'E' << 8 | 'T';
+	static const int32 Version = 1;
+
+	struct FSetHeader
+	{
+		int32 Magic;
+		int32 Version;
+		int32 NumTiles;
+		dtNavMeshParams Params;
+	};
+
+	struct FTileHeader
+	{
+		dtTileRef TileRef;
+		int32 DataSize;
+	};
+}
+
+class FServerRecastBuildContext : public rcContext
+{
+public:
+	FServerRecastBuildContext() : rcContext(true) {}
+
+protected:
+	virtual void doLog(const rcLogCategory Category, const char* Msg, const int Len) override
+	{
+		if (Category == RC_LOG_ERROR)
+		{
+			UE_LOG(LogNavigation, Error, TEXT("ServerRecast build: %s"), ANSI_TO_TCHAR(Msg));
+		}
+		else if (Category == RC_LOG_WARNING)
+		{
+			UE_LOG(LogNavigation, Warning, TEXT("ServerRecast build: %s"), ANSI_TO_TCHAR(Msg));
+		}
+	}
+};
+
+/** Owns recast intermediates of a single tile */
+struct FServerRecastTileIntermediates
+{
+	rcHeightfield* Solid;
+	rcCompactHeightfield* CompactHF;
+	rcContourSet* ContourSet;
+	rcPolyMesh* PolyMesh;
+	rcPolyMeshDetail* DetailMesh;
+
+	FServerRecastTileIntermediates()
+		: Solid(nullptr), CompactHF(nullptr), ContourSet(nullptr), PolyMesh(nullptr), DetailMesh(nullptr)
+	{
+	}
+
+	~FServerRecastTileIntermediates()
+	{
+		rcFreeHeightField(Solid);
+		rcFreeCompactHeightfield(CompactHF);
+		rcFreeContourSet(ContourSet);
+		rcFreePolyMesh(PolyMesh);
+		rcFreePolyMeshDetail(DetailMesh);
+	}
+};
+
+/** Area convex bounds in recast space, the same test decides whether a tile is marked and whether the area goes into its cache key */
+static FBox GetAreaBounds(const FServerRecastGeometryFileArea& Area, const float* AreaPoints)
+{
+	FBox AreaBounds(ForceInit);
+	for (int32 PointIndex = Area.FirstPoint; PointIndex < Area.FirstPoint + Area.NumPoints; ++PointIndex)
+	{
+		AreaBounds += FVector(AreaPoints[PointIndex * 3 + 0], Area.MinZ, AreaPoints[PointIndex * 3 + 2]);
+	}
+	AreaBounds += FVector(AreaBounds.Min.X, Area.MaxZ, AreaBounds.Min.Z);
+	return AreaBounds;
+}
+
+FServerRecastBuildInput::FServerRecastBuildInput()
+	: Bounds(ForceInit)
+	, Coords(nullptr)
+	, NumVerts(0)
+	, Tris(nullptr)
+	, NumTris(0)
+	, Areas(nullptr)
+	, NumAreas(0)
+	, AreaPoints(nullptr)
+{
+}
+
+void FServerRecastBuildInput::InitFromFile(const FServerRecastGeometryFileView& View)
+{
+	const FServerRecastGeometryFileHeader& Header = View.GetHeader();
+	Header.Config.ToRecastConfig(Config);
+	Bounds = FBox(FVector(Header.BoundsMin[0], Header.BoundsMin[1], Header.BoundsMin[2]), FVector(Header.BoundsMax[0], Header.BoundsMax[1], Header.BoundsMax[2]));
+
+	Coords = View.GetVertices(NumVerts);
+	Tris = View.GetTriangles(NumTris);
+	Instances = View.GetInstanceSet();
+	Heightfields = View.GetHeightfieldSet();
+	Areas = View.GetAreas(NumAreas);
+
+	int32 NumAreaPoints = 0;
+	AreaPoints = View.GetAreaPoints(NumAreaPoints);
+
+	TileBuckets = View.GetTileBuckets();
+	VoxelTiles = View.GetVoxelTiles();
+}
+
+FServerRecastTileGrid::FServerRecastTileGrid()
+	: Bounds(ForceInit)
+	, TileWorldSize(0.f)
+	, BorderSize(0.f)
+	, TilesWidth(0)
+	, TilesHeight(0)
+{
+}
+
+FServerRecastTileGrid::FServerRecastTileGrid(const FRecastBuildConfig& Config, const FBox& RecastBounds)
+	: Bounds(RecastBounds)
+	, TileWorldSize(Config.tileSize * Config.cs)
+	, BorderSize(Config.borderSize * Config.cs)
+	, TilesWidth(0)
+	, TilesHeight(0)
+{
+	if (TileWorldSize > 0.f && Bounds.IsValid)
+	{
+		TilesWidth = FMath::Max(FMath::CeilToInt((Bounds.Max.X - Bounds.Min.X) / TileWorldSize), 1);
+		TilesHeight = FMath::Max(FMath::CeilToInt((Bounds.Max.Z - Bounds.Min.Z) / TileWorldSize), 1);
+	}
+}
+
+FBox FServerRecastTileGrid::GetTileBounds(int32 TileX, int32 TileY, bool bWithBorder) const
+{
+	const FVector& Origin = Bounds.Min;
+	FBox TileBounds(
+		FVector(Origin.X + TileX * TileWorldSize, Bounds.Min.Y, Origin.Z + TileY * TileWorldSize),
+		FVector(Origin.X + (TileX + 1) * TileWorldSize, Bounds.Max.Y, Origin.Z + (TileY + 1) * TileWorldSize));
+
+	if (bWithBorder)
+	{
+		TileBounds.Min.X -= BorderSize;
+		TileBounds.Min.Z -= BorderSize;
+		TileBounds.Max.X += BorderSize;
+		TileBounds.Max.Z += BorderSize;
+	}
+
+	return TileBounds;
+}
+
+bool FServerRecastTileGrid::GetTileRange(const FBox& RecastBox, FIntPoint& OutMin, FIntPoint& OutMax) const
+{
+	const FVector& Origin = Bounds.Min;
+	const float InvTileSize = 1.f / TileWorldSize;
+
+	const int32 MinTileX = FMath::FloorToInt((RecastBox.Min.X - BorderSize - Origin.X) * InvTileSize);
+	const int32 MaxTileX = FMath::FloorToInt((RecastBox.Max.X + BorderSize - Origin.X) * InvTileSize);
+	const int32 MinTileY = FMath::FloorToInt((RecastBox.Min.Z - BorderSize - Origin.Z) * InvTileSize);
+	const int32 MaxTileY = FMath::FloorToInt((RecastBox.Max.Z + BorderSize - Origin.Z) * InvTileSize);
+	if (MaxTileX < 0 || MaxTileY < 0 || MinTileX >= TilesWidth || MinTileY >= TilesHeight)
+	{
+		return false;
+	}
+
+	OutMin = FIntPoint(FMath::Max(MinTileX, 0), FMath::Max(MinTileY, 0));
+	OutMax = FIntPoint(FMath::Min(MaxTileX, TilesWidth - 1), FMath::Min(MaxTileY, TilesHeight - 1));
+	return true;
+}
+
+FServerRecastNavMeshBuilder::FServerRecastNavMeshBuilder(const FServerRecastBuildInput& InInput)
+	: Input(InInput)
+	, Grid(InInput.Config, InInput.Bounds)
+	, NavMesh(nullptr)
+	, BuildTime(0.0)
+	, NumUsedWorkers(0)
+	, Progress(nullptr)
+	, TileCache(nullptr)
+{
+}
+
+FServerRecastNavMeshBuilder::~FServerRecastNavMeshBuilder()
+{
+	dtFreeNavMesh(NavMesh);
+}
+
+void FServerRecastNavMeshBuilder::BinTriangles()
+{
+	TileTriangles.Reset();
+	TileTriangles.SetNum(Grid.GetNumTiles());
+
+	for (int32 TriIndex = 0; TriIndex < Input.NumTris; ++TriIndex)
+	{
+		FBox TriBounds(ForceInit);
+		for (int32 Corner = 0; Corner < 3; ++Corner)
+		{
+			const float* Vert = &Input.Coords[Input.Tris[TriIndex * 3 + Corner] * 3];
+			TriBounds += FVector(Vert[0], Vert[1], Vert[2]);
+		}
+
+		FIntPoint MinTile, MaxTile;
+		if (!Grid.GetTileRange(TriBounds, MinTile, MaxTile))
+		{
+			continue;
+		}
+
+		for (int32 TileY = MinTile.Y; TileY <= MaxTile.Y; ++TileY)
+		{
+			for (int32 TileX = MinTile.X; TileX <= MaxTile.X; ++TileX)
+			{
+				TileTriangles[TileY * Grid.TilesWidth + TileX].Add(TriIndex);
+			}
+		}
+	}
+
+	TileBuckets.Reset();
+	TileBuckets.SetNumZeroed(Grid.GetNumTiles());
+	for (const FServerRecastGeometryFileTileBucket* Bucket : Input.TileBuckets)
+	{
+		if (Bucket->TileX >= 0 && Bucket->TileY >= 0 && Bucket->TileX < Grid.TilesWidth && Bucket->TileY < Grid.TilesHeight)
+		{
+			TileBuckets[Bucket->TileY * Grid.TilesWidth + Bucket->TileX] = Bucket;
+		}
+	}
+
+	VoxelTiles.Reset();
+	VoxelTiles.SetNumZeroed(Grid.GetNumTiles());
+	for (const FServerRecastGeometryFileVoxelTile* VoxelTile : Input.VoxelTiles)
+	{
+		if (VoxelTile->TileX >= 0 && VoxelTile->TileY >= 0 && VoxelTile->TileX < Grid.TilesWidth && VoxelTile->TileY < Grid.TilesHeight)
+		{
+			VoxelTiles[VoxelTile->TileY * Grid.TilesWidth + VoxelTile->TileX] = VoxelTile;
+		}
+	}
+
+	TileInputCost.Reset();
+	TileInputCost.SetNumZeroed(Grid.GetNumTiles());
+	for (int32 TileIndex = 0; TileIndex < Grid.GetNumTiles(); ++TileIndex)
+	{
+		const FServerRecastGeometryFileTileBucket* Bucket = TileBuckets[TileIndex];
+		const FServerRecastGeometryFileVoxelTile* VoxelTile = VoxelTiles[TileIndex];
+		TileInputCost[TileIndex] = TileTriangles[TileIndex].Num() + (Bucket ? Bucket->NumTris : 0) + (VoxelTile ? VoxelTile->NumSpans : 0);
+	}
+
+	// voxel input replaces geometry
+	if (Input.VoxelTiles.Num())
+	{
+		return;
+	}
+
+	// instances and height grids are expanded per tile later, their size is known from bounds already
+	for (int32 InstanceIndex = 0; InstanceIndex < Input.Instances.NumInstances; ++InstanceIndex)
+	{
+		const FServerRecastGeometryFileInstance& Instance = Input.Instances.Instances[InstanceIndex];
+		FIntPoint MinTile, MaxTile;
+		if (Grid.GetTileRange(Instance.GetBounds(), MinTile, MaxTile))
+		{
+			const int32 NumTris = Input.Instances.Prototypes[Instance.PrototypeIndex].NumTris;
+			for (int32 TileY = MinTile.Y; TileY <= MaxTile.Y; ++TileY)
+			{
+				for (int32 TileX = MinTile.X; TileX <= MaxTile.X; ++TileX)
+				{
+					TileInputCost[TileY * Grid.TilesWidth + TileX] += NumTris;
+				}
+			}
+		}
+	}
+
+	for (int32 HeightfieldIndex = 0; HeightfieldIndex < Input.Heightfields.NumHeightfields; ++HeightfieldIndex)
+	{
+		const FServerRecastGeometryFileHeightfield& Heightfield = Input.Heightfields.Heightfields[HeightfieldIndex];
+		const float QuadArea = FMath::Abs(Heightfield.StepX * Heightfield.StepZ);
+		const FBox HeightfieldBounds = Heightfield.GetBounds();
+		FIntPoint MinTile, MaxTile;
+		if (QuadArea <= 0.f || !Grid.GetTileRange(HeightfieldBounds, MinTile, MaxTile))
+		{
+			continue;
+		}
+
+		for (int32 TileY = MinTile.Y; TileY <= MaxTile.Y; ++TileY)
+		{
+			for (int32 TileX = MinTile.X; TileX <= MaxTile.X; ++TileX)
+			{
+				// two triangles per quad under the tile
+				const FBox Overlap = HeightfieldBounds.Overlap(Grid.GetTileBounds(TileX, TileY, true));
+				const FVector Size = Overlap.GetSize();
+				TileInputCost[TileY * Grid.TilesWidth + TileX] += (int64)(Size.X * Size.Z / QuadArea) * 2;
+			}
+		}
+	}
+}
+
+
+bool FServerRecastNavMeshBuilder::InitNavMesh()
+{
+	const FRecastBuildConfig& Config = Input.Config;
+	if (!Grid.IsValid() || Config.ch <= 0.f)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecast build: invalid config or empty navigation bounds"));
+		return false;
+	}
+
+	dtNavMeshParams Params;
+	FMemory::Memzero(Params);
+	Params.orig[0] = Grid.Bounds.Min.X;
+	Params.orig[1] = Grid.Bounds.Min.Y;
+	Params.orig[2] = Grid.Bounds.Min.Z;
+	Params.tileWidth = Grid.TileWorldSize;
+	Params.tileHeight = Grid.TileWorldSize;
+	Params.maxTiles = Grid.GetNumTiles();
+	Params.maxPolys = Config.MaxPolysPerTile > 0 ? Config.MaxPolysPerTile : 0xffff;
+
+	dtFreeNavMesh(NavMesh);
+	NavMesh = dtAllocNavMesh();
+	if (NavMesh == nullptr || dtStatusFailed(NavMesh->init(&Params)))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecast build: failed to init navmesh for %dx%d tiles"), Grid.TilesWidth, Grid.TilesHeight);
+		return false;
+	}
+	return true;
+}
+
+bool FServerRecastNavMeshBuilder::Build(int32 NumWorkers)
+{
+	if (!InitNavMesh())
+	{
+		return false;
+	}
+
+	BinTriangles();
+
+	TArray<int32> TileIndices;
+	TileIndices.SetNumUninitialized(Grid.GetNumTiles());
+	for (int32 TileIndex = 0; TileIndex < TileIndices.Num(); ++TileIndex)
+	{
+		TileIndices[TileIndex] = TileIndex;
+	}
+
+	return BuildTiles(TileIndices, NumWorkers);
+}
+
+bool FServerRecastNavMeshBuilder::Rebuild(const FString& ExistingFileName, const TArray<FIntPoint>& Tiles, int32 NumWorkers)
+{
+	dtNavMesh* Existing = LoadNavMeshSet(ExistingFileName);
+	if (Existing == nullptr)
+	{
+		return Build(NumWorkers);
+	}
+
+	// navigable bounds or tile size changed since last build, old tiles are useless
+	const dtNavMeshParams& Params = *Existing->getParams();
+	if (!Grid.IsValid() ||
+		!FVector(Params.orig[0], Params.orig[1], Params.orig[2]).Equals(Grid.Bounds.Min, KINDA_SMALL_NUMBER) ||
+		!FMath::IsNearlyEqual(Params.tileWidth, Grid.TileWorldSize) ||
+		Params.maxTiles < Grid.GetNumTiles())
+	{
+		UE_LOG(LogNavigation, Log, TEXT("ServerRecast build: tile grid of %s changed, doing full build"), *ExistingFileName);
+		dtFreeNavMesh(Existing);
+		return Build(NumWorkers);
+	}
+
+	dtFreeNavMesh(NavMesh);
+	NavMesh = Existing;
+
+	BinTriangles();
+
+	TArray<int32> TileIndices;
+	for (const FIntPoint& Tile : Tiles)
+	{
+		if (Tile.X >= 0 && Tile.Y >= 0 && Tile.X < Grid.TilesWidth && Tile.Y < Grid.TilesHeight)
+		{
+			TileIndices.AddUnique(Tile.Y * Grid.TilesWidth + Tile.X);
+		}
+	}
+	TileIndices.Sort();
+
+	return BuildTiles(TileIndices, NumWorkers);
+}
+
+bool FServerRecastNavMeshBuilder::BuildTiles(const TArray<int32>& TileIndices, int32 NumWorkers)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const int32 NumTiles = TileIndices.Num();
+
+	// heaviest tiles first, so a big tile doesn't start last and keep one worker busy alone
+	TArray<int32> TileOrder;
+	TileOrder.SetNumUninitialized(NumTiles);
+	for (int32 Index = 0; Index < NumTiles; ++Index)
+	{
+		TileOrder[Index] = Index;
+	}
+	TileOrder.StableSort([this, &TileIndices](int32 A, int32 B) { return GetTileInputCost(TileIndices[A]) > GetTileInputCost(TileIndices[B]); });
+
+	struct FTileData
+	{
+		uint8* Data;
+		int32 DataSize;
+	};
+	TArray<FTileData> TileData;
+	TileData.SetNumZeroed(NumTiles);
+	TileStats.Reset();
+	TileStats.SetNumZeroed(NumTiles);
+
+	NumUsedWorkers = NumWorkers > 0 ? NumWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	NumUsedWorkers = FMath::Clamp(NumUsedWorkers, 1, FMath::Max(NumTiles, 1));
+
+	FThreadSafeCounter NextTile;
+	ParallelFor(NumUsedWorkers, [&](int32 WorkerIndex)
+		{
+			FServerRecastBuildContext Context;
+			FTileScratch Scratch;
+
+			for (int32 OrderIndex = NextTile.Increment() - 1; OrderIndex < NumTiles && !WasCancelled(); OrderIndex = NextTile.Increment() - 1)
+			{
+				const int32 Index = TileOrder[OrderIndex];
+				const int32 TileX = TileIndices[Index] % Grid.TilesWidth;
+				const int32 TileY = TileIndices[Index] / Grid.TilesWidth;
+
+				const double TileStartTime = FPlatformTime::Seconds();
+				FTileData& Tile = TileData[Index];
+				bool bFromCache = false;
+				if (GatherTile(TileX, TileY, Scratch))
+				{
+					// unchanged input gives the same key, its tile is copied instead of built
+					FSHAHash Key;
+					if (TileCache)
+					{
+						HashTileInput(TileX, TileY, Scratch, Key);
+						bFromCache = TileCache->Load(Key, Scratch.CachedTile);
+					}
+
+					if (bFromCache && Scratch.CachedTile.Num())
+					{
+						Tile.Data = (uint8*)dtAlloc(Scratch.CachedTile.Num(), DT_ALLOC_PERM);
+						Tile.DataSize = Scratch.CachedTile.Num();
+						FMemory::Memcpy(Tile.Data, Scratch.CachedTile.GetData(), Tile.DataSize);
+					}
+					else if (!bFromCache)
+					{
+						// a failed build is not an empty tile, next run tries again
+						bool bFailed = false;
+						Tile.Data = BuildTile(TileX, TileY, Context, Scratch, Tile.DataSize, bFailed);
+						if (bFailed)
+						{
+							UE_LOG(LogNavigation, Warning, TEXT("ServerRecast build: tile (%d, %d) failed, it is left empty"), TileX, TileY);
+						}
+						else if (TileCache)
+						{
+							TileCache->Store(Key, Tile.Data, Tile.DataSize);
+						}
+					}
+				}
+
+				FServerRecastTileBuildStats& Stats = TileStats[Index];
+				Stats.TileX = TileX;
+				Stats.TileY = TileY;
+				Stats.bFromCache = bFromCache;
+				Stats.NumTris = (Scratch.Tris.Num() + Scratch.InstanceTris.Num()) / 3 + (Scratch.Bucket ? Scratch.Bucket->NumTris : 0);
+				Stats.DataSize = Tile.DataSize;
+				Stats.WorkerIndex = WorkerIndex;
+				Stats.BuildTime = (float)((FPlatformTime::Seconds() - TileStartTime) * 1000.0);
+
+				if (Progress)
+				{
+					Progress->AddTris(Stats.NumTris);
+				}
+			}
+		}, NumUsedWorkers == 1);
+
+	// partial result would drop old versions of tiles that weren't built
+	if (WasCancelled())
+	{
+		for (FTileData& Tile : TileData)
+		{
+			dtFree(Tile.Data);
+		}
+		TileStats.Reset();
+		UE_LOG(LogNavigation, Log, TEXT("ServerRecast build: cancelled"));
+		return false;
+	}
+
+	int32 NumBuiltTiles = 0;
+	for (int32 Index = 0; Index < NumTiles; ++Index)
+	{
+		const int32 TileX = TileIndices[Index] % Grid.TilesWidth;
+		const int32 TileY = TileIndices[Index] / Grid.TilesWidth;
+
+		// incremental build, drop the old version of this tile
+		const dtTileRef OldTileRef = NavMesh->getTileRefAt(TileX, TileY, 0);
+		if (OldTileRef)
+		{
+			NavMesh->removeTile(OldTileRef, nullptr, nullptr);
+		}
+
+		FTileData& Tile = TileData[Index];
+		if (Tile.Data == nullptr)
+		{
+			continue;
+		}
+
+		if (dtStatusFailed(NavMesh->addTile(Tile.Data, Tile.DataSize, DT_TILE_FREE_DATA, 0, nullptr)))
+		{
+			UE_LOG(LogNavigation, Error, TEXT("ServerRecast build: failed to add tile (%d, %d)"), TileX, TileY);
+			dtFree(Tile.Data);
+			continue;
+		}
+		++NumBuiltTiles;
+	}
+
+	BuildTime = FPlatformTime::Seconds() - StartTime;
+	UE_LOG(LogNavigation, Log, TEXT("ServerRecast build: %d of %d tiles (grid %dx%d) in %.3f sec on %d workers"), NumBuiltTiles, NumTiles, Grid.TilesWidth, Grid.TilesHeight, BuildTime, NumUsedWorkers);
+	return true;
+}
+
+bool FServerRecastNavMeshBuilder::Voxelize(const FString& FileName, int32 NumWorkers)
+{
+	SERVERRECAST_SCOPE_STAT(STAT_ServerRecast_Voxelize);
+	const double StartTime = FPlatformTime::Seconds();
+
+	if (!Grid.IsValid() || Input.Config.ch <= 0.f)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecast voxelize: invalid config or empty navigation bounds"));
+		return false;
+	}
+	if (Input.VoxelTiles.Num())
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecast voxelize: input is already voxelized"));
+		return false;
+	}
+
+	BinTriangles();
+
+	// areas are marked after rasterization, they go along so the file builds on its own
+	int32 NumAreaPoints = 0;
+	for (int32 AreaIndex = 0; AreaIndex < Input.NumAreas; ++AreaIndex)
+	{
+		NumAreaPoints = FMath::Max(NumAreaPoints, Input.Areas[AreaIndex].FirstPoint + Input.Areas[AreaIndex].NumPoints);
+	}
+
+	FServerRecastGeometryFileWriter Writer(Grid.Bounds, Input.Config);
+	Writer.AddSection(EServerRecastGeometrySection::Areas, Input.Areas, Input.NumAreas * sizeof(FServerRecastGeometryFileArea), Input.NumAreas);
+	Writer.AddSection(EServerRecastGeometrySection::AreaPoints, Input.AreaPoints, NumAreaPoints * 3 * sizeof(float), NumAreaPoints);
+	if (!Writer.BeginStream(FileName, Grid.GetNumTiles()))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to write %s"), *FileName);
+		return false;
+	}
+
+	struct FVoxelSlot
+	{
+		FTileScratch Scratch;
+		TArray<uint8> Encoded;
+	};
+
+	// one batch of tiles is rasterized in parallel and written in row order, memory is bounded by the batch
+	const int32 NumSlots = 2 * (NumWorkers > 0 ? NumWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+	TArray<FVoxelSlot> Slots;
+	Slots.SetNum(NumSlots);
+
+	int32 NumVoxelTiles = 0;
+	int64 NumSpans = 0;
+	int64 NumBytes = 0;
+	bool bWritten = true;
+	for (int32 FirstTile = 0; FirstTile < Grid.GetNumTiles() && bWritten && !WasCancelled(); FirstTile += NumSlots)
+	{
+		const int32 NumBatchTiles = FMath::Min(NumSlots, Grid.GetNumTiles() - FirstTile);
+		ParallelFor(NumBatchTiles, [&](int32 SlotIndex)
+			{
+				const int32 TileIndex = FirstTile + SlotIndex;
+				const int32 TileX = TileIndex % Grid.TilesWidth;
+				const int32 TileY = TileIndex / Grid.TilesWidth;
+				FVoxelSlot& Slot = Slots[SlotIndex];
+				Slot.Encoded.Reset();
+
+				FServerRecastBuildContext Context;
+				FServerRecastTileIntermediates Intermediates;
+				Intermediates.Solid = rcAllocHeightfield();
+				if (GatherTile(TileX, TileY, Slot.Scratch) && RasterizeTile(TileX, TileY, Context, Slot.Scratch, *Intermediates.Solid))
+				{
+					ServerRecastVoxelTile::Encode(*Intermediates.Solid, TileX, TileY, Slot.Encoded);
+				}
+			});
+
+		for (int32 SlotIndex = 0; SlotIndex < NumBatchTiles; ++SlotIndex)
+		{
+			const FVoxelSlot& Slot = Slots[SlotIndex];
+			const FServerRecastGeometryFileVoxelTile* VoxelTile = (const FServerRecastGeometryFileVoxelTile*)Slot.Encoded.GetData();
+			if (VoxelTile == nullptr || VoxelTile->NumSpans == 0)
+			{
+				continue;
+			}
+
+			if (!Writer.StreamSection(EServerRecastGeometrySection::VoxelTile, Slot.Encoded.GetData(), Slot.Encoded.Num(), 1))
+			{
+				bWritten = false;
+				break;
+			}
+			++NumVoxelTiles;
+			NumSpans += VoxelTile->NumSpans;
+			NumBytes += Slot.Encoded.Num();
+			if (Progress)
+			{
+				Progress->AddTris((Slot.Scratch.Tris.Num() + Slot.Scratch.InstanceTris.Num()) / 3 + (Slot.Scratch.Bucket ? Slot.Scratch.Bucket->NumTris : 0));
+			}
+		}
+	}
+
+	const bool bSuccess = Writer.EndStream() && bWritten;
+	if (WasCancelled() || !bWritten)
+	{
+		IFileManager::Get().Delete(*FileName);
+		return false;
+	}
+
+	UE_LOG(LogNavigation, Log, TEXT("ServerRecast voxelize: %d of %d tiles, %lld spans, %lld KB in %.3f sec"),
+		NumVoxelTiles, Grid.GetNumTiles(), NumSpans, NumBytes / 1024, FPlatformTime::Seconds() - StartTime);
+	return bSuccess;
+}
+
+void FServerRecastNavMeshBuilder::LogTileReport(int32 NumSlowestTiles) const
+{
+	double TotalTileTime = 0.0;
+	TArray<int32> SlowestTiles;
+	SlowestTiles.Reserve(TileStats.Num());
+	for (int32 TileIndex = 0; TileIndex < TileStats.Num(); ++TileIndex)
+	{
+		TotalTileTime += TileStats[TileIndex].BuildTime;
+		SlowestTiles.Add(TileIndex);
+	}
+	SlowestTiles.Sort([this](int32 A, int32 B) { return TileStats[A].BuildTime > TileStats[B].BuildTime; });
+
+	// sum of tile times over wall time, ideal is the number of workers
+	const double Speedup = BuildTime > 0.0 ? TotalTileTime * 0.001 / BuildTime : 0.0;
+	UE_LOG(LogNavigation, Log, TEXT("ServerRecast tiles: %d, tile time sum %.3f sec, wall %.3f sec, speedup %.2f on %d workers"),
+		TileStats.Num(), TotalTileTime * 0.001, BuildTime, Speedup, NumUsedWorkers);
+
+	for (int32 i = 0; i < FMath::Min(NumSlowestTiles, SlowestTiles.Num()); ++i)
+	{
+		const FServerRecastTileBuildStats& Stats = TileStats[SlowestTiles[i]];
+		UE_LOG(LogNavigation, Log, TEXT("  tile (%d, %d): %.2f ms, %d tris, %d bytes"), Stats.TileX, Stats.TileY, Stats.BuildTime, Stats.NumTris, Stats.DataSize);
+	}
+}
+
+bool FServerRecastNavMeshBuilder::SaveTileReport(const FString& FileName) const
+{
+	FString Report = TEXT("TileX,TileY,Tris,DataSize,Worker,BuildTimeMs,Cached\n");
+	for (const FServerRecastTileBuildStats& Stats : TileStats)
+	{
+		Report += FString::Printf(TEXT("%d,%d,%d,%d,%d,%.3f,%d\n"), Stats.TileX, Stats.TileY, Stats.NumTris, Stats.DataSize, Stats.WorkerIndex, Stats.BuildTime, Stats.bFromCache ? 1 : 0);
+	}
+	return FFileHelper::SaveStringToFile(Report, *FileName);
+}
+
+bool FServerRecastNavMeshBuilder::RasterizeHeightfields(rcContext& Context, rcHeightfield& Solid, const FBox& TileBounds, FTileScratch& Scratch) const
+{
+	const FRecastBuildConfig& Config = Input.Config;
+	const FServerRecastHeightfieldSet& HeightfieldSet = Input.Heightfields;
+	const float WalkableNormalY = FMath::Cos(FMath::DegreesToRadians(Config.walkableSlopeAngle));
+	const float InvCellSize = 1.f / Solid.cs;
+
+	bool bRasterized = false;
+	for (int32 HeightfieldIndex = 0; HeightfieldIndex < HeightfieldSet.NumHeightfields; ++HeightfieldIndex)
+	{
+		const FServerRecastGeometryFileHeightfield& Heightfield = HeightfieldSet.Heightfields[HeightfieldIndex];
+		const FBox Bounds = Heightfield.GetBounds();
+		if (!Bounds.Intersect(TileBounds))
+		{
+			continue;
+		}
+
+		// voxel columns overlapping the grid on XZ plane
+		const int32 MinX = FMath::Max(0, FMath::FloorToInt((Bounds.Min.X - Solid.bmin[0]) * InvCellSize));
+		const int32 MaxX = FMath::Min(Solid.width - 1, FMath::CeilToInt((Bounds.Max.X - Solid.bmin[0]) * InvCellSize) - 1);
+		const int32 MinZ = FMath::Max(0, FMath::FloorToInt((Bounds.Min.Z - Solid.bmin[2]) * InvCellSize));
+		const int32 MaxZ = FMath::Min(Solid.height - 1, FMath::CeilToInt((Bounds.Max.Z - Solid.bmin[2]) * InvCellSize) - 1);
+		if (MinX > MaxX || MinZ > MaxZ)
+		{
+			continue;
+		}
+
+		// corners are shared by neighbour columns, corners past the grid edge take the edge height,
+		// so columns on the seam of two landscape components get spans from both
+		const int32 NumCornersX = MaxX - MinX + 2;
+		const int32 NumCornersZ = MaxZ - MinZ + 2;
+		Scratch.HeightfieldCorners.SetNumUninitialized(NumCornersX * NumCornersZ, false);
+		for (int32 CornerZ = 0; CornerZ < NumCornersZ; ++CornerZ)
+		{
+			for (int32 CornerX = 0; CornerX < NumCornersX; ++CornerX)
+			{
+				const float X = FMath::Clamp(Solid.bmin[0] + (MinX + CornerX) * Solid.cs, Bounds.Min.X, Bounds.Max.X);
+				const float Z = FMath::Clamp(Solid.bmin[2] + (MinZ + CornerZ) * Solid.cs, Bounds.Min.Z, Bounds.Max.Z);
+				float Height = 0.f;
+				bool bHole = false;
+				HeightfieldSet.GetHeight(Heightfield, X, Z, Height, bHole);
+				Scratch.HeightfieldCorners[CornerZ * NumCornersX + CornerX] = Height;
+			}
+		}
+
+		for (int32 VoxelZ = MinZ; VoxelZ <= MaxZ; ++VoxelZ)
+		{
+			for (int32 VoxelX = MinX; VoxelX <= MaxX; ++VoxelX)
+			{
+				const float CenterX = FMath::Clamp(Solid.bmin[0] + (VoxelX + 0.5f) * Solid.cs, Bounds.Min.X, Bounds.Max.X);
+				const float CenterZ = FMath::Clamp(Solid.bmin[2] + (VoxelZ + 0.5f) * Solid.cs, Bounds.Min.Z, Bounds.Max.Z);
+				float CenterHeight = 0.f;
+				bool bHole = false;
+				if (!HeightfieldSet.GetHeight(Heightfield, CenterX, CenterZ, CenterHeight, bHole) || bHole)
+				{
+					continue;
+				}
+
+				const float* Corners = &Scratch.HeightfieldCorners[(VoxelZ - MinZ) * NumCornersX + (VoxelX - MinX)];
+				const float H00 = Corners[0];
+				const float H10 = Corners[1];
+				const float H01 = Corners[NumCornersX];
+				const float H11 = Corners[NumCornersX + 1];
+				const float MinHeight = FMath::Min(FMath::Min3(H00, H10, H01), FMath::Min(H11, CenterHeight));
+				const float MaxHeight = FMath::Max(FMath::Max3(H00, H10, H01), FMath::Max(H11, CenterHeight));
+
+				int32 SpanMin = FMath::FloorToInt((MinHeight - Solid.bmin[1]) / Solid.ch);
+				int32 SpanMax = FMath::Max(FMath::CeilToInt((MaxHeight - Solid.bmin[1]) / Solid.ch), SpanMin + 1);
+				if (SpanMax < 0 || SpanMin > RC_SPAN_MAX_HEIGHT)
+				{
+					continue;
+				}
+				SpanMin = FMath::Clamp(SpanMin, 0, RC_SPAN_MAX_HEIGHT - 1);
+				SpanMax = FMath::Clamp(SpanMax, SpanMin + 1, RC_SPAN_MAX_HEIGHT);
+
+				// same slope test as rcMarkWalkableTriangles, on the column's average gradient
+				const float GradientX = (H10 + H11 - H00 - H01) * 0.5f * InvCellSize;
+				const float GradientZ = (H01 + H11 - H00 - H10) * 0.5f * InvCellSize;
+				const float NormalY = FMath::InvSqrt(1.f + GradientX * GradientX + GradientZ * GradientZ);
+				const uint8 Area = NormalY > WalkableNormalY ? RC_WALKABLE_AREA : RC_NULL_AREA;
+
+				rcAddSpan(&Context, Solid, VoxelX, VoxelZ, (unsigned short)SpanMin, (unsigned short)SpanMax, Area, Config.walkableClimb);
+				bRasterized = true;
+			}
+		}
+	}
+
+	return bRasterized;
+}
+
+bool FServerRecastNavMeshBuilder::CreateTileHeightfield(int32 TileX, int32 TileY, rcContext& Context, rcHeightfield& Solid) const
+{
+	const FRecastBuildConfig& Config = Input.Config;
+	const FBox TileBounds = Grid.GetTileBounds(TileX, TileY, true);
+	const int32 TileVoxels = Config.tileSize + Config.borderSize * 2;
+	const float BMin[3] = { TileBounds.Min.X, TileBounds.Min.Y, TileBounds.Min.Z };
+	const float BMax[3] = { TileBounds.Max.X, TileBounds.Max.Y, TileBounds.Max.Z };
+
+	return rcCreateHeightfield(&Context, Solid, TileVoxels, TileVoxels, BMin, BMax, Config.cs, Config.ch);
+}
+
+bool FServerRecastNavMeshBuilder::GatherTile(int32 TileX, int32 TileY, FTileScratch& Scratch) const
+{
+	const FBox TileBounds = Grid.GetTileBounds(TileX, TileY, true);
+
+	Scratch.Tris.Reset();
+	Scratch.InstanceCoords.Reset();
+	Scratch.InstanceTris.Reset();
+	Scratch.Bucket = nullptr;
+	Scratch.VoxelTile = nullptr;
+	Scratch.bHasHeightfields = false;
+
+	// voxel input replaces geometry, tiles without voxel data are empty
+	if (Input.VoxelTiles.Num())
+	{
+		Scratch.VoxelTile = VoxelTiles[TileY * Grid.TilesWidth + TileX];
+		return Scratch.VoxelTile != nullptr;
+	}
+
+	for (int32 TriIndex : TileTriangles[TileY * Grid.TilesWidth + TileX])
+	{
+		Scratch.Tris.Append(&Input.Tris[TriIndex * 3], 3);
+	}
+
+	// instances are expanded only for tiles they touch
+	Input.Instances.Expand(&TileBounds, Scratch.InstanceCoords, Scratch.InstanceTris);
+
+	// tiled files keep the tile's own geometry in a bucket, mapped pages are touched only here
+	Scratch.Bucket = TileBuckets[TileY * Grid.TilesWidth + TileX];
+
+	for (int32 HeightfieldIndex = 0; HeightfieldIndex < Input.Heightfields.NumHeightfields && !Scratch.bHasHeightfields; ++HeightfieldIndex)
+	{
+		Scratch.bHasHeightfields = Input.Heightfields.Heightfields[HeightfieldIndex].GetBounds().Intersect(TileBounds);
+	}
+
+	return Scratch.Tris.Num() || Scratch.InstanceTris.Num() || (Scratch.Bucket && Scratch.Bucket->NumTris) || Scratch.bHasHeightfields;
+}
+
+void FServerRecastNavMeshBuilder::HashTileInput(int32 TileX, int32 TileY, FTileScratch& Scratch, FSHAHash& OutKey) const
+{
+	const FBox TileBounds = Grid.GetTileBounds(TileX, TileY, true);
+	FSHA1 Hash;
+
+	// tile data layout, another engine's Detour gives other keys
+	const uint32 Layout[] = { SERVERRECAST_TILECACHE_KEY_VERSION, sizeof(dtMeshHeader), sizeof(dtPoly), sizeof(dtPolyDetail), sizeof(dtBVNode), sizeof(dtPolyRef) };
+	Hash.Update((const uint8*)Layout, sizeof(Layout));
+
+	// rd_* parameters and their voxel values
+	FServerRecastGeometryFileConfig FileConfig;
+	FMemory::Memzero(FileConfig);
+	FileConfig.Init(Input.Config);
+	Hash.Update((const uint8*)&FileConfig, sizeof(FileConfig));
+
+	const float GridValues[] = { Grid.Bounds.Min.X, Grid.Bounds.Min.Y, Grid.Bounds.Min.Z, Grid.Bounds.Max.X, Grid.Bounds.Max.Y, Grid.Bounds.Max.Z, Grid.TileWorldSize };
+	const int32 TileCoords[] = { TileX, TileY };
+	Hash.Update((const uint8*)GridValues, sizeof(GridValues));
+	Hash.Update((const uint8*)TileCoords, sizeof(TileCoords));
+
+	// coordinates rather than indices, so edits elsewhere in the world leave the key alone
+	TArray<float>& KeyCoords = Scratch.KeyCoords;
+	auto HashTriangles = [&Hash, &KeyCoords](const float* Verts, const int32* Tris, int32 NumTris)
+	{
+		KeyCoords.Reset();
+		KeyCoords.SetNumUninitialized(NumTris * 9, false);
+		for (int32 i = 0; i < NumTris * 3; ++i)
+		{
+			FMemory::Memcpy(&KeyCoords[i * 3], &Verts[Tris[i] * 3], 3 * sizeof(float));
+		}
+		Hash.Update((const uint8*)&NumTris, sizeof(NumTris));
+		Hash.Update((const uint8*)KeyCoords.GetData(), KeyCoords.Num() * sizeof(float));
+	};
+
+	HashTriangles(Input.Coords, Scratch.Tris.GetData(), Scratch.Tris.Num() / 3);
+	HashTriangles(Scratch.InstanceCoords.GetData(), Scratch.InstanceTris.GetData(), Scratch.InstanceTris.Num() / 3);
+	if (Scratch.Bucket)
+	{
+		HashTriangles(Scratch.Bucket->GetVerts(), Scratch.Bucket->GetTris(), Scratch.Bucket->NumTris);
+	}
+	if (Scratch.VoxelTile)
+	{
+		Hash.Update((const uint8*)Scratch.VoxelTile, FServerRecastGeometryFileVoxelTile::GetSize(Scratch.VoxelTile->DataSize));
+	}
+
+	// samples and quad bits under the bordered tile
+	const FServerRecastHeightfieldSet& HeightfieldSet = Input.Heightfields;
+	for (int32 HeightfieldIndex = 0; Scratch.bHasHeightfields && HeightfieldIndex < HeightfieldSet.NumHeightfields; ++HeightfieldIndex)
+	{
+		const FServerRecastGeometryFileHeightfield& Heightfield = HeightfieldSet.Heightfields[HeightfieldIndex];
+		if (Heightfield.NumRows < 2 || Heightfield.NumCols < 2 || !Heightfield.GetBounds().Intersect(TileBounds))
+		{
+			continue;
+		}
+
+		const float GridParams[] = { Heightfield.Origin[0], Heightfield.Origin[1], Heightfield.Origin[2], Heightfield.StepX, Heightfield.StepZ, Heightfield.HeightScale };
+		const int32 GridSize[] = { Heightfield.NumRows, Heightfield.NumCols };
+		Hash.Update((const uint8*)GridParams, sizeof(GridParams));
+		Hash.Update((const uint8*)GridSize, sizeof(GridSize));
+
+		const float RowA = (TileBounds.Min.X - Heightfield.Origin[0]) / Heightfield.StepX;
+		const float RowB = (TileBounds.Max.X - Heightfield.Origin[0]) / Heightfield.StepX;
+		const float ColA = (TileBounds.Min.Z - Heightfield.Origin[2]) / Heightfield.StepZ;
+		const float ColB = (TileBounds.Max.Z - Heightfield.Origin[2]) / Heightfield.StepZ;
+		const int32 MinRow = FMath::Clamp(FMath::FloorToInt(FMath::Min(RowA, RowB)), 0, Heightfield.NumRows - 1);
+		const int32 MaxRow = FMath::Clamp(FMath::CeilToInt(FMath::Max(RowA, RowB)), 0, Heightfield.NumRows - 1);
+		const int32 MinCol = FMath::Clamp(FMath::FloorToInt(FMath::Min(ColA, ColB)), 0, Heightfield.NumCols - 1);
+		const int32 MaxCol = FMath::Clamp(FMath::CeilToInt(FMath::Max(ColA, ColB)), 0, Heightfield.NumCols - 1);
+		for (int32 Row = MinRow; Row <= MaxRow; ++Row)
+		{
+			Hash.Update((const uint8*)&HeightfieldSet.Samples[Heightfield.FirstSample + Row * Heightfield.NumCols + MinCol], (MaxCol - MinCol + 1) * sizeof(int16));
+		}
+
+		Scratch.KeyBytes.Reset();
+		for (int32 Row = MinRow; Row < MaxRow; ++Row)
+		{
+			for (int32 Col = MinCol; Col < MaxCol; ++Col)
+			{
+				Scratch.KeyBytes.Add((HeightfieldSet.IsHole(Heightfield, Row, Col) ? 1 : 0) | (HeightfieldSet.IsSplit(Heightfield, Row, Col) ? 2 : 0));
+			}
+		}
+		Hash.Update(Scratch.KeyBytes.GetData(), Scratch.KeyBytes.Num());
+	}
+
+	for (int32 AreaIndex = 0; AreaIndex < Input.NumAreas; ++AreaIndex)
+	{
+		const FServerRecastGeometryFileArea& Area = Input.Areas[AreaIndex];
+		if (GetAreaBounds(Area, Input.AreaPoints).Intersect(TileBounds))
+		{
+			Hash.Update(&Area.AreaId, sizeof(Area.AreaId));
+			Hash.Update((const uint8*)&Area.NumPoints, sizeof(Area.NumPoints));
+			Hash.Update((const uint8*)&Area.MinZ, sizeof(Area.MinZ));
+			Hash.Update((const uint8*)&Area.MaxZ, sizeof(Area.MaxZ));
+			Hash.Update((const uint8*)&Input.AreaPoints[Area.FirstPoint * 3], Area.NumPoints * 3 * sizeof(float));
+		}
+	}
+
+	Hash.Final();
+	Hash.GetHash(OutKey.Hash);
+}
+
+bool FServerRecastNavMeshBuilder::RasterizeTile(int32 TileX, int32 TileY, rcContext& Context, FTileScratch& Scratch, rcHeightfield& Solid) const
+{
+	const FRecastBuildConfig& Config = Input.Config;
+	const FBox TileBounds = Grid.GetTileBounds(TileX, TileY, true);
+	const FServerRecastGeometryFileTileBucket* Bucket = Scratch.Bucket;
+
+	if (!CreateTileHeightfield(TileX, TileY, Context, Solid))
+	{
+		return false;
+	}
+
+	auto RasterizeTriangles = [&](const float* Verts, int32 NumVerts, const int32* Tris, int32 NumTris)
+	{
+		if (NumTris == 0)
+		{
+			return;
+		}
+
+		Scratch.TriAreas.Reset();
+		Scratch.TriAreas.SetNumZeroed(NumTris);
+		rcMarkWalkableTriangles(&Context, Config.walkableSlopeAngle, Verts, NumVerts, Tris, NumTris, Scratch.TriAreas.GetData());
+		rcRasterizeTriangles(&Context, Verts, NumVerts, Tris, Scratch.TriAreas.GetData(), NumTris, Solid, Config.walkableClimb);
+	};
+
+	RasterizeTriangles(Input.Coords, Input.NumVerts, Scratch.Tris.GetData(), Scratch.Tris.Num() / 3);
+	RasterizeTriangles(Scratch.InstanceCoords.GetData(), Scratch.InstanceCoords.Num() / 3, Scratch.InstanceTris.GetData(), Scratch.InstanceTris.Num() / 3);
+	if (Bucket)
+	{
+		RasterizeTriangles(Bucket->GetVerts(), Bucket->NumVerts, Bucket->GetTris(), Bucket->NumTris);
+	}
+	if (Scratch.bHasHeightfields)
+	{
+		RasterizeHeightfields(Context, Solid, TileBounds, Scratch);
+	}
+
+	rcFilterLowHangingWalkableObstacles(&Context, Config.walkableClimb, Solid);
+	if (Config.bPerformVoxelFiltering)
+	{
+		rcFilterLedgeSpans(&Context, Config.walkableHeight, Config.walkableClimb, Solid);
+	}
+	rcFilterWalkableLowHeightSpans(&Context, Config.walkableHeight, Solid);
+	return true;
+}
+
+uint8* FServerRecastNavMeshBuilder::BuildTile(int32 TileX, int32 TileY, rcContext& Context, FTileScratch& Scratch, int32& OutDataSize, bool& bOutFailed) const
+{
+	SERVERRECAST_SCOPE_STAT(STAT_ServerRecast_BuildTile);
+	OutDataSize = 0;
+	bOutFailed = true;
+
+	const FRecastBuildConfig& Config = Input.Config;
+	const FBox TileBounds = Grid.GetTileBounds(TileX, TileY, true);
+
+	FServerRecastTileIntermediates Intermediates;
+	Intermediates.Solid = rcAllocHeightfield();
+
+	bool bHasSpans = false;
+	if (const FServerRecastGeometryFileVoxelTile* VoxelTile = Scratch.VoxelTile)
+	{
+		bHasSpans = CreateTileHeightfield(TileX, TileY, Context, *Intermediates.Solid) && ServerRecastVoxelTile::Decode(*VoxelTile, Context, *Intermediates.Solid);
+		if (!bHasSpans)
+		{
+			UE_LOG(LogNavigation, Error, TEXT("ServerRecast build: corrupt voxel data of tile (%d, %d)"), TileX, TileY);
+		}
+	}
+	else
+	{
+		bHasSpans = RasterizeTile(TileX, TileY, Context, Scratch, *Intermediates.Solid);
+	}
+
+	if (!bHasSpans)
+	{
+		return nullptr;
+	}
+
+	Intermediates.CompactHF = rcAllocCompactHeightfield();
+	if (!rcBuildCompactHeightfield(&Context, Config.walkableHeight, Config.walkableClimb, *Intermediates.Solid, *Intermediates.CompactHF))
+	{
+		return nullptr;
+	}
+	rcFreeHeightField(Intermediates.Solid);
+	Intermediates.Solid = nullptr;
+
+	if (!rcErodeWalkableArea(&Context, Config.walkableRadius, *Intermediates.CompactHF))
+	{
+		return nullptr;
+	}
+
+	TArray<float, TInlineAllocator<3 * 16>> ConvexVerts;
+	for (int32 AreaIndex = 0; AreaIndex < Input.NumAreas; ++AreaIndex)
+	{
+		const FServerRecastGeometryFileArea& Area = Input.Areas[AreaIndex];
+		if (!GetAreaBounds(Area, Input.AreaPoints).Intersect(TileBounds))
+		{
+			continue;
+		}
+
+		ConvexVerts.Reset();
+		ConvexVerts.Append(&Input.AreaPoints[Area.FirstPoint * 3], Area.NumPoints * 3);
+
+		rcMarkConvexPolyArea(&Context, ConvexVerts.GetData(), Area.NumPoints, Area.MinZ, Area.MaxZ, Area.AreaId, *Intermediates.CompactHF);
+	}
+
+	if (!rcBuildDistanceField(&Context, *Intermediates.CompactHF) ||
+		!rcBuildRegions(&Context, *Intermediates.CompactHF, Config.borderSize, Config.minRegionArea, Config.mergeRegionArea))
+	{
+		return nullptr;
+	}
+
+	Intermediates.ContourSet = rcAllocContourSet();
+	if (!rcBuildContours(&Context, *Intermediates.CompactHF, Config.maxSimplificationError, Config.maxEdgeLen, *Intermediates.ContourSet))
+	{
+		return nullptr;
+	}
+	if (Intermediates.ContourSet->nconts == 0)
+	{
+		bOutFailed = false;
+		return nullptr;
+	}
+
+	Intermediates.PolyMesh = rcAllocPolyMesh();
+	if (!rcBuildPolyMesh(&Context, *Intermediates.ContourSet, Config.maxVertsPerPoly, *Intermediates.PolyMesh))
+	{
+		return nullptr;
+	}
+
+	rcPolyMesh& PolyMesh = *Intermediates.PolyMesh;
+	if (PolyMesh.npolys == 0)
+	{
+		bOutFailed = false;
+		return nullptr;
+	}
+	if (PolyMesh.nverts >= 0xffff)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecast build: too many vertices in tile (%d, %d)"), TileX, TileY);
+		return nullptr;
+	}
+
+	if (Config.bGenerateDetailedMesh)
+	{
+		Intermediates.DetailMesh = rcAllocPolyMeshDetail();
+		if (!rcBuildPolyMeshDetail(&Context, PolyMesh, *Intermediates.CompactHF, Config.detailSampleDist, Config.detailSampleMaxError, *Intermediates.DetailMesh))
+		{
+			return nullptr;
+		}
+	}
+
+	for (int32 PolyIndex = 0; PolyIndex < PolyMesh.npolys; ++PolyIndex)
+	{
+		PolyMesh.flags[PolyIndex] = PolyMesh.areas[PolyIndex] != RC_NULL_AREA ? SERVERRECAST_POLYFLAG_WALK : 0;
+	}
+
+	dtNavMeshCreateParams Params;
+	FMemory::Memzero(Params);
+	Params.verts = PolyMesh.verts;
+	Params.vertCount = PolyMesh.nverts;
+	Params.polys = PolyMesh.polys;
+	Params.polyAreas = PolyMesh.areas;
+	Params.polyFlags = PolyMesh.flags;
+	Params.polyCount = PolyMesh.npolys;
+	Params.nvp = PolyMesh.nvp;
+	if (Intermediates.DetailMesh)
+	{
+		Params.detailMeshes = Intermediates.DetailMesh->meshes;
+		Params.detailVerts = Intermediates.DetailMesh->verts;
+		Params.detailVertsCount = Intermediates.DetailMesh->nverts;
+		Params.detailTris = Intermediates.DetailMesh->tris;
+		Params.detailTriCount = Intermediates.DetailMesh->ntris;
+	}
+	Params.walkableHeight = Config.AgentHeight;
+	Params.walkableRadius = Config.AgentRadius;
+	Params.walkableClimb = Config.AgentMaxClimb;
+	Params.tileX = TileX;
+	Params.tileY = TileY;
+	Params.tileLayer = 0;
+	rcVcopy(Params.bmin, PolyMesh.bmin);
+	rcVcopy(Params.bmax, PolyMesh.bmax);
+	Params.cs = Config.cs;
+	Params.ch = Config.ch;
+	Params.buildBvTree = true;
+
+	unsigned char* NavData = nullptr;
+	int NavDataSize = 0;
+	if (!dtCreateNavMeshData(&Params, &NavData, &NavDataSize))
+	{
+		UE_LOG(LogNavigation, Error, TEXT("ServerRecast build: failed to create Detour data for tile (%d, %d)"), TileX, TileY);
+		return nullptr;
+	}
+
+	OutDataSize = NavDataSize;
+	bOutFailed = false;
+	return NavData;
+}
+
+bool FServerRecastNavMeshBuilder::Save(const FString& FileName) const
+{
+	return NavMesh && SaveNavMeshSet(*NavMesh, FileName);
+}
+
+FString FServerRecastNavMeshBuilder::GetBuildKey(const FRecastBuildConfig& Config, const FBox& RecastBounds, const TArray<FBox>& InclusionBounds)
+{
+	FSHA1 Hash;
+
+	FServerRecastGeometryFileConfig FileConfig;
+	FMemory::Memzero(FileConfig);
+	FileConfig.Init(Config);
+	Hash.Update((const uint8*)&FileConfig, sizeof(FileConfig));
+
+	auto HashBox = [&Hash](const FBox& Box)
+	{
+		const float Values[] = { Box.Min.X, Box.Min.Y, Box.Min.Z, Box.Max.X, Box.Max.Y, Box.Max.Z };
+		Hash.Update((const uint8*)Values, sizeof(Values));
+	};
+	HashBox(RecastBounds);
+	for (const FBox& Bounds : InclusionBounds)
+	{
+		HashBox(Bounds);
+	}
+
+	Hash.Final();
+	FSHAHash Key;
+	Hash.GetHash(Key.Hash);
+	return Key.ToString();
+}
+
+FString FServerRecastNavMeshBuilder::LoadBuildKey(const FString& NavMeshFileName)
+{
+	FString Key;
+	FFileHelper::LoadFileToString(Key, *GetBuildKeyFileName(NavMeshFileName));
+	return Key.TrimStartAndEnd();
+}
+
+bool FServerRecastNavMeshBuilder::SaveBuildKey(const FString& NavMeshFileName, const FString& Key)
+{
+	return FFileHelper::SaveStringToFile(Key, *GetBuildKeyFileName(NavMeshFileName));
+}
+
+bool FServerRecastNavMeshBuilder::SaveNavMeshSet(const dtNavMesh& InNavMesh, const FString& FileName)
+{
+	FArchive* FileAr = IFileManager::Get().CreateFileWriter(*FileName);
+	if (FileAr == NULL)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to open %s for writing"), *FileName);
+		return false;
+	}
+
+	ServerRecastNavMeshSet::FSetHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = ServerRecastNavMeshSet::Magic;
+	Header.Version = ServerRecastNavMeshSet::Version;
+	Header.Params = *InNavMesh.getParams();
+	for (int32 Index = 0; Index < InNavMesh.getMaxTiles(); ++Index)
+	{
+		const dtMeshTile* Tile = InNavMesh.getTile(Index);
+		if (Tile && Tile->header && Tile->dataSize)
+		{
+			++Header.NumTiles;
+		}
+	}
+	const int32 NumTiles = Header.NumTiles;
+#if !PLATFORM_LITTLE_ENDIAN
+	// files are always little endian, servers load them as is
+	static_assert(sizeof(Header) % sizeof(uint32) == 0, "set header is expected to hold 32-bit fields only");
+	for (uint32* Word = (uint32*)&Header; Word < (uint32*)(&Header + 1); ++Word)
+	{
+		*Word = BYTESWAP_ORDER32(*Word);
+	}
+	TArray<uint8> SwappedData;
+#endif
+	FileAr->Serialize(&Header, sizeof(Header));
+
+	// tile blobs go to the file straight from the navmesh, links patched in by addTile are rebuilt on load
+	for (int32 Index = 0; Index < InNavMesh.getMaxTiles(); ++Index)
+	{
+		const dtMeshTile* Tile = InNavMesh.getTile(Index);
+		if (Tile == nullptr || Tile->header == nullptr || Tile->dataSize == 0)
+		{
+			continue;
+		}
+
+		ServerRecastNavMeshSet::FTileHeader TileHeader;
+		FMemory::Memzero(TileHeader);
+		TileHeader.TileRef = InNavMesh.getTileRef(Tile);
+		TileHeader.DataSize = Tile->dataSize;
+		const uint8* TileData = Tile->data;
+#if !PLATFORM_LITTLE_ENDIAN
+		SwappedData.Reset();
+		SwappedData.Append(Tile->data, Tile->dataSize);
+		dtNavMeshDataSwapEndian(SwappedData.GetData(), SwappedData.Num());
+		dtNavMeshHeaderSwapEndian(SwappedData.GetData(), SwappedData.Num());
+		TileData = SwappedData.GetData();
+		TileHeader.TileRef = BYTESWAP_ORDER64(TileHeader.TileRef);
+		TileHeader.DataSize = BYTESWAP_ORDER32(TileHeader.DataSize);
+#endif
+		FileAr->Serialize(&TileHeader, sizeof(TileHeader));
+		FileAr->Serialize(const_cast<uint8*>(TileData), Tile->dataSize);
+	}
+
+	const bool bSuccess = !FileAr->IsError();
+	FileAr->Close();
+	delete FileAr;
+
+	if (bSuccess)
+	{
+		UE_LOG(LogNavigation, Log, TEXT("ServerRecast: %d navmesh tiles saved to %s"), NumTiles, *FileName);
+	}
+	return bSuccess;
+}
+
+dtNavMesh* FServerRecastNavMeshBuilder::LoadNavMeshSet(const FString& FileName)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *FileName, FILEREAD_Silent) || FileData.Num() < (int32)sizeof(ServerRecastNavMeshSet::FSetHeader))
+	{
+		return nullptr;
+	}
+
+	const ServerRecastNavMeshSet::FSetHeader& Header = *reinterpret_cast<const ServerRecastNavMeshSet::FSetHeader*>(FileData.GetData());
+	if (Header.Magic != ServerRecastNavMeshSet::Magic || Header.Version != ServerRecastNavMeshSet::Version)
+	{
+		UE_LOG(LogNavigation, Warning, TEXT("%s is not a navmesh set"), *FileName);
+		return nullptr;
+	}
+
+	dtNavMesh* LoadedNavMesh = dtAllocNavMesh();
+	if (LoadedNavMesh == nullptr || dtStatusFailed(LoadedNavMesh->init(&Header.Params)))
+	{
+		dtFreeNavMesh(LoadedNavMesh);
+		return nullptr;
+	}
+
+	int32 Offset = sizeof(ServerRecastNavMeshSet::FSetHeader);
+	for (int32 TileIndex = 0; TileIndex < Header.NumTiles; ++TileIndex)
+	{
+		if (Offset + (int32)sizeof(ServerRecastNavMeshSet::FTileHeader) > FileData.Num())
+		{
+			break;
+		}
+
+		ServerRecastNavMeshSet::FTileHeader TileHeader;
+		FMemory::Memcpy(&TileHeader, FileData.GetData() + Offset, sizeof(TileHeader));
+		Offset += sizeof(TileHeader);
+		// int32 sum would wrap for a corrupt DataSize
+		if (TileHeader.TileRef == 0 || TileHeader.DataSize <= 0 || (int64)Offset + TileHeader.DataSize > FileData.Num())
+		{
+			break;
+		}
+
+		// Detour writes links into tile data, every tile needs its own dtAlloc'd copy
+		uint8* Data = (uint8*)dtAlloc(TileHeader.DataSize, DT_ALLOC_PERM);
+		if (Data == nullptr)
+		{
+			break;
+		}
+		FMemory::Memcpy(Data, FileData.GetData() + Offset, TileHeader.DataSize);
+		Offset += TileHeader.DataSize;
+
+		if (dtStatusFailed(LoadedNavMesh->addTile(Data, TileHeader.DataSize, DT_TILE_FREE_DATA, TileHeader.TileRef, nullptr)))
+		{
+			dtFree(Data);
+		}
+	}
+
+	return LoadedNavMesh;
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastStats.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_STAT(STAT_ServerRecast_Gather);
+DEFINE_STAT(STAT_ServerRecast_AreaGrow);
+DEFINE_STAT(STAT_ServerRecast_GeometryBuffers);
+DEFINE_STAT(STAT_ServerRecast_TriangleFilter);
+DEFINE_STAT(STAT_ServerRecast_WriteGeometry);
+DEFINE_STAT(STAT_ServerRecast_WriteOBJ);
+DEFINE_STAT(STAT_ServerRecast_WriteTiledGeometry);
+DEFINE_STAT(STAT_ServerRecast_Voxelize);
+DEFINE_STAT(STAT_ServerRecast_BuildNavMesh);
+DEFINE_STAT(STAT_ServerRecast_BuildTile);
+DEFINE_STAT(STAT_ServerRecast_SaveNavMesh);
+DEFINE_STAT(STAT_ServerRecast_BuildTileGraph);
+
+DEFINE_STAT(STAT_ServerRecast_GeometryBufferMemory);
+DEFINE_STAT(STAT_ServerRecast_GeometryBufferPeak);
+
+namespace ServerRecastStats
+{
+	static FCriticalSection GeometryBufferLock;
+	static int64 GeometryBufferBytes = 0;
+	static int64 GeometryBufferPeak = 0;
+
+	void AddGeometryBufferMemory(int64 Delta)
+	{
+		FScopeLock Lock(&GeometryBufferLock);
+		GeometryBufferBytes += Delta;
+		GeometryBufferPeak = FMath::Max(GeometryBufferPeak, GeometryBufferBytes);
+
+		if (Delta >= 0)
+		{
+			INC_MEMORY_STAT_BY(STAT_ServerRecast_GeometryBufferMemory, Delta);
+		}
+		else
+		{
+			DEC_MEMORY_STAT_BY(STAT_ServerRecast_GeometryBufferMemory, -Delta);
+		}
+		SET_MEMORY_STAT(STAT_ServerRecast_GeometryBufferPeak, GeometryBufferPeak);
+	}
+
+	int64 GetGeometryBufferPeak()
+	{
+		FScopeLock Lock(&GeometryBufferLock);
+		return GeometryBufferPeak;
+	}
+
+	void ResetGeometryBufferPeak()
+	{
+		FScopeLock Lock(&GeometryBufferLock);
+		GeometryBufferPeak = GeometryBufferBytes;
+	}
+}
@@ -0,0 +1,316 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastStreamWriter.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/FileManager.h"
+#include "HAL/Event.h"
+#include "Async/Async.h"
+#include "Misc/Paths.h"
+#include "Misc/Compression.h"
+#include "ServerRecastCompressedFile.h"
+
+FServerRecastStreamWriter::FServerRecastStreamWriter(int32 InBufferSize, int32 InNumBuffers)
+	: BufferSize(InBufferSize)
+	, PendingEvent(nullptr)
+	, FreeEvent(nullptr)
+	, File(nullptr)
+	, bIOError(false)
+	, bCompress(false)
+	, FileOffset(0)
+	, Current(INDEX_NONE)
+	, Begin(nullptr)
+	, Cursor(nullptr)
+	, End(nullptr)
+	, SubmittedBytes(0)
+{
+	Buffers.SetNum(FMath::Max(InNumBuffers, 2));
+}
+
+FServerRecastStreamWriter::~FServerRecastStreamWriter()
+{
+	Close();
+}
+
+bool FServerRecastStreamWriter::Open(const FString& FileName, bool bInCompress)
+{
+	check(!bInCompress || BufferSize <= SERVERRECAST_COMPRESSED_MAX_CHUNK_SIZE);
+	Close();
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(FileName), true);
+	File = FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*FileName);
+	if (File == nullptr)
+	{
+		UE_LOG(LogNavigation, Error, TEXT("Failed to open %s for writing"), *FileName);
+		return false;
+	}
+
+	bIOError = false;
+	SubmittedBytes = 0;
+	FileOffset = 0;
+	ChunkTable.Reset();
+
+	bCompress = bInCompress;
+	if (bCompress)
+	{
+		// enough chunks in flight to keep every worker compressing, header is patched on close
+		Buffers.SetNum(FMath::Max(Buffers.Num(), 2 * (FTaskGraphInterface::Get().GetNumWorkerThreads() + 1)));
+
+		FServerRecastCompressedFileHeader Header;
+		FMemory::Memzero(Header);
+		File->Write((const uint8*)&Header, sizeof(Header));
+		FileOffset = sizeof(Header);
+	}
+
+	PendingEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	FreeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	for (int32 Index = 0; Index < Buffers.Num(); ++Index)
+	{
+		FreeBuffers.Enqueue(Index);
+	}
+
+	IOThread = Async<void>(EAsyncExecution::Thread, [this]() { RunIOThread(); });
+
+	AcquireBuffer();
+	return true;
+}
+
+bool FServerRecastStreamWriter::Close(const void* HeadData, int64 HeadSize)
+{
+	check(HeadData == nullptr || (!bCompress && HeadSize <= Tell()));
+
+	if (File == nullptr)
+	{
+		return false;
+	}
+
+	if (Cursor != Begin)
+	{
+		Submit();
+	}
+
+	PendingBuffers.Enqueue(INDEX_NONE);
+	PendingEvent->Trigger();
+	IOThread.Wait();
+	IOThread = TFuture<void>();
+
+	if (bCompress && !bIOError)
+	{
+		FServerRecastCompressedFileHeader Header;
+		FMemory::Memzero(Header);
+		Header.Magic = SERVERRECAST_COMPRESSED_MAGIC;
+		Header.Version = SERVERRECAST_COMPRESSED_VERSION;
+		Header.ChunkSize = BufferSize;
+		Header.NumChunks = ChunkTable.Num();
+		Header.UncompressedSize = SubmittedBytes;
+		Header.TableOffset = FileOffset;
+
+		bIOError = !File->Write((const uint8*)ChunkTable.GetData(), ChunkTable.Num() * sizeof(FServerRecastCompressedChunk)) ||
+			!File->Seek(0) ||
+			!File->Write((const uint8*)&Header, sizeof(Header));
+	}
+	else if (HeadData && !bIOError)
+	{
+		bIOError = !File->Seek(0) || !File->Write((const uint8*)HeadData, HeadSize);
+	}
+
+	delete File;
+	File = nullptr;
+
+	FPlatformProcess::ReturnSynchEventToPool(PendingEvent);
+	FPlatformProcess::ReturnSynchEventToPool(FreeEvent);
+	PendingEvent = nullptr;
+	FreeEvent = nullptr;
+
+	int32 Index;
+	while (FreeBuffers.Dequeue(Index))
+	{
+	}
+	for (FBuffer& Buffer : Buffers)
+	{
+		Buffer.Data.Empty();
+		Buffer.Compressed.Empty();
+	}
+	Current = INDEX_NONE;
+	Begin = Cursor = End = nullptr;
+
+	return !bIOError;
+}
+
+void FServerRecastStreamWriter::Write(const void* Data, int64 Size)
+{
+	const uint8* Src = (const uint8*)Data;
+	while (Size > 0)
+	{
+		if (Cursor == End)
+		{
+			Submit();
+		}
+
+		const int64 Chunk = FMath::Min<int64>(Size, End - Cursor);
+		FMemory::Memcpy(Cursor, Src, Chunk);
+		Cursor += Chunk;
+		Src += Chunk;
+		Size -= Chunk;
+	}
+}
+
+void FServerRecastStreamWriter::Submit()
+{
+	FBuffer& Buffer = Buffers[Current];
+	Buffer.Used = Cursor - Begin;
+	SubmittedBytes += Buffer.Used;
+
+	if (bCompress)
+	{
+		Buffer.CompressTask = Async<void>(EAsyncExecution::TaskGraph, [&Buffer]()
+			{
+				int32 CompressedSize = FCompression::CompressMemoryBound(COMPRESS_ZLIB, Buffer.Used);
+				Buffer.Compressed.SetNumUninitialized(CompressedSize, false);
+				if (!FCompression::CompressMemory((ECompressionFlags)(COMPRESS_ZLIB | COMPRESS_BiasSpeed), Buffer.Compressed.GetData(), CompressedSize, Buffer.Data.GetData(), Buffer.Used) ||
+					CompressedSize >= Buffer.Used)
+				{
+					// incompressible, chunk is stored as is
+					CompressedSize = 0;
+				}
+				Buffer.Compressed.SetNum(CompressedSize, false);
+			});
+	}
+
+	PendingBuffers.Enqueue(Current);
+	PendingEvent->Trigger();
+
+	AcquireBuffer();
+}
+
+void FServerRecastStreamWriter::AcquireBuffer()
+{
+	// all buffers are queued for writing, producer is faster than the disk
+	while (!FreeBuffers.Dequeue(Current))
+	{
+		FreeEvent->Wait();
+	}
+
+	FBuffer& Buffer = Buffers[Current];
+	if (Buffer.Data.Num() != BufferSize)
+	{
+		Buffer.Data.SetNumUninitialized(BufferSize);
+	}
+	Buffer.Used = 0;
+
+	Begin = Cursor = Buffer.Data.GetData();
+	End = Begin + BufferSize;
+}
+
+void FServerRecastStreamWriter::RunIOThread()
+{
+	for (;;)
+	{
+		int32 Index;
+		if (!PendingBuffers.Dequeue(Index))
+		{
+			PendingEvent->Wait();
+			continue;
+		}
+
+		if (Index == INDEX_NONE)
+		{
+			break;
+		}
+
+		FBuffer& Buffer = Buffers[Index];
+		const uint8* Data = Buffer.Data.GetData();
+		int32 Size = Buffer.Used;
+		if (bCompress)
+		{
+			Buffer.CompressTask.Wait();
+			Buffer.CompressTask = TFuture<void>();
+
+			FServerRecastCompressedChunk& Chunk = ChunkTable[ChunkTable.AddUninitialized()];
+			Chunk.Offset = FileOffset;
+			Chunk.UncompressedSize = Buffer.Used;
+			if (Buffer.Compressed.Num())
+			{
+				Data = Buffer.Compressed.GetData();
+				Size = Buffer.Compressed.Num();
+			}
+			Chunk.CompressedSize = Size;
+		}
+
+		if (!bIOError && !File->Write(Data, Size))
+		{
+			bIOError = true;
+		}
+		FileOffset += Size;
+
+		FreeBuffers.Enqueue(Index);
+		FreeEvent->Trigger();
+	}
+}
+
+namespace ServerRecastTextFormat
+{
+	FORCEINLINE ANSICHAR* WriteDigits(uint64 Value, ANSICHAR* Out)
+	{
+		ANSICHAR Digits[24];
+		int32 NumDigits = 0;
+		do
+		{
+			Digits[NumDigits++] = (ANSICHAR)('0' + Value % 10);
+			Value /= 10;
+		} while (Value);
+
+		while (NumDigits)
+		{
+			*Out++ = Digits[--NumDigits];
+		}
+		return Out;
+	}
+
+	int32 FormatFloat(float Value, ANSICHAR* Out)
+	{
+		// float has 24 bit mantissa and 1e6 needs 20, product is exact in double
+		const double Scaled = FMath::Abs((double)Value * 1000000.0);
+		if (!(Scaled < 9.0e18))
+		{
+			// nan, inf or too big for integer path
+			return FCStringAnsi::Sprintf(Out, "%f", Value);
+		}
+
+		uint64 Fixed = (uint64)Scaled;
+		const double Remainder = Scaled - (double)Fixed;
+		if (Remainder > 0.5 || (Remainder == 0.5 && (Fixed & 1)))
+		{
+			++Fixed;
+		}
+
+		ANSICHAR* Cursor = Out;
+		if (FMath::IsNegativeFloat(Value))
+		{
+			*Cursor++ = '-';
+		}
+
+		Cursor = WriteDigits(Fixed / 1000000, Cursor);
+		*Cursor++ = '.';
+
+		uint32 Fraction = (uint32)(Fixed % 1000000);
+		for (int32 Digit = 5; Digit >= 0; --Digit)
+		{
+			Cursor[Digit] = (ANSICHAR)('0' + Fraction % 10);
+			Fraction /= 10;
+		}
+		Cursor += 6;
+
+		return Cursor - Out;
+	}
+
+	int32 FormatInt(int64 Value, ANSICHAR* Out)
+	{
+		ANSICHAR* Cursor = Out;
+		uint64 Magnitude = (uint64)Value;
+		if (Value < 0)
+		{
+			*Cursor++ = '-';
+			Magnitude = 0 - Magnitude;
+		}
+		return WriteDigits(Magnitude, Cursor) - Out;
+	}
+}
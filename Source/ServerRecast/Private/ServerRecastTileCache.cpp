@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastTileCache.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Misc/Crc.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
+
+namespace ServerRecastTileCache
+{
+	static const uint32 Magic = 'S' << 24 | 'R' << 16 | 'T' << 8 | 'C';
+	static const uint32 Version = 2;
+
+	struct FEntryHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		int32 DataSize;
+		uint32 DataCrc;
+		/** key repeated, a renamed or truncated entry is a miss */
+		uint8 Key[20];
+	};
+
+	/** blob must be a whole tile of the Detour version we link with before it goes to dtNavMesh::addTile */
+	static bool IsValidTile(const uint8* Data, int32 DataSize)
+	{
+		if (DataSize < (int32)sizeof(dtMeshHeader))
+		{
+			return false;
+		}
+		dtMeshHeader Header;
+		FMemory::Memcpy(&Header, Data, sizeof(Header));
+		return Header.magic == DT_NAVMESH_MAGIC && Header.version == DT_NAVMESH_VERSION;
+	}
+}
+
+FServerRecastTileCache::FServerRecastTileCache(const FString& InDirectory, int64 InMaxSize)
+	: Directory(InDirectory)
+	, MaxSize(InMaxSize)
+{
+}
+
+FString FServerRecastTileCache::GetEntryFileName(const FSHAHash& Key) const
+{
+	const FString KeyString = Key.ToString();
+	return Directory / KeyString.Left(2) / KeyString + TEXT(".tile");
+}
+
+bool FServerRecastTileCache::Load(const FSHAHash& Key, TArray<uint8>& OutData)
+{
+	using namespace ServerRecastTileCache;
+	OutData.Reset();
+
+	const FString FileName = GetEntryFileName(Key);
+	TArray<uint8> Entry;
+	if (!FFileHelper::LoadFileToArray(Entry, *FileName, FILEREAD_Silent))
+	{
+		NumMisses.Increment();
+		return false;
+	}
+
+	FEntryHeader Header;
+	const uint8* Data = Entry.GetData() + sizeof(FEntryHeader);
+	bool bValid = Entry.Num() >= (int32)sizeof(FEntryHeader);
+	if (bValid)
+	{
+		FMemory::Memcpy(&Header, Entry.GetData(), sizeof(Header));
+		bValid = Header.Magic == Magic && Header.Version == Version && Header.DataSize == Entry.Num() - (int32)sizeof(FEntryHeader) &&
+			FMemory::Memcmp(Header.Key, Key.Hash, sizeof(Header.Key)) == 0 &&
+			FCrc::MemCrc32(Data, Header.DataSize) == Header.DataCrc &&
+			(Header.DataSize == 0 || IsValidTile(Data, Header.DataSize));
+	}
+	if (!bValid)
+	{
+		// old version or damaged on disk, the rebuilt tile takes its place
+		UE_LOG(LogNavigation, Warning, TEXT("ServerRecast tile cache: dropping invalid entry %s"), *FileName);
+		IFileManager::Get().Delete(*FileName, false, false, true);
+		NumMisses.Increment();
+		return false;
+	}
+
+	OutData.Append(Data, Header.DataSize);
+	NumHits.Increment();
+	BytesRead.Add(Entry.Num());
+
+	// least recently used entries go first when the cache is pruned
+	IFileManager::Get().SetTimeStamp(*FileName, FDateTime::UtcNow());
+	return true;
+}
+
+void FServerRecastTileCache::Store(const FSHAHash& Key, const uint8* Data, int32 DataSize)
+{
+	using namespace ServerRecastTileCache;
+
+	const FString FileName = GetEntryFileName(Key);
+	IFileManager& FileManager = IFileManager::Get();
+	if (FileManager.FileExists(*FileName))
+	{
+		return;
+	}
+
+	FEntryHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.DataSize = Data ? DataSize : 0;
+	Header.DataCrc = FCrc::MemCrc32(Data, Header.DataSize);
+	FMemory::Memcpy(Header.Key, Key.Hash, sizeof(Header.Key));
+
+	TArray<uint8> Entry;
+	Entry.SetNumUninitialized(sizeof(FEntryHeader) + Header.DataSize);
+	FMemory::Memcpy(Entry.GetData(), &Header, sizeof(Header));
+	if (Header.DataSize)
+	{
+		FMemory::Memcpy(Entry.GetData() + sizeof(FEntryHeader), Data, Header.DataSize);
+	}
+
+	// another process may store the same key at the same time, both write equal content
+	const FString TempFileName = FileName + TEXT(".") + FGuid::NewGuid().ToString() + TEXT(".tmp");
+	if (!FFileHelper::SaveArrayToFile(Entry, *TempFileName))
+	{
+		UE_LOG(LogNavigation, Warning, TEXT("ServerRecast tile cache: failed to write %s"), *TempFileName);
+		return;
+	}
+	if (!FileManager.Move(*FileName, *TempFileName, true, true, false, true))
+	{
+		FileManager.Delete(*TempFileName, false, false, true);
+		return;
+	}
+
+	NumStores.Increment();
+	BytesWritten.Add(Entry.Num());
+}
+
+void FServerRecastTileCache::Prune()
+{
+	if (MaxSize <= 0)
+	{
+		return;
+	}
+
+	struct FEntryStat
+	{
+		FString FileName;
+		FDateTime Time;
+		int64 Size;
+	};
+
+	// temporary files belong to writers in flight, only finished entries count
+	TArray<FEntryStat> Entries;
+	int64 TotalSize = 0;
+	IFileManager& FileManager = IFileManager::Get();
+	FileManager.IterateDirectoryStatRecursively(*Directory, [&Entries, &TotalSize](const TCHAR* FileName, const FFileStatData& StatData)
+		{
+			if (!StatData.bIsDirectory && FPaths::GetExtension(FileName) == TEXT("tile"))
+			{
+				Entries.Add({ FileName, StatData.ModificationTime, StatData.FileSize });
+				TotalSize += StatData.FileSize;
+			}
+			return true;
+		});
+
+	if (TotalSize <= MaxSize)
+	{
+		return;
+	}
+
+	Entries.Sort([](const FEntryStat& A, const FEntryStat& B) { return A.Time < B.Time; });
+	const int64 StartSize = TotalSize;
+	int32 NumDeleted = 0;
+	for (int32 i = 0; i < Entries.Num() && TotalSize > MaxSize; ++i)
+	{
+		// entry may be in use by another process, it's removed by a later prune then
+		if (FileManager.Delete(*Entries[i].FileName, false, false, true))
+		{
+			TotalSize -= Entries[i].Size;
+			++NumDeleted;
+		}
+	}
+
+	UE_LOG(LogNavigation, Log, TEXT("ServerRecast tile cache %s: pruned %d entries, %lld KB -> %lld KB"),
+		*Directory, NumDeleted, StartSize / 1024, TotalSize / 1024);
+	NumPruned.Add(NumDeleted);
+}
+
+void FServerRecastTileCache::LogStats() const
+{
+	const int32 NumLookups = GetNumHits() + GetNumMisses();
+	UE_LOG(LogNavigation, Log, TEXT("ServerRecast tile cache %s: %d hits, %d misses (%.1f%% hit rate), %d stored, %lld KB read, %lld KB written"),
+		*Directory, GetNumHits(), GetNumMisses(), NumLookups ? 100.f * GetNumHits() / NumLookups : 0.f, GetNumStores(), GetBytesRead() / 1024, GetBytesWritten() / 1024);
+}
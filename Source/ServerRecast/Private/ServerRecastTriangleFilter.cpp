@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastTriangleFilter.h"
+#include "Navmesh/RecastHelpers.h"
+#include "Navmesh/RecastNavMeshGenerator.h"
+#include "Async/ParallelFor.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && !PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#define SERVERRECAST_FILTER_SSE 1
+#include <xmmintrin.h>
+#else
+#define SERVERRECAST_FILTER_SSE 0
+#endif
+
+namespace ServerRecastTriangleFilter
+{
+	/** triangles per parallel job */
+	static const int32 ChunkSize = 64 * 1024;
+
+#if SERVERRECAST_FILTER_SSE
+	// same shuffle as ServerRecastVertexTransform, a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+	FORCEINLINE void Deinterleave4(const float* Src, __m128& X, __m128& Y, __m128& Z)
+	{
+		const __m128 A = _mm_loadu_ps(Src + 0);
+		const __m128 B = _mm_loadu_ps(Src + 4);
+		const __m128 C = _mm_loadu_ps(Src + 8);
+
+		const __m128 T0 = _mm_shuffle_ps(B, C, _MM_SHUFFLE(2, 1, 3, 2));
+		const __m128 T1 = _mm_shuffle_ps(A, B, _MM_SHUFFLE(1, 0, 2, 1));
+		X = _mm_shuffle_ps(A, T0, _MM_SHUFFLE(2, 0, 3, 0));
+		Y = _mm_shuffle_ps(T1, T0, _MM_SHUFFLE(3, 1, 2, 0));
+		Z = _mm_shuffle_ps(T1, C, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+#endif // SERVERRECAST_FILTER_SSE
+}
+
+FServerRecastTriangleFilter::FServerRecastTriangleFilter(const FRecastBuildConfig& Config, TArrayView<const FBox> InclusionBounds, bool bCullUnwalkable)
+{
+	const float BorderSize = Config.borderSize * Config.cs;
+	const float HeightAbove = Config.walkableHeight * Config.ch;
+	const float HeightBelow = Config.walkableClimb * Config.ch;
+
+	FBox MergedBounds(ForceInit);
+	for (const FBox& Box : InclusionBounds)
+	{
+		if (!Box.IsValid)
+		{
+			continue;
+		}
+
+		// triangles in tile border or within agent height still shape the navmesh inside
+		FBox RecastBox = Unreal2RecastBox(Box);
+		RecastBox.Min -= FVector(BorderSize, HeightBelow, BorderSize);
+		RecastBox.Max += FVector(BorderSize, HeightAbove, BorderSize);
+		Bounds.Add(RecastBox);
+		MergedBounds += RecastBox;
+	}
+
+	if (Bounds.Num() > MaxBounds)
+	{
+		Bounds.Reset();
+		Bounds.Add(MergedBounds);
+	}
+
+	WalkableThreshold = FMath::Cos(FMath::DegreesToRadians(Config.walkableSlopeAngle));
+	MaxUnwalkableHeight = bCullUnwalkable ? Config.walkableClimb * Config.ch : 0.f;
+}
+
+void FServerRecastTriangleFilter::ComputeOutcodes(const float* Coords, int32 NumVerts, uint64* OutCodes) const
+{
+	int32 Index = 0;
+#if SERVERRECAST_FILTER_SSE
+	// the 4 vertex block reads 12 floats, stop a block early so the last load stays in bounds
+	for (; Index + 4 <= NumVerts; Index += 4)
+	{
+		__m128 X, Y, Z;
+		ServerRecastTriangleFilter::Deinterleave4(Coords + Index * 3, X, Y, Z);
+
+		uint64 Codes[4] = { 0, 0, 0, 0 };
+		for (int32 BoxIndex = 0; BoxIndex < Bounds.Num(); ++BoxIndex)
+		{
+			const FBox& Box = Bounds[BoxIndex];
+			const int32 Masks[6] = {
+				_mm_movemask_ps(_mm_cmplt_ps(X, _mm_set1_ps(Box.Min.X))),
+				_mm_movemask_ps(_mm_cmplt_ps(Y, _mm_set1_ps(Box.Min.Y))),
+				_mm_movemask_ps(_mm_cmplt_ps(Z, _mm_set1_ps(Box.Min.Z))),
+				_mm_movemask_ps(_mm_cmpgt_ps(X, _mm_set1_ps(Box.Max.X))),
+				_mm_movemask_ps(_mm_cmpgt_ps(Y, _mm_set1_ps(Box.Max.Y))),
+				_mm_movemask_ps(_mm_cmpgt_ps(Z, _mm_set1_ps(Box.Max.Z))) };
+
+			for (int32 Plane = 0; Plane < 6; ++Plane)
+			{
+				for (int32 Lane = 0; Lane < 4; ++Lane)
+				{
+					Codes[Lane] |= (uint64)((Masks[Plane] >> Lane) & 1) << (BoxIndex * 6 + Plane);
+				}
+			}
+		}
+		FMemory::Memcpy(OutCodes + Index, Codes, sizeof(Codes));
+	}
+#endif // SERVERRECAST_FILTER_SSE
+
+	for (; Index < NumVerts; ++Index)
+	{
+		const float* Vert = Coords + Index * 3;
+		uint64 Code = 0;
+		for (int32 BoxIndex = 0; BoxIndex < Bounds.Num(); ++BoxIndex)
+		{
+			const FBox& Box = Bounds[BoxIndex];
+			const uint64 BoxCode =
+				(Vert[0] < Box.Min.X ? 1 : 0) | (Vert[1] < Box.Min.Y ? 2 : 0) | (Vert[2] < Box.Min.Z ? 4 : 0) |
+				(Vert[0] > Box.Max.X ? 8 : 0) | (Vert[1] > Box.Max.Y ? 16 : 0) | (Vert[2] > Box.Max.Z ? 32 : 0);
+			Code |= BoxCode << (BoxIndex * 6);
+		}
+		OutCodes[Index] = Code;
+	}
+}
+
+int32 FServerRecastTriangleFilter::Filter(const float* Coords, int32 NumVerts, int32* Indices, int32 NumTris, FServerRecastTriangleFilterStats& InOutStats) const
+{
+	TArray<uint64> OutCodes;
+	if (Bounds.Num())
+	{
+		OutCodes.SetNumUninitialized(NumVerts);
+		ComputeOutcodes(Coords, NumVerts, OutCodes.GetData());
+	}
+
+	return FilterRange(Coords, OutCodes.Num() ? OutCodes.GetData() : nullptr, Indices, NumTris, InOutStats);
+}
+
+int32 FServerRecastTriangleFilter::FilterRange(const float* Coords, const uint64* OutCodes, int32* Indices, int32 NumTris, FServerRecastTriangleFilterStats& InOutStats) const
+{
+	int32 NumKept = 0;
+	for (int32 TriIndex = 0; TriIndex < NumTris; ++TriIndex)
+	{
+		const int32* Tri = Indices + TriIndex * 3;
+
+		// outside the union when for every box all three corners are beyond one of its planes
+		if (OutCodes)
+		{
+			const uint64 Common = OutCodes[Tri[0]] & OutCodes[Tri[1]] & OutCodes[Tri[2]];
+			bool bOutside = true;
+			for (int32 BoxIndex = 0; BoxIndex < Bounds.Num() && bOutside; ++BoxIndex)
+			{
+				bOutside = ((Common >> (BoxIndex * 6)) & 63) != 0;
+			}
+			if (bOutside)
+			{
+				InOutStats.NumOutsideBounds++;
+				continue;
+			}
+		}
+
+		// normal as in rcMarkWalkableTriangles
+		const float* V0 = Coords + Tri[0] * 3;
+		const float* V1 = Coords + Tri[1] * 3;
+		const float* V2 = Coords + Tri[2] * 3;
+		const FVector E0(V1[0] - V0[0], V1[1] - V0[1], V1[2] - V0[2]);
+		const FVector E1(V2[0] - V0[0], V2[1] - V0[1], V2[2] - V0[2]);
+		const FVector Normal = FVector::CrossProduct(E0, E1);
+		const float NormalSize = Normal.Size();
+		if (NormalSize <= 0.f)
+		{
+			InOutStats.NumDegenerate++;
+			continue;
+		}
+
+		if (MaxUnwalkableHeight > 0.f && Normal.Y / NormalSize <= WalkableThreshold &&
+			FMath::Max3(V0[1], V1[1], V2[1]) - FMath::Min3(V0[1], V1[1], V2[1]) <= MaxUnwalkableHeight)
+		{
+			InOutStats.NumUnwalkable++;
+			continue;
+		}
+
+		if (NumKept != TriIndex)
+		{
+			FMemory::Memcpy(Indices + NumKept * 3, Tri, sizeof(int32) * 3);
+		}
+		NumKept++;
+	}
+
+	InOutStats.NumInput += NumTris;
+	return NumKept;
+}
+
+int32 FServerRecastTriangleFilter::FilterParallel(const float* Coords, int32 NumVerts, int32* Indices, int32 NumTris, FServerRecastTriangleFilterStats& InOutStats) const
+{
+	TArray<uint64> OutCodes;
+	if (Bounds.Num())
+	{
+		OutCodes.SetNumUninitialized(NumVerts);
+		const int32 NumVertChunks = FMath::DivideAndRoundUp(NumVerts, ServerRecastTriangleFilter::ChunkSize);
+		ParallelFor(NumVertChunks, [&](int32 ChunkIndex)
+			{
+				const int32 First = ChunkIndex * ServerRecastTriangleFilter::ChunkSize;
+				ComputeOutcodes(Coords + First * 3, FMath::Min(ServerRecastTriangleFilter::ChunkSize, NumVerts - First), OutCodes.GetData() + First);
+			});
+	}
+
+	// chunks compact themselves in parallel, then move down in chunk order so output matches the serial filter
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumTris, ServerRecastTriangleFilter::ChunkSize);
+	TArray<int32> ChunkKept;
+	ChunkKept.SetNumZeroed(NumChunks);
+	TArray<FServerRecastTriangleFilterStats> ChunkStats;
+	ChunkStats.SetNum(NumChunks);
+
+	ParallelFor(NumChunks, [&](int32 ChunkIndex)
+		{
+			const int32 FirstTri = ChunkIndex * ServerRecastTriangleFilter::ChunkSize;
+			const int32 NumChunkTris = FMath::Min(ServerRecastTriangleFilter::ChunkSize, NumTris - FirstTri);
+			ChunkKept[ChunkIndex] = FilterRange(Coords, OutCodes.Num() ? OutCodes.GetData() : nullptr, Indices + FirstTri * 3, NumChunkTris, ChunkStats[ChunkIndex]);
+		});
+
+	int32 NumKept = 0;
+	for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ++ChunkIndex)
+	{
+		const int32 FirstTri = ChunkIndex * ServerRecastTriangleFilter::ChunkSize;
+		if (NumKept != FirstTri)
+		{
+			FMemory::Memmove(Indices + NumKept * 3, Indices + FirstTri * 3, sizeof(int32) * 3 * ChunkKept[ChunkIndex]);
+		}
+		NumKept += ChunkKept[ChunkIndex];
+		InOutStats += ChunkStats[ChunkIndex];
+	}
+
+	return NumKept;
+}
@@ -0,0 +1,220 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastVertexTransform.h"
+#include "Navmesh/RecastHelpers.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && !PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#define SERVERRECAST_TRANSFORM_SSE 1
+#include <xmmintrin.h>
+#else
+#define SERVERRECAST_TRANSFORM_SSE 0
+#endif
+
+// 8-wide path needs the module to be compiled with AVX enabled (/arch:AVX2 or -mavx2)
+#if SERVERRECAST_TRANSFORM_SSE && (defined(__AVX2__) || defined(__AVX__))
+#define SERVERRECAST_TRANSFORM_AVX 1
+#include <immintrin.h>
+#else
+#define SERVERRECAST_TRANSFORM_AVX 0
+#endif
+
+FServerRecastAffine3x4 FServerRecastAffine3x4::MakeInstanceToRecast(const FTransform& InstanceTransform)
+{
+	return MakeFromLocalToRecastWorld(InstanceTransform.ToMatrixWithScale() * Unreal2RecastMatrix());
+}
+
+FServerRecastAffine3x4 FServerRecastAffine3x4::MakeFromLocalToRecastWorld(const FMatrix& LocalToRecastWorld)
+{
+	// Recast2UnrealPoint(V) is (-V[0], -V[2], V[1]), fold it into the matrix rows
+	FServerRecastAffine3x4 Result;
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		Result.M[Axis][0] = -LocalToRecastWorld.M[0][Axis];
+		Result.M[Axis][1] = LocalToRecastWorld.M[2][Axis];
+		Result.M[Axis][2] = -LocalToRecastWorld.M[1][Axis];
+		Result.M[Axis][3] = LocalToRecastWorld.M[3][Axis];
+	}
+	return Result;
+}
+
+namespace ServerRecastVertexTransform
+{
+#if SERVERRECAST_TRANSFORM_SSE
+	// a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+	FORCEINLINE void Deinterleave4(const float* Src, __m128& X, __m128& Y, __m128& Z)
+	{
+		const __m128 A = _mm_loadu_ps(Src + 0);
+		const __m128 B = _mm_loadu_ps(Src + 4);
+		const __m128 C = _mm_loadu_ps(Src + 8);
+
+		const __m128 T0 = _mm_shuffle_ps(B, C, _MM_SHUFFLE(2, 1, 3, 2));	// x2 y2 x3 y3
+		const __m128 T1 = _mm_shuffle_ps(A, B, _MM_SHUFFLE(1, 0, 2, 1));	// y0 z0 y1 z1
+		X = _mm_shuffle_ps(A, T0, _MM_SHUFFLE(2, 0, 3, 0));
+		Y = _mm_shuffle_ps(T1, T0, _MM_SHUFFLE(3, 1, 2, 0));
+		Z = _mm_shuffle_ps(T1, C, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+	FORCEINLINE void Interleave4(const __m128& X, const __m128& Y, const __m128& Z, float* Dest)
+	{
+		const __m128 XY01 = _mm_unpacklo_ps(X, Y);							// x0 y0 x1 y1
+		const __m128 XY23 = _mm_unpackhi_ps(X, Y);							// x2 y2 x3 y3
+		const __m128 U = _mm_shuffle_ps(Z, XY01, _MM_SHUFFLE(3, 2, 1, 0));	// z0 z1 x1 y1
+		const __m128 V = _mm_shuffle_ps(Z, XY23, _MM_SHUFFLE(3, 2, 3, 2));	// z2 z3 x3 y3
+
+		_mm_storeu_ps(Dest + 0, _mm_shuffle_ps(XY01, U, _MM_SHUFFLE(2, 0, 1, 0)));
+		_mm_storeu_ps(Dest + 4, _mm_shuffle_ps(U, XY23, _MM_SHUFFLE(1, 0, 1, 3)));
+		_mm_storeu_ps(Dest + 8, _mm_shuffle_ps(V, V, _MM_SHUFFLE(1, 3, 2, 0)));
+	}
+#endif // SERVERRECAST_TRANSFORM_SSE
+
+	void TransformPointsScalar(const FServerRecastAffine3x4& Transform, const float* Src, float* Dest, int32 NumVerts)
+	{
+		for (int32 Index = 0; Index < NumVerts; ++Index, Src += 3, Dest += 3)
+		{
+			Transform.TransformPoint(Src, Dest);
+		}
+	}
+
+	void TransformPoints(const FServerRecastAffine3x4& Transform, const float* Src, float* Dest, int32 NumVerts)
+	{
+		int32 Index = 0;
+
+#if SERVERRECAST_TRANSFORM_AVX
+		{
+			__m256 M[3][4];
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				for (int32 Col = 0; Col < 4; ++Col)
+				{
+					M[Axis][Col] = _mm256_set1_ps(Transform.M[Axis][Col]);
+				}
+			}
+
+			for (; Index + 8 <= NumVerts; Index += 8, Src += 24, Dest += 24)
+			{
+				__m128 XLo, YLo, ZLo, XHi, YHi, ZHi;
+				Deinterleave4(Src, XLo, YLo, ZLo);
+				Deinterleave4(Src + 12, XHi, YHi, ZHi);
+				const __m256 X = _mm256_insertf128_ps(_mm256_castps128_ps256(XLo), XHi, 1);
+				const __m256 Y = _mm256_insertf128_ps(_mm256_castps128_ps256(YLo), YHi, 1);
+				const __m256 Z = _mm256_insertf128_ps(_mm256_castps128_ps256(ZLo), ZHi, 1);
+
+				__m256 Out[3];
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					Out[Axis] = _mm256_add_ps(
+						_mm256_add_ps(_mm256_mul_ps(X, M[Axis][0]), _mm256_mul_ps(Z, M[Axis][2])),
+						_mm256_add_ps(_mm256_mul_ps(Y, M[Axis][1]), M[Axis][3]));
+				}
+
+				Interleave4(_mm256_castps256_ps128(Out[0]), _mm256_castps256_ps128(Out[1]), _mm256_castps256_ps128(Out[2]), Dest);
+				Interleave4(_mm256_extractf128_ps(Out[0], 1), _mm256_extractf128_ps(Out[1], 1), _mm256_extractf128_ps(Out[2], 1), Dest + 12);
+			}
+		}
+#endif // SERVERRECAST_TRANSFORM_AVX
+
+#if SERVERRECAST_TRANSFORM_SSE
+		{
+			__m128 M[3][4];
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				for (int32 Col = 0; Col < 4; ++Col)
+				{
+					M[Axis][Col] = _mm_set1_ps(Transform.M[Axis][Col]);
+				}
+			}
+
+			for (; Index + 4 <= NumVerts; Index += 4, Src += 12, Dest += 12)
+			{
+				__m128 X, Y, Z;
+				Deinterleave4(Src, X, Y, Z);
+
+				__m128 Out[3];
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					Out[Axis] = _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(X, M[Axis][0]), _mm_mul_ps(Z, M[Axis][2])),
+						_mm_add_ps(_mm_mul_ps(Y, M[Axis][1]), M[Axis][3]));
+				}
+
+				Interleave4(Out[0], Out[1], Out[2], Dest);
+			}
+		}
+#endif // SERVERRECAST_TRANSFORM_SSE
+
+		TransformPointsScalar(Transform, Src, Dest, NumVerts - Index);
+	}
+}
+
+static void BenchmarkInstanceTransform(const TArray<FString>& Args)
+{
+	const int32 NumVerts = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 4096;
+	const int32 NumInstances = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1000;
+
+	FRandomStream RandomStream(0x5EC7);
+	TArray<float> Source;
+	Source.SetNumUninitialized(NumVerts * 3);
+	for (float& Coord : Source)
+	{
+		Coord = RandomStream.FRandRange(-5000.f, 5000.f);
+	}
+
+	TArray<FTransform> InstanceTransforms;
+	InstanceTransforms.Reserve(NumInstances);
+	for (int32 Index = 0; Index < NumInstances; ++Index)
+	{
+		const FRotator Rotation(RandomStream.FRandRange(-10.f, 10.f), RandomStream.FRandRange(0.f, 360.f), RandomStream.FRandRange(-10.f, 10.f));
+		const FVector Translation(RandomStream.FRandRange(-100000.f, 100000.f), RandomStream.FRandRange(-100000.f, 100000.f), RandomStream.FRandRange(-1000.f, 1000.f));
+		InstanceTransforms.Add(FTransform(Rotation, Translation, FVector(RandomStream.FRandRange(0.5f, 2.f))));
+	}
+
+	TArray<float> PerVertexResult;
+	TArray<float> BatchedResult;
+	PerVertexResult.SetNumUninitialized(NumVerts * 3);
+	BatchedResult.SetNumUninitialized(NumVerts * 3);
+
+	// current per-vertex path from MyExportNavigationData
+	const double PerVertexStart = FPlatformTime::Seconds();
+	for (const FTransform& InstanceTransform : InstanceTransforms)
+	{
+		const FMatrix LocalToRecastWorld = InstanceTransform.ToMatrixWithScale() * Unreal2RecastMatrix();
+		for (int32 i = 0; i < NumVerts * 3; i += 3)
+		{
+			const FVector WorldRecastCoord = LocalToRecastWorld.TransformPosition(Recast2UnrealPoint(&Source[i]));
+			PerVertexResult[i + 0] = WorldRecastCoord.X;
+			PerVertexResult[i + 1] = WorldRecastCoord.Y;
+			PerVertexResult[i + 2] = WorldRecastCoord.Z;
+		}
+	}
+	const double PerVertexTime = FPlatformTime::Seconds() - PerVertexStart;
+
+	const double ScalarStart = FPlatformTime::Seconds();
+	for (const FTransform& InstanceTransform : InstanceTransforms)
+	{
+		ServerRecastVertexTransform::TransformPointsScalar(FServerRecastAffine3x4::MakeInstanceToRecast(InstanceTransform), Source.GetData(), BatchedResult.GetData(), NumVerts);
+	}
+	const double ScalarTime = FPlatformTime::Seconds() - ScalarStart;
+
+	const double BatchedStart = FPlatformTime::Seconds();
+	for (const FTransform& InstanceTransform : InstanceTransforms)
+	{
+		ServerRecastVertexTransform::TransformPoints(FServerRecastAffine3x4::MakeInstanceToRecast(InstanceTransform), Source.GetData(), BatchedResult.GetData(), NumVerts);
+	}
+	const double BatchedTime = FPlatformTime::Seconds() - BatchedStart;
+
+	// both loops end with the last instance, compare its output bit by bit
+	const bool bIdentical = FMemory::Memcmp(PerVertexResult.GetData(), BatchedResult.GetData(), BatchedResult.Num() * sizeof(float)) == 0;
+
+	const double TotalVerts = (double)NumVerts * NumInstances;
+	UE_LOG(LogNavigation, Log, TEXT("ServerRecast instance transform, %d verts x %d instances (SSE:%d AVX:%d)"), NumVerts, NumInstances, SERVERRECAST_TRANSFORM_SSE, SERVERRECAST_TRANSFORM_AVX);
+	UE_LOG(LogNavigation, Log, TEXT("  per-vertex: %.3f ms, %.1f Mverts/s"), PerVertexTime * 1000., TotalVerts / PerVertexTime / 1000000.);
+	UE_LOG(LogNavigation, Log, TEXT("  scalar 3x4: %.3f ms, %.1f Mverts/s"), ScalarTime * 1000., TotalVerts / ScalarTime / 1000000.);
+	UE_LOG(LogNavigation, Log, TEXT("  batched:    %.3f ms, %.1f Mverts/s, speedup x%.2f"), BatchedTime * 1000., TotalVerts / BatchedTime / 1000000., PerVertexTime / BatchedTime);
+	UE_LOG(LogNavigation, Log, TEXT("  output %s"), bIdentical ? TEXT("matches per-vertex path") : TEXT("DIFFERS from per-vertex path"));
+}
+
+static FAutoConsoleCommand BenchmarkInstanceTransformCmd(
+	TEXT("ServerRecast.BenchmarkInstanceTransform"),
+	TEXT("Times per-vertex vs batched instance vertex transform. Args: [NumVerts] [NumInstances]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkInstanceTransform));
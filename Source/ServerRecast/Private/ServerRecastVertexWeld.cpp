@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastVertexWeld.h"
+#include "Navmesh/RecastHelpers.h"
+#include "Async/ParallelFor.h"
+
+namespace ServerRecastVertexWeld
+{
+	/** soup vertices per chunk welded independently before the merge */
+	static const int32 ChunkSize = 3 * 32 * 1024;
+
+	struct FWeldKey
+	{
+		int64 X, Y, Z;
+
+		FORCEINLINE bool operator==(const FWeldKey& Other) const
+		{
+			return X == Other.X && Y == Other.Y && Z == Other.Z;
+		}
+	};
+
+	FORCEINLINE uint32 HashWeldKey(const FWeldKey& Key)
+	{
+		uint64 Hash = (uint64)Key.X * 0x9E3779B97F4A7C15ull;
+		Hash ^= (uint64)Key.Y * 0xC2B2AE3D27D4EB4Full;
+		Hash ^= (uint64)Key.Z * 0x165667B19E3779F9ull;
+		Hash ^= Hash >> 29;
+		Hash *= 0xBF58476D1CE4E5B9ull;
+		Hash ^= Hash >> 32;
+		return (uint32)Hash;
+	}
+
+	/** Open addressing table, linear probing over a flat power of two array */
+	class FWeldTable
+	{
+	public:
+		explicit FWeldTable(int32 MaxEntries)
+		{
+			const int32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(MaxEntries * 2, 16));
+			Slots.SetNumUninitialized(Capacity);
+			for (FSlot& Slot : Slots)
+			{
+				Slot.Index = INDEX_NONE;
+			}
+			Mask = Capacity - 1;
+		}
+
+		/** @return index stored for Key, or NewIndex if Key was added */
+		FORCEINLINE int32 FindOrAdd(const FWeldKey& Key, int32 NewIndex)
+		{
+			uint32 SlotIndex = HashWeldKey(Key) & Mask;
+			for (;;)
+			{
+				FSlot& Slot = Slots[SlotIndex];
+				if (Slot.Index == INDEX_NONE)
+				{
+					Slot.Key = Key;
+					Slot.Index = NewIndex;
+					return NewIndex;
+				}
+				if (Slot.Key == Key)
+				{
+					return Slot.Index;
+				}
+				SlotIndex = (SlotIndex + 1) & Mask;
+			}
+		}
+
+	private:
+		struct FSlot
+		{
+			FWeldKey Key;
+			int32 Index;
+		};
+
+		TArray<FSlot> Slots;
+		uint32 Mask;
+	};
+
+	struct FWeldChunk
+	{
+		/** unique positions in recast coords, in first occurrence order */
+		TArray<FVector> Verts;
+		TArray<FWeldKey> Keys;
+		/** soup vertex -> index in Verts */
+		TArray<int32> Remap;
+	};
+
+	void WeldVertexSoupToRecast(const TArray<FVector>& VertexSoup, float WeldEpsilon, TNavStatArray<FVector>& Verts, TNavStatArray<int32>& Faces)
+	{
+		check(VertexSoup.Num() % 3 == 0);
+		check(WeldEpsilon > 0.f);
+
+		const double InvEpsilon = 1.0 / WeldEpsilon;
+		auto MakeKey = [InvEpsilon](const FVector& Point)
+		{
+			FWeldKey Key;
+			Key.X = (int64)FMath::FloorToDouble(Point.X * InvEpsilon);
+			Key.Y = (int64)FMath::FloorToDouble(Point.Y * InvEpsilon);
+			Key.Z = (int64)FMath::FloorToDouble(Point.Z * InvEpsilon);
+			return Key;
+		};
+
+		// weld every chunk on its own
+		const int32 NumChunks = FMath::DivideAndRoundUp(VertexSoup.Num(), ChunkSize);
+		TArray<FWeldChunk> Chunks;
+		Chunks.SetNum(NumChunks);
+
+		ParallelFor(NumChunks, [&](int32 ChunkIndex)
+			{
+				const int32 First = ChunkIndex * ChunkSize;
+				const int32 Count = FMath::Min(ChunkSize, VertexSoup.Num() - First);
+
+				FWeldChunk& Chunk = Chunks[ChunkIndex];
+				Chunk.Remap.SetNumUninitialized(Count);
+
+				FWeldTable Table(Count);
+				for (int32 i = 0; i < Count; ++i)
+				{
+					const FVector Point = Unreal2RecastPoint(VertexSoup[First + i]);
+					const FWeldKey Key = MakeKey(Point);
+
+					const int32 Index = Table.FindOrAdd(Key, Chunk.Verts.Num());
+					if (Index == Chunk.Verts.Num())
+					{
+						Chunk.Verts.Add(Point);
+						Chunk.Keys.Add(Key);
+					}
+					Chunk.Remap[i] = Index;
+				}
+			});
+
+		// merge chunk uniques in chunk order, so output doesn't depend on scheduling
+		int32 NumChunkVerts = 0;
+		for (const FWeldChunk& Chunk : Chunks)
+		{
+			NumChunkVerts += Chunk.Verts.Num();
+		}
+
+		const int32 BaseVert = Verts.Num();
+		FWeldTable GlobalTable(NumChunkVerts);
+		TArray<TArray<int32>> ChunkToGlobal;
+		ChunkToGlobal.SetNum(NumChunks);
+		for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ++ChunkIndex)
+		{
+			const FWeldChunk& Chunk = Chunks[ChunkIndex];
+			TArray<int32>& Mapping = ChunkToGlobal[ChunkIndex];
+			Mapping.SetNumUninitialized(Chunk.Verts.Num());
+
+			for (int32 i = 0; i < Chunk.Verts.Num(); ++i)
+			{
+				const int32 NewIndex = Verts.Num() - BaseVert;
+				const int32 Index = GlobalTable.FindOrAdd(Chunk.Keys[i], NewIndex);
+				if (Index == NewIndex)
+				{
+					Verts.Add(Chunk.Verts[i]);
+				}
+				Mapping[i] = BaseVert + Index;
+			}
+		}
+
+		Faces.Reserve(Faces.Num() + VertexSoup.Num());
+		for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ++ChunkIndex)
+		{
+			const FWeldChunk& Chunk = Chunks[ChunkIndex];
+			const TArray<int32>& Mapping = ChunkToGlobal[ChunkIndex];
+			for (int32 i = 0; i < Chunk.Remap.Num(); i += 3)
+			{
+				const int32 V0 = Mapping[Chunk.Remap[i + 0]];
+				const int32 V1 = Mapping[Chunk.Remap[i + 1]];
+				const int32 V2 = Mapping[Chunk.Remap[i + 2]];
+				if (V0 != V1 && V1 != V2 && V0 != V2)
+				{
+					Faces.Add(V2);
+					Faces.Add(V1);
+					Faces.Add(V0);
+				}
+			}
+		}
+	}
+}
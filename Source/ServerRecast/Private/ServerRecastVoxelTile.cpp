@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastVoxelTile.h"
+#include "Runtime/Navmesh/Public/Recast/Recast.h"
+
+namespace ServerRecastVoxelTile
+{
+	static void WriteVarInt(TArray<uint8>& OutData, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			OutData.Add((uint8)(Value | 0x80));
+			Value >>= 7;
+		}
+		OutData.Add((uint8)Value);
+	}
+
+	static bool ReadVarInt(const uint8*& Cursor, const uint8* End, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 35 && Cursor < End; Shift += 7)
+		{
+			const uint8 Byte = *Cursor++;
+			OutValue |= (uint32)(Byte & 0x7f) << Shift;
+			if ((Byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+void ServerRecastVoxelTile::Encode(const rcHeightfield& Solid, int32 TileX, int32 TileY, TArray<uint8>& OutData)
+{
+	const int32 HeaderStart = OutData.AddZeroed(sizeof(FServerRecastGeometryFileVoxelTile));
+	const int32 DataStart = OutData.Num();
+
+	int32 NumSpans = 0;
+	const int32 NumColumns = Solid.width * Solid.height;
+	int32 Column = 0;
+	while (Column < NumColumns)
+	{
+		const int32 EmptyStart = Column;
+		while (Column < NumColumns && Solid.spans[Column] == nullptr)
+		{
+			++Column;
+		}
+		const int32 FilledStart = Column;
+		while (Column < NumColumns && Solid.spans[Column] != nullptr)
+		{
+			++Column;
+		}
+
+		WriteVarInt(OutData, FilledStart - EmptyStart);
+		WriteVarInt(OutData, Column - FilledStart);
+		for (int32 FilledColumn = FilledStart; FilledColumn < Column; ++FilledColumn)
+		{
+			uint32 NumColumnSpans = 0;
+			for (const rcSpan* Span = Solid.spans[FilledColumn]; Span; Span = Span->next)
+			{
+				++NumColumnSpans;
+			}
+			WriteVarInt(OutData, NumColumnSpans);
+
+			// spans are sorted and never touch, gaps are positive
+			uint32 PrevTop = 0;
+			for (const rcSpan* Span = Solid.spans[FilledColumn]; Span; Span = Span->next)
+			{
+				WriteVarInt(OutData, Span->data.smin - PrevTop);
+				WriteVarInt(OutData, Span->data.smax - Span->data.smin);
+				OutData.Add((uint8)Span->data.area);
+				PrevTop = Span->data.smax;
+			}
+			NumSpans += NumColumnSpans;
+		}
+	}
+
+	FServerRecastGeometryFileVoxelTile Header;
+	Header.TileX = TileX;
+	Header.TileY = TileY;
+	Header.Width = Solid.width;
+	Header.Height = Solid.height;
+	Header.NumSpans = NumSpans;
+	Header.DataSize = OutData.Num() - DataStart;
+	FMemory::Memcpy(OutData.GetData() + HeaderStart, &Header, sizeof(Header));
+}
+
+bool ServerRecastVoxelTile::Decode(const FServerRecastGeometryFileVoxelTile& Tile, rcContext& Context, rcHeightfield& Solid)
+{
+	if (Tile.Width != Solid.width || Tile.Height != Solid.height)
+	{
+		return false;
+	}
+
+	const uint8* Cursor = Tile.GetData();
+	const uint8* End = Cursor + Tile.DataSize;
+	const int64 NumColumns = (int64)Tile.Width * Tile.Height;
+
+	int64 Column = 0;
+	int32 NumSpans = 0;
+	while (Column < NumColumns)
+	{
+		uint32 NumEmpty = 0;
+		uint32 NumFilled = 0;
+		if (!ReadVarInt(Cursor, End, NumEmpty) || !ReadVarInt(Cursor, End, NumFilled) ||
+			NumEmpty + (int64)NumFilled == 0 || Column + NumEmpty + NumFilled > NumColumns)
+		{
+			return false;
+		}
+
+		Column += NumEmpty;
+		for (uint32 FilledIndex = 0; FilledIndex < NumFilled; ++FilledIndex, ++Column)
+		{
+			uint32 NumColumnSpans = 0;
+			if (!ReadVarInt(Cursor, End, NumColumnSpans))
+			{
+				return false;
+			}
+
+			const int32 X = (int32)(Column % Tile.Width);
+			const int32 Z = (int32)(Column / Tile.Width);
+			uint32 PrevTop = 0;
+			for (uint32 SpanIndex = 0; SpanIndex < NumColumnSpans; ++SpanIndex)
+			{
+				uint32 Gap = 0;
+				uint32 SpanHeight = 0;
+				if (!ReadVarInt(Cursor, End, Gap) || !ReadVarInt(Cursor, End, SpanHeight) || Cursor >= End)
+				{
+					return false;
+				}
+				const uint8 Area = *Cursor++;
+
+				const uint32 SpanMin = PrevTop + Gap;
+				const uint32 SpanMax = SpanMin + SpanHeight;
+				if (SpanMax > RC_SPAN_MAX_HEIGHT || SpanHeight == 0)
+				{
+					return false;
+				}
+
+				rcAddSpan(&Context, Solid, X, Z, (unsigned short)SpanMin, (unsigned short)SpanMax, Area, 0);
+				PrevTop = SpanMax;
+			}
+			NumSpans += NumColumnSpans;
+		}
+	}
+
+	return Cursor == End && NumSpans == Tile.NumSpans;
+}
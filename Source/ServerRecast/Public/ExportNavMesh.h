@@ -5,7 +5,15 @@
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
 #include "Navmesh/RecastNavMeshGenerator.h"
+#include "NavigationOctree.h"
+#include "ServerRecastGeometryFile.h"
+#include "ServerRecastTriangleFilter.h"
+#include "ServerRecastExportProgress.h"
+#include "ServerRecastExportReport.h"
+#include "Async/Future.h"
 //#include "ExportNavMesh.generated.h"
+
+class UNavArea;
 /**
 *
 */
@@ -38,17 +46,347 @@ struct FServerRecastGeometryCache
 	static bool IsValid(const uint8* Memory, int32 MemorySize);
 };
 
+struct FServerRecastAreaExportData
+{
+	FConvexNavAreaData Convex;
+	uint8 AreaId;
+};
+
+/** Area modifier convex as gathered, every agent grows it by its own radius */
+struct FServerRecastAreaSource
+{
+	FConvexNavAreaData Convex;
+	TSubclassOf<UNavArea> AreaClass;
+};
+
+/** Everything export needs from the octree and levels, with exact output sizes known up front, shared by all agents */
+struct FServerRecastGatherSnapshot
+{
+	struct FGeometryElement
+	{
+		/** copy holds a reference to navigation relevant data, so collision cache stays alive */
+		FNavigationOctreeElement Element;
+		TArray<FTransform> InstanceTransforms;
+
+		int32 NumCoords;
+		int32 NumIndices;
+		int32 CoordOffset;
+		int32 IndexOffset;
+
+		FGeometryElement(const FNavigationOctreeElement& InElement)
+			: Element(InElement), NumCoords(0), NumIndices(0), CoordOffset(0), IndexOffset(0)
+		{
+		}
+	};
+
+	struct FLevelGeometry
+	{
+		TNavStatArray<FVector> Verts;
+		TNavStatArray<int32> Faces;
+
+		int32 CoordOffset;
+		int32 IndexOffset;
+
+		FLevelGeometry() : CoordOffset(0), IndexOffset(0) {}
+	};
+
+	TArray<FGeometryElement> Elements;
+	TArray<FLevelGeometry> LevelGeometry;
+	TArray<FServerRecastAreaSource> AreaSources;
+
+	/** instanced collision, every unique mesh stored once */
+	TArray<FServerRecastGeometryFilePrototype> Prototypes;
+	TArray<float> PrototypeCoords;
+	TArray<int32> PrototypeIndices;
+	TArray<FServerRecastGeometryFileInstance> Instances;
+	/** keeps prototype source data alive while snapshot is in use */
+	TArray<FNavigationOctreeElement> PrototypeElements;
+
+	/** landscapes kept as height grids */
+	TArray<FServerRecastGeometryFileHeightfield> Heightfields;
+	TArray<int16> HeightfieldSamples;
+	TArray<uint32> HeightfieldMasks;
+
+	int32 NumCoords;
+	int32 NumIndices;
+
+	FServerRecastGatherSnapshot() : NumCoords(0), NumIndices(0) {}
+
+	FServerRecastInstanceSet GetInstanceSet() const
+	{
+		FServerRecastInstanceSet InstanceSet;
+		InstanceSet.Prototypes = Prototypes.GetData();
+		InstanceSet.Verts = PrototypeCoords.GetData();
+		InstanceSet.Tris = PrototypeIndices.GetData();
+		InstanceSet.Instances = Instances.GetData();
+		InstanceSet.NumInstances = Instances.Num();
+		return InstanceSet;
+	}
+
+	FServerRecastHeightfieldSet GetHeightfieldSet() const
+	{
+		FServerRecastHeightfieldSet HeightfieldSet;
+		HeightfieldSet.Heightfields = Heightfields.GetData();
+		HeightfieldSet.NumHeightfields = Heightfields.Num();
+		HeightfieldSet.Samples = HeightfieldSamples.GetData();
+		HeightfieldSet.Masks = HeightfieldMasks.GetData();
+		return HeightfieldSet;
+	}
+};
+
+struct FServerRecastExportOptions
+{
+	/** write binary geometry container (*.srgeom) */
+	bool bExportGeometryFile;
+
+	/** write text OBJ in RecastDemo format, debug only */
+	bool bExportDebugOBJ;
+
+	/** chunk compress geometry and OBJ files (*.srgeomz, *.objz) */
+	bool bCompressFiles;
+
+	/** store instanced meshes once with a transform table instead of copying them per instance */
+	bool bExportInstancesAsPrototypes;
+
+	/** store landscape collision as height grids with hole masks, the builder rasterizes them without triangles */
+	bool bExportLandscapeHeightfields;
+
+	/** weld level static geometry vertices closer than this (unreal units), 0 (default) keeps the triangle soup */
+	float LevelGeometryWeldEpsilon;
+
+	/** drop degenerate triangles and triangles outside NavMeshBoundsVolumes (plus tile border and agent height) */
+	bool bCullTriangles;
+
+	/** also drop steep triangles lower than agent max climb, navmesh may change slightly, see FServerRecastTriangleFilter */
+	bool bCullUnwalkableTriangles;
+
+	/** when set, navmesh is built in-process and saved as NavMeshFileName.navmesh (_NavDataSetN suffix for extra agents) */
+	FString NavMeshFileName;
+
+	/** save per-tile build times next to the navmesh (*.tiles.csv) */
+	bool bWriteTileBuildReport;
+
+	/** tile build workers, 0 uses all task graph threads, split between agents exported concurrently */
+	int32 NumBuildWorkers;
+
+	/**
+	* When the navmesh file already exists, only tiles overlapping DirtyBounds are regathered and rebuilt,
+	* the others are kept from the file. Geometry and OBJ files are not written in this mode.
+	*/
+	bool bIncrementalExport;
+
+	/** unreal space bounds changed since the last export */
+	TArray<FBox> DirtyBounds;
+
+	/**
+	* Write geometry as one bucket per navmesh tile (border included) and build from the mapped file,
+	* so the whole world is never expanded in memory. Replaces the regular geometry file, no compression or OBJ.
+	*/
+	bool bTiledGeometryFile;
+
+	/** save counts, bytes written and phase times as <FileName>.report.json */
+	bool bWriteExportReport;
+
+	/**
+	* Rasterize and filter tiles in the exporter and save their spans run-length encoded (*.srvox),
+	* the navmesh is then built from that file without rasterizing again. Not done for incremental exports.
+	*/
+	bool bExportVoxelTiles;
+
+	/** also save navmesh as a tile pack (*.navpack) servers map and load lazily, see FServerRecastRuntimeNavMesh */
+	bool bWriteTilePack;
+
+	/** also save a graph of tile border portals (*.navgraph) for FServerRecastHierarchicalPathfinder */
+	bool bBuildTileGraph;
+
+	/** built tiles are cached there by hash of their input and reused by later exports, empty disables */
+	FString TileCacheDir;
+
+	/** least recently used tiles are deleted after the build while TileCacheDir is bigger, bytes, 0 is unlimited */
+	int64 TileCacheMaxSize;
+
+	FServerRecastExportOptions()
+		: bExportGeometryFile(true)
+		, bExportDebugOBJ(false)
+		, bCompressFiles(false)
+		, bExportInstancesAsPrototypes(true)
+		, bExportLandscapeHeightfields(true)
+		, LevelGeometryWeldEpsilon(0.f)
+		, bCullTriangles(true)
+		, bCullUnwalkableTriangles(false)
+		, bWriteTileBuildReport(false)
+		, NumBuildWorkers(0)
+		, bIncrementalExport(false)
+		, bTiledGeometryFile(false)
+		, bWriteExportReport(true)
+		, bExportVoxelTiles(false)
+		, bWriteTilePack(false)
+		, bBuildTileGraph(false)
+		, TileCacheMaxSize(2048ll * 1024 * 1024)
+	{
+	}
+};
+
+/** One agent of an export, everything is copied on game thread so the rest can run on any thread */
+struct FServerRecastAgentExportJob
+{
+	FString NavDataName;
+	FRecastBuildConfig Config;
+	/** generator's TotalNavBounds, recast space */
+	FBox RecastBounds;
+	/** NavMeshBoundsVolumes, unreal space */
+	TArray<FBox> InclusionBounds;
+
+	FString FileBaseName;
+	FString NavMeshFileName;
+	/** see FServerRecastNavMeshBuilder::GetBuildKey */
+	FString BuildKey;
+	bool bIncremental;
+	bool bTiled;
+	TArray<FIntPoint> DirtyTiles;
+	/** RecastDemo settings appended to the OBJ file */
+	FString OBJAdditionalData;
+
+	/** area convexes grown by this agent's radius */
+	TArray<FServerRecastAreaExportData> AreaExport;
+
+	FServerRecastAgentExportJob() : RecastBounds(ForceInit), bIncremental(false), bTiled(false) {}
+};
+
+struct FServerRecastExportJob
+{
+	FServerRecastExportOptions Options;
+	/** geometry is gathered once for all agents */
+	FServerRecastGatherSnapshot Snapshot;
+	TArray<TUniquePtr<FServerRecastAgentExportJob>> Agents;
+
+	/** agent reports match Agents by index */
+	FServerRecastExportReport Report;
+	FString ReportFileName;
+};
+
+/** Export running in background, see FExportNavMesh::ExportWorldAsync */
+class SERVERRECAST_API FServerRecastAsyncExport
+{
+public:
+	DECLARE_DELEGATE_TwoParams(FOnCompleted, bool /*bSuccess*/, bool /*bCancelled*/);
+
+	/** called on game thread once export finishes, unbind to drop the notification */
+	FOnCompleted OnCompleted;
+
+	void Cancel() { Progress.bCancelRequested = true; }
+	bool IsDone() const { return Result.IsReady(); }
+	void Wait() const { Result.Wait(); }
+
+	const FServerRecastExportProgress& GetProgress() const { return Progress; }
+
+private:
+	friend class FExportNavMesh;
+
+	FServerRecastExportJob Job;
+	FServerRecastExportProgress Progress;
+	TFuture<bool> Result;
+};
+
 class SERVERRECAST_API FExportNavMesh : public FRecastNavMeshGenerator
 {
 
 public:
-	void MyExportNavigationData(const FString& FileName);
+	/** Gathers and runs the whole export on calling thread, @return false when nothing could be exported or a navmesh build failed */
+	bool MyExportNavigationData(const FString& FileName, const FServerRecastExportOptions& Options = FServerRecastExportOptions());
+
+	/** Finds default navmesh generator of World and runs the export with it, used by editor button and commandlet */
+	static bool ExportWorld(UWorld* World, const FString& FileName, const FServerRecastExportOptions& Options);
+
+	/**
+	* Snapshots octree and level geometry on game thread and leaves filtering, file writes and navmesh build
+	* to a background thread, so editor stays responsive.
+	* @param bOutUpToDate set when incremental export found no dirty tiles, files on disk are current
+	* @return nullptr when there is nothing to export, OnCompleted is not called then
+	*/
+	static TSharedPtr<FServerRecastAsyncExport, ESPMode::ThreadSafe> ExportWorldAsync(UWorld* World, const FString& FileName, const FServerRecastExportOptions& Options, const FServerRecastAsyncExport::FOnCompleted& OnCompleted, bool* bOutUpToDate = nullptr);
+
+	/**
+	* Saves Detour tiles the editor already built (or loaded with the map) as NavMeshFileName.navmesh, _NavDataSetN suffix
+	* for extra agents, nothing is gathered or rebuilt. Tiles are in the same recast space and layout as built ones.
+	* Build keys of replaced files are deleted, the next incremental export of the map rebuilds everything.
+	* @return false while navigation build is still running or when no agent has tiles
+	*/
+	static bool ExportBuiltNavMesh(UWorld* World, const FString& NavMeshFileName, bool bWriteTilePack = false);
+
+	/** NavMeshFileName.navmesh for the first entry of NavDataSet, _NavDataSetN suffix for others, same for export and built navmesh */
+	static FString GetAgentNavMeshFileName(const FString& NavMeshFileName, int32 NavDataIndex);
+
+	/** Game thread part of the export, @return false when there's no navigation system */
+	bool GatherExportJob(const FString& FileName, const FServerRecastExportOptions& Options, FServerRecastExportJob& OutJob);
+
+	/**
+	* Thread safe part of the export, touches nothing but the job. Shared geometry buffers are built once,
+	* then agents are filtered, written and built concurrently. @return false on failure or cancel
+	*/
+	static bool RunExportJob(FServerRecastExportJob& Job, FServerRecastExportProgress* Progress = nullptr);
+
+	/**
+	* @param SharedCoords, SharedIndices - snapshot geometry, empty for tiled agents
+	* @param OutReport - filled only by the calling thread
+	*/
+	static bool RunAgentExport(const FServerRecastExportOptions& Options, const FServerRecastGatherSnapshot& Snapshot, const FServerRecastAgentExportJob& Agent,
+		const TNavStatArray<float>& SharedCoords, const TNavStatArray<int32>& SharedIndices, FServerRecastExportProgress* Progress, FServerRecastAgentExportReport& OutReport);
+
+	/**
+	* Walks octree and levels on game thread, computes per-element output offsets
+	* @param QueryBounds - octree elements outside are skipped, nullptr gathers everything inside navigable bounds
+	*/
+	void GatherExportSnapshot(const FServerRecastExportOptions& Options, FServerRecastGatherSnapshot& Snapshot, const FBox* QueryBounds = nullptr);
+
+	/** Area ids and convexes grown by NavData's agent radius */
+	void BuildAgentAreas(const ARecastNavMesh* NavData, const FServerRecastGatherSnapshot& Snapshot, TArray<FServerRecastAreaExportData>& OutAreaExport);
+
+	/** @return index of prototype with the same collision data, adds a new one if there's none */
+	static int32 FindOrAddPrototype(const FNavigationOctreeElement& Element, FServerRecastGatherSnapshot& Snapshot, TMultiMap<uint64, int32>& PrototypesByHash);
+
+	/** Appends prototype mesh (local recast space) without source element, @return its index */
+	static int32 AddPrototype(FServerRecastGatherSnapshot& Snapshot, const float* Verts, int32 NumVerts, const int32* Indices, int32 NumTris);
+
+	/** Adds instance of a prototype with recast space transform and world bounds */
+	static void AddInstance(FServerRecastGatherSnapshot& Snapshot, int32 PrototypeIndex, const FTransform& InstanceTransform);
+
+	/**
+	* Stores landscape collision as a height grid, rotated landscapes can't map to recast axes and go to level geometry as triangles.
+	* @return false when the component has no heightfield
+	*/
+	static bool AddLandscapeHeightfield(FServerRecastGatherSnapshot& Snapshot, const class ULandscapeHeightfieldCollisionComponent* Component);
+
+	/** Fills exactly-sized buffers from snapshot in parallel */
+	static void BuildGeometryBuffers(const FServerRecastGatherSnapshot& Snapshot, TNavStatArray<float>& CoordBuffer, TNavStatArray<int32>& IndexBuffer);
+
+	/** Writes NumCoords/NumIndices of one element, indices start at BaseVert */
+	static void WriteElementGeometry(const FServerRecastGatherSnapshot::FGeometryElement& GeometryElement, float* CoordDest, int32* IndexDest, int32 BaseVert);
+
+	static void GrowConvexHull(const float ExpandBy, const TArray<FVector>& Verts, TArray<FVector>& OutResult);
+
+	/** @param WeldEpsilon - when positive, vertices within the same epsilon cell are shared, see ServerRecastVertexWeld */
+	static void TransformVertexSoupToRecast(const TArray<FVector>& VertexSoup, TNavStatArray<FVector>& Verts, TNavStatArray<int32>& Faces, float WeldEpsilon = 0.f);
+
+	/** @param bCompress - write chunk compressed *.objz, see FServerRecastCompressedFileReader */
+	static void ExportGeomToOBJFile(const FString& InFileName, const TNavStatArray<float>& GeomCoords, const TNavStatArray<int32>& GeomFaces, const FString& AdditionalData, bool bCompress = false);
+
+	/** Converts area convexes to recast coords, points of all areas go to one array */
+	static void FlattenAreaExport(const TArray<FServerRecastAreaExportData>& AreaExport, TArray<FServerRecastGeometryFileArea>& OutAreas, TArray<float>& OutAreaPoints);
 
-	void GrowConvexHull(const float ExpandBy, const TArray<FVector>& Verts, TArray<FVector>& OutResult);
+	/** @param RecastBounds - navigable bounds stored as rd_bbox */
+	static bool ExportGeomToBinaryFile(const FString& InFileName, const FBox& RecastBounds, const FRecastBuildConfig& Config, const TNavStatArray<float>& GeomCoords, const TNavStatArray<int32>& GeomFaces, const TArray<FServerRecastAreaExportData>& AreaExport, const FServerRecastGatherSnapshot* InstancedGeometry = nullptr, bool bCompress = false);
 
-	void TransformVertexSoupToRecast(const TArray<FVector>& VertexSoup, TNavStatArray<FVector>& Verts, TNavStatArray<int32>& Faces);
+	/** Height grids go to global sections of both plain and tiled files */
+	static void AddHeightfieldSections(FServerRecastGeometryFileWriter& Writer, const FServerRecastGatherSnapshot& Snapshot);
 
-	void ExportGeomToOBJFile(const FString& InFileName, const TNavStatArray<float>& GeomCoords, const TNavStatArray<int32>& GeomFaces, const FString& AdditionalData);
+	/**
+	* Streams geometry as TileBucket sections, elements are expanded only for the batch of tiles being written,
+	* memory is bounded by a few tiles instead of the whole world
+	*/
+	static bool ExportTiledGeometryFile(const FString& InFileName, const FBox& RecastBounds, const FRecastBuildConfig& Config, const FServerRecastGatherSnapshot& Snapshot,
+		const TArray<FServerRecastAreaExportData>& AreaExport, int32 NumWorkers = 0,
+		const FServerRecastTriangleFilter* TriangleFilter = nullptr, FServerRecastTriangleFilterStats* OutFilterStats = nullptr, FServerRecastExportProgress* Progress = nullptr);
 
 	static FVector ChangeDirectionOfPoint(FVector Coord);
 };
@@ -5,15 +5,12 @@
 #include "CoreMinimal.h"
 #include "EngineMinimal.h"
 #include "Modules/ModuleManager.h"
-
-#include "Windows/AllowWindowsPlatformTypes.h"
-
-//The external headers and defines goes here
-
-#include "Windows/HideWindowsPlatformTypes.h"
+#include "ServerRecastDirtyTracker.h"
 
 class FToolBarBuilder;
 class FMenuBuilder;
+class FServerRecastAsyncExport;
+class SNotificationItem;
 
 
 class FServerRecastModule : public IModuleInterface
@@ -27,12 +24,28 @@ public:
 	/** This function will be bound to Command. */
 	void PluginButtonClicked();
 
+	/** Saves navmesh the editor has already built, no export or rebuild */
+	void SaveBuiltNavMeshClicked();
+
 	
 private:
 
 	void AddToolbarExtension(FToolBarBuilder& Builder);
 	void AddMenuExtension(FMenuBuilder& Builder);
 
+	/** one export at a time, button is disabled while it runs */
+	bool CanExportNavigation() const;
+	void CancelExport();
+	bool TickExportProgress(float DeltaTime);
+	void OnExportCompleted(bool bSuccess, bool bCancelled);
+
 private:
 	TSharedPtr<class FUICommandList> PluginCommands;
+
+	/** changes since the last export, lets the button rebuild only touched tiles */
+	FServerRecastDirtyTracker DirtyTracker;
+
+	TSharedPtr<FServerRecastAsyncExport, ESPMode::ThreadSafe> ActiveExport;
+	TWeakPtr<SNotificationItem> ExportNotification;
+	FDelegateHandle ExportTickerHandle;
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ExportNavMesh.h"
+
+/** Synthetic world description, same values give the same geometry on every machine */
+struct SERVERRECAST_API FServerRecastBenchmarkParams
+{
+	int32 Seed;
+
+	/** box meshes of random size shared by instances */
+	int32 NumPrototypes;
+	int32 NumInstances;
+
+	/** level static geometry triangles, noisy ground grid */
+	int32 NumSoupTris;
+
+	int32 NumAreas;
+
+	/** side of the square world centered at origin, unreal units */
+	float WorldSize;
+
+	float LevelGeometryWeldEpsilon;
+	int32 NumBuildWorkers;
+	bool bBuildNavMesh;
+	bool bCompressFiles;
+	/** also voxelize tiles to a file and build again from it */
+	bool bVoxelize;
+
+	/** geometry and navmesh files are written here */
+	FString OutDir;
+
+	FServerRecastBenchmarkParams()
+		: Seed(1)
+		, NumPrototypes(8)
+		, NumInstances(10000)
+		, NumSoupTris(200000)
+		, NumAreas(100)
+		, WorldSize(100000.f)
+		, LevelGeometryWeldEpsilon(0.f)
+		, NumBuildWorkers(0)
+		, bBuildNavMesh(true)
+		, bCompressFiles(false)
+		, bVoxelize(false)
+	{
+	}
+};
+
+struct FServerRecastBenchmarkStage
+{
+	FString Name;
+	double Seconds;
+	/** triangles, instances or areas the stage processed */
+	int64 NumItems;
+	/** size of written file, 0 for in-memory stages */
+	int64 OutputSize;
+	/** used physical memory change over the stage */
+	int64 MemoryDelta;
+
+	double GetItemsPerSecond() const { return Seconds > 0. ? NumItems / Seconds : 0.; }
+};
+
+/**
+* Times export stages on generated input: octree gather (only with a world), soup conversion, area grow,
+* instance transform, buffer fill, triangle filter, serialization, navmesh build and optionally voxelization.
+* Results go to JSON so runs can be compared.
+*/
+class SERVERRECAST_API FServerRecastBenchmark
+{
+public:
+	explicit FServerRecastBenchmark(const FServerRecastBenchmarkParams& InParams);
+
+	/**
+	* @param World - when set, its octree is gathered with the default navmesh config and synthetic content is added on top,
+	* otherwise config comes from ARecastNavMesh defaults
+	*/
+	bool Run(UWorld* World = nullptr);
+
+	void LogReport() const;
+
+	bool SaveReport(const FString& FileName) const;
+
+	const TArray<FServerRecastBenchmarkStage>& GetStages() const { return Stages; }
+
+private:
+	void MakeDefaultConfig(FRecastBuildConfig& OutConfig) const;
+
+	/** Noisy ground grid as unreal space vertex soup, like ULevel static navigable geometry */
+	void GenerateSoup(FRandomStream& Random, TArray<FVector>& OutSoup) const;
+
+	void GeneratePrototypesAndInstances(FRandomStream& Random, FServerRecastGatherSnapshot& Snapshot) const;
+
+	void GenerateAreas(FRandomStream& Random, FServerRecastGatherSnapshot& Snapshot) const;
+
+	/** Runs Func, which returns number of processed items, and records its time and memory */
+	template<typename FuncType>
+	FServerRecastBenchmarkStage& RunStage(const TCHAR* Name, FuncType Func);
+
+	FServerRecastBenchmarkParams Params;
+	FRecastBuildConfig Config;
+	/** recast space */
+	FBox RecastBounds;
+
+	TArray<FServerRecastBenchmarkStage> Stages;
+	double TotalTime;
+	uint64 PeakUsedPhysical;
+};
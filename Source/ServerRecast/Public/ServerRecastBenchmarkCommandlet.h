@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ServerRecastBenchmarkCommandlet.generated.h"
+
+/**
+* Export benchmark on a synthetic world, see FServerRecastBenchmark.
+*
+* UE4Editor-Cmd <Project> -run=ServerRecastBenchmark [-Seed=N] [-Prototypes=N] [-Instances=N] [-SoupTris=N] [-Areas=N]
+*	[-WorldSize=UU] [-Weld=UU] [-Workers=N] [-NoBuild] [-Compress] [-Voxelize] [-Map=<map>] [-Out=<dir>] [-Report=<file.json>]
+*
+* -Map gathers the map's octree first and adds synthetic content on top. Files go to Out,
+* defaults to <Project>/Saved/ServerRecastBenchmark. Returns 0 on success.
+*/
+UCLASS()
+class UServerRecastBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UServerRecastBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
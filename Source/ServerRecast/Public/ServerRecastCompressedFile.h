@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+class IFileHandle;
+
+/**
+* Chunk compressed container, written by FServerRecastStreamWriter when opened with bCompress.
+*
+* Layout: FServerRecastCompressedFileHeader, zlib chunks of at most ChunkSize uncompressed bytes each,
+* then the chunk table at TableOffset. Chunks are independent, so both sides work on them in parallel.
+* A chunk with CompressedSize == UncompressedSize is stored as is.
+*/
+
+#define SERVERRECAST_COMPRESSED_MAGIC	0x5A435253	// 'SRCZ'
+#define SERVERRECAST_COMPRESSED_VERSION	1
+/** biggest buffer FServerRecastStreamWriter may compress into one chunk, readers reject bigger ChunkSize */
+#define SERVERRECAST_COMPRESSED_MAX_CHUNK_SIZE	(64 * 1024 * 1024)
+
+struct FServerRecastCompressedFileHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 ChunkSize;
+	uint32 NumChunks;
+	uint64 UncompressedSize;
+	uint64 TableOffset;
+};
+
+struct FServerRecastCompressedChunk
+{
+	uint64 Offset;
+	uint32 CompressedSize;
+	uint32 UncompressedSize;
+};
+
+/** Streaming decompressor, chunks are decoded concurrently on the task graph and handed out in file order */
+class SERVERRECAST_API FServerRecastCompressedFileReader
+{
+public:
+	FServerRecastCompressedFileReader();
+	~FServerRecastCompressedFileReader();
+
+	bool Open(const FString& FileName);
+	void Close();
+
+	int64 GetUncompressedSize() const { return Header.UncompressedSize; }
+
+	/**
+	* Decodes the whole file, at most ChunksPerBatch chunks are in memory at once.
+	* @param Consumer - gets uncompressed data in order, returning false stops decoding
+	* @param ChunksPerBatch - 0 uses one chunk per task graph worker
+	*/
+	bool Decompress(TFunctionRef<bool(const uint8* Data, int32 Size)> Consumer, int32 ChunksPerBatch = 0);
+
+	/** Decodes straight into one buffer of GetUncompressedSize() bytes */
+	bool DecompressToMemory(TArray<uint8>& OutData);
+
+	static bool IsCompressedFile(const FString& FileName);
+
+private:
+	/** Reads compressed bytes of chunks [FirstChunk, FirstChunk + NumChunks) and decodes them to Dest(ChunkIndex) in parallel */
+	bool DecodeBatch(int32 FirstChunk, int32 NumChunks, TFunctionRef<uint8*(int32 ChunkIndex)> Dest);
+
+	IFileHandle* File;
+	FServerRecastCompressedFileHeader Header;
+	TArray<FServerRecastCompressedChunk> Chunks;
+	/** position of every chunk in uncompressed data */
+	TArray<uint64> UncompressedOffsets;
+	TArray<uint8> CompressedScratch;
+};
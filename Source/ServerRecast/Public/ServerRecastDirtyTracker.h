@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+
+class AActor;
+class UWorld;
+struct FPropertyChangedEvent;
+
+/**
+* Collects bounds of navigation relevant actors changed in the editor since the last export,
+* so the next export can rebuild only tiles under them. Old bounds are remembered per actor,
+* moved and deleted actors dirty the area they left too. Areas the navigation system dirties are collected as well,
+* they cover edits that fire no actor events, like landscape sculpting and foliage painting.
+*/
+class SERVERRECAST_API FServerRecastDirtyTracker
+{
+public:
+	void Register();
+	void Unregister();
+
+	/** Starts tracking World from a clean state, call after every export */
+	void Reset(UWorld* World);
+
+	bool IsTracking(const UWorld* World) const { return World && TrackedWorld.Get() == World; }
+
+	/** unreal space */
+	const TArray<FBox>& GetDirtyBounds() const { return DirtyBounds; }
+
+	/** NavMeshBoundsVolume or navigation data settings were edited, tiles anywhere may change */
+	bool NeedsFullExport() const { return bNeedsFullExport; }
+
+private:
+	void OnActorAdded(AActor* Actor);
+	void OnActorDeleted(AActor* Actor);
+	void OnActorMoved(AActor* Actor);
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent);
+	void OnMapChanged(uint32 MapChangeFlags);
+	void OnNavigationDirtied(const FBox& Bounds);
+
+	void MarkActorDirty(AActor* Actor, bool bRemoved);
+
+	/** @return false when actor has no component affecting navigation */
+	static bool GetActorNavigationBounds(const AActor* Actor, FBox& OutBounds);
+
+	TWeakObjectPtr<UWorld> TrackedWorld;
+	TMap<TWeakObjectPtr<AActor>, FBox> ActorBounds;
+	TArray<FBox> DirtyBounds;
+	bool bNeedsFullExport = false;
+
+	FDelegateHandle ActorAddedHandle;
+	FDelegateHandle ActorDeletedHandle;
+	FDelegateHandle ActorMovedHandle;
+	FDelegateHandle PropertyChangedHandle;
+	FDelegateHandle MapChangedHandle;
+	FDelegateHandle NavigationDirtiedHandle;
+};
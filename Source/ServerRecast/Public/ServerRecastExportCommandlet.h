@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ServerRecastExportCommandlet.generated.h"
+
+/**
+* Headless navmesh export, same result as the editor button.
+*
+* UE4Editor-Cmd <Project> -run=ServerRecastExport -Map=/Game/Maps/Server [-Out=<dir>] [-Workers=N] [-Weld=<eps>] [-Geometry] [-OBJ] [-Compress] [-TileReport] [-Tiled] [-CullUnwalkable] [-NoReport] [-LandscapeTriangles] [-Voxelize]
+*		[-TileCache=<dir>] [-TileCacheSizeMB=N] [-NoTileCache] [-FromBuiltNavMesh] [-TilePack] [-TileGraph]
+*
+* -Map accepts a long package name or a short map name. Navmesh is saved as <Out>/<MapName>.navmesh,
+* Out defaults to <Project>/Navmeshes. -Tiled streams geometry per tile for worlds that don't fit in memory.
+* -Weld merges level geometry vertices closer than eps (unreal units), off by default.
+* -Voxelize also saves rasterized tiles as <Out>/<MapName>_NavDataSet0_<time>.srvox and builds from them.
+* Built tiles are cached in -TileCache (default <Project>/Saved/ServerRecast/TileCache) by hash of their input,
+* point it to a shared directory to reuse tiles across branches and machines. Least recently used tiles are deleted
+* after the build while the cache is bigger than -TileCacheSizeMB (default 2048, 0 is unlimited).
+* -TilePack also writes <Out>/<MapName>.navpack for FServerRecastRuntimeNavMesh.
+* -TileGraph also writes <Out>/<MapName>.navgraph for FServerRecastHierarchicalPathfinder.
+* -FromBuiltNavMesh skips the export and saves navmesh tiles stored in the map package, built by the editor.
+* Counts, bytes written and phase times go to <Out>/<MapName>.report.json unless -NoReport is given.
+* Returns 0 on success.
+*/
+UCLASS()
+class UServerRecastExportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UServerRecastExportCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	/** Loads map package and sets it up like an editor world, streaming levels included, caller removes it from root */
+	static UWorld* LoadWorld(const FString& MapName);
+};
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+/** Cancel flag and counters shared by a background export and whoever watches it, every member is thread safe */
+struct FServerRecastExportProgress
+{
+	FThreadSafeBool bCancelRequested;
+
+	/** triangles gathered, written or rasterized into tiles so far */
+	FThreadSafeCounter64 NumProcessedTris;
+
+	double StartTime;
+
+	FServerRecastExportProgress() : StartTime(FPlatformTime::Seconds()) {}
+
+	bool IsCancelled() const { return bCancelRequested; }
+
+	void AddTris(int64 NumTris) { NumProcessedTris.Add(NumTris); }
+
+	double GetTrisPerSecond() const
+	{
+		const double Elapsed = FPlatformTime::Seconds() - StartTime;
+		return Elapsed > 0.0 ? NumProcessedTris.GetValue() / Elapsed : 0.0;
+	}
+};
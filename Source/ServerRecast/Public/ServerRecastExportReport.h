@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerRecastTriangleFilter.h"
+
+/** What one agent of an export did, filled by the thread running that agent */
+struct SERVERRECAST_API FServerRecastAgentExportReport
+{
+	FString NavDataName;
+	bool bIncremental;
+	bool bTiled;
+	bool bSuccess;
+
+	FServerRecastTriangleFilterStats FilterStats;
+	/** bytes of the agent's filtered index copy */
+	int64 FilteredIndexBytes;
+
+	int64 GeometryFileSize;
+	int64 OBJFileSize;
+	int64 NavMeshFileSize;
+	int64 VoxelFileSize;
+	int64 TilePackFileSize;
+	int64 TileGraphFileSize;
+	int32 NumBuiltTiles;
+	/** triangles rasterized into tiles, instances included */
+	int64 NumRasterizedTris;
+	int32 NumTileCacheHits;
+	int32 NumTileCacheMisses;
+
+	/** seconds */
+	double FilterTime;
+	double WriteGeometryTime;
+	double WriteOBJTime;
+	double WriteTiledGeometryTime;
+	double VoxelizeTime;
+	double BuildTime;
+	double SaveTime;
+	double TileGraphTime;
+	double TotalTime;
+
+	FServerRecastAgentExportReport();
+
+	int64 GetBytesWritten() const { return GeometryFileSize + OBJFileSize + NavMeshFileSize + VoxelFileSize + TilePackFileSize + TileGraphFileSize; }
+};
+
+/** Counts and phase times of one export, saved as JSON next to the exported files */
+struct SERVERRECAST_API FServerRecastExportReport
+{
+	FString MapName;
+	bool bSuccess;
+	bool bCancelled;
+
+	int32 NumElements;
+	int32 NumLevelGeometry;
+	int32 NumPrototypes;
+	int32 NumInstances;
+	int32 NumAreas;
+	/** landscapes kept as height grids and their samples */
+	int32 NumHeightfields;
+	int64 NumHeightfieldSamples;
+	/** triangles of shared geometry buffers, instances not expanded */
+	int64 NumTris;
+	int64 NumInstanceTris;
+
+	int64 GeometryBufferBytes;
+	/** all export buffers alive at once, shared and per agent */
+	int64 GeometryBufferPeakBytes;
+
+	/** seconds */
+	double GatherTime;
+	double AreaGrowTime;
+	double GeometryBuffersTime;
+	double TotalTime;
+
+	TArray<FServerRecastAgentExportReport> Agents;
+
+	FServerRecastExportReport();
+
+	void Log() const;
+
+	bool Save(const FString& FileName) const;
+};
@@ -0,0 +1,444 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerRecastVertexTransform.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class FServerRecastStreamWriter;
+struct FRecastBuildConfig;
+
+/**
+* Binary container for exported navigation geometry (*.srgeom).
+*
+* Layout: FServerRecastGeometryFileHeader, then the section table, then the sections themselves.
+* Every section starts on a SERVERRECAST_GEOMFILE_ALIGNMENT boundary and stores raw little-endian data,
+* so a mapped file can be handed to Recast as-is (vertices as float[3 * N], triangles as int32[3 * M]).
+* Instanced meshes are stored once per prototype plus a transform table, see FServerRecastInstanceSet.
+* Tiled files hold one TileBucket section per non-empty Detour tile instead of global vertices and triangles.
+* Landscapes are stored as height grids, see FServerRecastHeightfieldSet.
+* Voxel files (*.srvox) hold one VoxelTile section per non-empty tile, already rasterized and filtered.
+*/
+
+#define SERVERRECAST_GEOMFILE_MAGIC		0x4D475253	// 'SRGM'
+#define SERVERRECAST_GEOMFILE_VERSION	6
+#define SERVERRECAST_GEOMFILE_ALIGNMENT	64
+
+namespace EServerRecastGeometrySection
+{
+	enum Type : uint32
+	{
+		/** recast coords of vertices, float[3 * Count] */
+		Vertices = 1,
+		/** vert indices for triangles, int32[3 * Count] */
+		Triangles = 2,
+		/** FServerRecastGeometryFileArea[Count] */
+		Areas = 3,
+		/** recast coords of area convex points, float[3 * Count] */
+		AreaPoints = 4,
+		/** FServerRecastGeometryFilePrototype[Count] */
+		Prototypes = 5,
+		/** prototype local recast coords, float[3 * Count] */
+		PrototypeVertices = 6,
+		/** prototype local vert indices, int32[3 * Count] */
+		PrototypeTriangles = 7,
+		/** FServerRecastGeometryFileInstance[Count] */
+		Instances = 8,
+		/** FServerRecastGeometryFileTileBucket followed by its vertices and triangles, one section per tile */
+		TileBucket = 9,
+		/** FServerRecastGeometryFileHeightfield[Count] */
+		Heightfields = 10,
+		/** heightfield samples, int16[Count] */
+		HeightfieldSamples = 11,
+		/** heightfield hole and split bits, uint32[Count] */
+		HeightfieldMasks = 12,
+		/** FServerRecastGeometryFileVoxelTile followed by its encoded spans, one section per tile */
+		VoxelTile = 13,
+	};
+}
+
+/** rd_* values that used to be appended to the OBJ file for RecastDemo */
+struct FServerRecastGeometryFileConfig
+{
+	float AgentHeight;
+	float AgentRadius;
+	float CellSize;
+	float CellHeight;
+	float AgentMaxClimb;
+	float AgentMaxSlope;
+	int32 RegionMinSize;
+	int32 RegionMergeSize;
+	int32 MaxEdgeLen;
+	int32 bPerformVoxelFiltering;
+	int32 bGenerateDetailedMesh;
+	int32 MaxPolysPerTile;
+	int32 MaxVertsPerPoly;
+	int32 TileSize;
+
+	/** voxel space values as computed by the editor generator, the builder uses these directly */
+	int32 WalkableHeight;
+	int32 WalkableClimb;
+	int32 WalkableRadius;
+	int32 BorderSize;
+	int32 MinRegionArea;
+	int32 MergeRegionArea;
+	float MaxSimplificationError;
+	float DetailSampleDist;
+	float DetailSampleMaxError;
+
+	void Init(const FRecastBuildConfig& Config);
+	void ToRecastConfig(FRecastBuildConfig& OutConfig) const;
+};
+
+struct FServerRecastGeometryFileSection
+{
+	uint64 Offset;
+	uint64 Size;
+	uint32 Type;
+	uint32 Count;
+};
+
+struct FServerRecastGeometryFileHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 HeaderSize;
+	uint32 NumSections;
+
+	/** rd_bbox, recast coords */
+	float BoundsMin[3];
+	float BoundsMax[3];
+
+	FServerRecastGeometryFileConfig Config;
+};
+
+struct FServerRecastGeometryFileArea
+{
+	uint8 AreaId;
+	uint8 Padding[3];
+	/** index of the first point in AreaPoints section */
+	int32 FirstPoint;
+	int32 NumPoints;
+	float MinZ;
+	float MaxZ;
+};
+
+struct FServerRecastGeometryFilePrototype
+{
+	int32 FirstVert;
+	int32 NumVerts;
+	int32 FirstTri;
+	int32 NumTris;
+	/** local recast space */
+	float BoundsMin[3];
+	float BoundsMax[3];
+};
+
+struct FServerRecastGeometryFileInstance
+{
+	int32 PrototypeIndex;
+	/** prototype local recast space to world recast space */
+	FServerRecastAffine3x4 Transform;
+	/** world recast space */
+	float BoundsMin[3];
+	float BoundsMax[3];
+
+	FBox GetBounds() const { return FBox(FVector(BoundsMin[0], BoundsMin[1], BoundsMin[2]), FVector(BoundsMax[0], BoundsMax[1], BoundsMax[2])); }
+};
+
+/** Geometry overlapping one tile including its border, indices are local to the bucket */
+struct FServerRecastGeometryFileTileBucket
+{
+	int32 TileX;
+	int32 TileY;
+	int32 NumVerts;
+	int32 NumTris;
+
+	const float* GetVerts() const { return (const float*)(this + 1); }
+	const int32* GetTris() const { return (const int32*)(GetVerts() + NumVerts * 3); }
+
+	static uint64 GetSize(int32 InNumVerts, int32 InNumTris) { return sizeof(FServerRecastGeometryFileTileBucket) + (uint64)InNumVerts * 3 * sizeof(float) + (uint64)InNumTris * 3 * sizeof(int32); }
+};
+
+/** Solid heightfield of one tile including its border, spans run-length encoded, see ServerRecastVoxelTile */
+struct FServerRecastGeometryFileVoxelTile
+{
+	int32 TileX;
+	int32 TileY;
+	/** voxel columns along X and Z */
+	int32 Width;
+	int32 Height;
+	int32 NumSpans;
+	int32 DataSize;
+
+	const uint8* GetData() const { return (const uint8*)(this + 1); }
+
+	static uint64 GetSize(int32 InDataSize) { return sizeof(FServerRecastGeometryFileVoxelTile) + InDataSize; }
+};
+
+/**
+* Regular height grid in recast space, rows go along X and columns along Z.
+* Sample (Row, Col) is at Origin + (Row * StepX, Samples[FirstSample + Row * NumCols + Col] * HeightScale, Col * StepZ).
+*/
+struct FServerRecastGeometryFileHeightfield
+{
+	float Origin[3];
+	/** signed distance between rows and columns */
+	float StepX;
+	float StepZ;
+	float HeightScale;
+	int32 NumRows;
+	int32 NumCols;
+	/** index of the first sample in HeightfieldSamples section */
+	int32 FirstSample;
+	/** index of the first word in HeightfieldMasks section, hole bits of all quads followed by their split bits */
+	int32 FirstMaskWord;
+	/** recast space */
+	float BoundsMin[3];
+	float BoundsMax[3];
+
+	int32 GetNumQuads() const { return (NumRows - 1) * (NumCols - 1); }
+	int32 GetNumMaskWords() const { return FMath::DivideAndRoundUp(GetNumQuads(), 32); }
+
+	FBox GetBounds() const { return FBox(FVector(BoundsMin[0], BoundsMin[1], BoundsMin[2]), FVector(BoundsMax[0], BoundsMax[1], BoundsMax[2])); }
+};
+
+/** Prototype meshes and their instances, expanded to plain triangles only where someone needs them */
+struct FServerRecastInstanceSet
+{
+	const FServerRecastGeometryFilePrototype* Prototypes;
+	const float* Verts;
+	const int32* Tris;
+	const FServerRecastGeometryFileInstance* Instances;
+	int32 NumInstances;
+
+	FServerRecastInstanceSet()
+		: Prototypes(nullptr), Verts(nullptr), Tris(nullptr), Instances(nullptr), NumInstances(0)
+	{
+	}
+
+	/**
+	* Appends triangles of all instances overlapping Bounds (recast space) to OutCoords/OutIndices.
+	* @param Bounds - nullptr expands every instance
+	*/
+	template<typename CoordArrayType, typename IndexArrayType>
+	void Expand(const FBox* Bounds, CoordArrayType& OutCoords, IndexArrayType& OutIndices) const
+	{
+		for (int32 InstanceIndex = 0; InstanceIndex < NumInstances; ++InstanceIndex)
+		{
+			const FServerRecastGeometryFileInstance& Instance = Instances[InstanceIndex];
+			if (Bounds && !Bounds->Intersect(Instance.GetBounds()))
+			{
+				continue;
+			}
+
+			const FServerRecastGeometryFilePrototype& Prototype = Prototypes[Instance.PrototypeIndex];
+			const int32 BaseVert = OutCoords.Num() / 3;
+
+			const int32 CoordStart = OutCoords.AddUninitialized(Prototype.NumVerts * 3);
+			ServerRecastVertexTransform::TransformPoints(Instance.Transform, Verts + Prototype.FirstVert * 3, OutCoords.GetData() + CoordStart, Prototype.NumVerts);
+
+			const int32 IndexStart = OutIndices.AddUninitialized(Prototype.NumTris * 3);
+			const int32* SrcIndices = Tris + Prototype.FirstTri * 3;
+			for (int32 i = 0; i < Prototype.NumTris * 3; i++)
+			{
+				OutIndices[IndexStart + i] = SrcIndices[i] + BaseVert;
+			}
+		}
+	}
+};
+
+/**
+* Height grids with hole and split masks. Quads are split along the (Row, Col) - (Row + 1, Col + 1) diagonal
+* when their split bit is set, along the other one otherwise, same as PhysX heightfield tessellation.
+*/
+struct SERVERRECAST_API FServerRecastHeightfieldSet
+{
+	const FServerRecastGeometryFileHeightfield* Heightfields;
+	int32 NumHeightfields;
+	const int16* Samples;
+	const uint32* Masks;
+
+	FServerRecastHeightfieldSet()
+		: Heightfields(nullptr), NumHeightfields(0), Samples(nullptr), Masks(nullptr)
+	{
+	}
+
+	bool IsHole(const FServerRecastGeometryFileHeightfield& Heightfield, int32 Row, int32 Col) const
+	{
+		const int32 Quad = Row * (Heightfield.NumCols - 1) + Col;
+		return (Masks[Heightfield.FirstMaskWord + Quad / 32] & (1u << (Quad & 31))) != 0;
+	}
+
+	bool IsSplit(const FServerRecastGeometryFileHeightfield& Heightfield, int32 Row, int32 Col) const
+	{
+		const int32 Quad = Row * (Heightfield.NumCols - 1) + Col;
+		return (Masks[Heightfield.FirstMaskWord + Heightfield.GetNumMaskWords() + Quad / 32] & (1u << (Quad & 31))) != 0;
+	}
+
+	float GetSampleHeight(const FServerRecastGeometryFileHeightfield& Heightfield, int32 Row, int32 Col) const
+	{
+		return Heightfield.Origin[1] + Samples[Heightfield.FirstSample + Row * Heightfield.NumCols + Col] * Heightfield.HeightScale;
+	}
+
+	/**
+	* Surface height at recast X, Z, interpolated over the triangle containing the point.
+	* @param bOutHole - set when the quad under the point is a hole
+	* @return false outside the grid
+	*/
+	bool GetHeight(const FServerRecastGeometryFileHeightfield& Heightfield, float X, float Z, float& OutHeight, bool& bOutHole) const;
+
+	/**
+	* Appends triangles of heightfields overlapping Bounds (recast space), holes skipped, for consumers without heightfield support.
+	* @param Bounds - nullptr expands everything
+	*/
+	template<typename CoordArrayType, typename IndexArrayType>
+	void Expand(const FBox* Bounds, CoordArrayType& OutCoords, IndexArrayType& OutIndices) const
+	{
+		for (int32 HeightfieldIndex = 0; HeightfieldIndex < NumHeightfields; ++HeightfieldIndex)
+		{
+			const FServerRecastGeometryFileHeightfield& Heightfield = Heightfields[HeightfieldIndex];
+			if (Bounds && !Bounds->Intersect(Heightfield.GetBounds()))
+			{
+				continue;
+			}
+
+			const int32 BaseVert = OutCoords.Num() / 3;
+			const int32 CoordStart = OutCoords.AddUninitialized(Heightfield.NumRows * Heightfield.NumCols * 3);
+			for (int32 Row = 0; Row < Heightfield.NumRows; ++Row)
+			{
+				for (int32 Col = 0; Col < Heightfield.NumCols; ++Col)
+				{
+					const int32 Coord = CoordStart + (Row * Heightfield.NumCols + Col) * 3;
+					OutCoords[Coord + 0] = Heightfield.Origin[0] + Row * Heightfield.StepX;
+					OutCoords[Coord + 1] = GetSampleHeight(Heightfield, Row, Col);
+					OutCoords[Coord + 2] = Heightfield.Origin[2] + Col * Heightfield.StepZ;
+				}
+			}
+
+			for (int32 Row = 0; Row < Heightfield.NumRows - 1; ++Row)
+			{
+				for (int32 Col = 0; Col < Heightfield.NumCols - 1; ++Col)
+				{
+					if (IsHole(Heightfield, Row, Col))
+					{
+						continue;
+					}
+
+					const int32 V00 = BaseVert + Row * Heightfield.NumCols + Col;
+					const int32 V01 = V00 + 1;
+					const int32 V10 = V00 + Heightfield.NumCols;
+					const int32 V11 = V10 + 1;
+					const int32 QuadTris[2][3][3] = {
+						{ { V11, V10, V00 }, { V01, V11, V00 } },
+						{ { V01, V10, V00 }, { V01, V11, V10 } } };
+					const int32 (&Tris)[2][3] = QuadTris[IsSplit(Heightfield, Row, Col) ? 0 : 1];
+					const int32 IndexStart = OutIndices.AddUninitialized(6);
+					for (int32 i = 0; i < 6; i++)
+					{
+						OutIndices[IndexStart + i] = Tris[i / 3][i % 3];
+					}
+				}
+			}
+		}
+	}
+};
+
+/**
+* Gathers sections in memory order and writes the container in a single pass.
+* Sections too big to keep around can be streamed instead: BeginStream writes what was added so far,
+* StreamSection writes each following section right away and EndStream patches header and table.
+*/
+class SERVERRECAST_API FServerRecastGeometryFileWriter
+{
+public:
+	FServerRecastGeometryFileWriter(const FBox& InRecastBounds, const FRecastBuildConfig& InConfig);
+	~FServerRecastGeometryFileWriter();
+
+	/** Data is not copied, it must stay alive until Write() or BeginStream() returns */
+	void AddSection(EServerRecastGeometrySection::Type Type, const void* Data, uint64 Size, uint32 Count);
+
+	/** @param bCompress - wrap the container into FServerRecastCompressedFileReader format */
+	bool Write(const FString& FileName, bool bCompress = false) const;
+
+	/**
+	* Streamed files are never compressed, header and section table are rewritten in place at the end.
+	* @param MaxStreamedSections - table space reserved for StreamSection calls
+	*/
+	bool BeginStream(const FString& FileName, int32 MaxStreamedSections);
+	/** @return false when the reserved table is full or a write failed, the file is unusable then */
+	bool StreamSection(EServerRecastGeometrySection::Type Type, const void* Data, uint64 Size, uint32 Count);
+	bool EndStream();
+
+private:
+	void WritePadding();
+
+	struct FPendingSection
+	{
+		FServerRecastGeometryFileSection Desc;
+		const void* Data;
+	};
+
+	FServerRecastGeometryFileHeader Header;
+	TArray<FPendingSection> Sections;
+
+	/** streaming state */
+	TUniquePtr<FServerRecastStreamWriter> Stream;
+	FString StreamFileName;
+	TArray<FServerRecastGeometryFileSection> StreamTable;
+	int32 MaxStreamTableSize;
+};
+
+/** Read-only view of an exported container, memory mapped when the platform allows it, compressed files are decoded to memory */
+class SERVERRECAST_API FServerRecastGeometryFileView
+{
+public:
+	FServerRecastGeometryFileView();
+	~FServerRecastGeometryFileView();
+
+	bool Open(const FString& FileName);
+	void Close();
+
+	bool IsValid() const { return Data != nullptr; }
+	const FServerRecastGeometryFileHeader& GetHeader() const { return *reinterpret_cast<const FServerRecastGeometryFileHeader*>(Data); }
+
+	/** @return pointer to section data or nullptr if the file has no such section */
+	const void* FindSection(EServerRecastGeometrySection::Type Type, uint32* OutCount = nullptr, uint64* OutSize = nullptr) const;
+
+	const float* GetVertices(int32& OutNumVerts) const;
+	const int32* GetTriangles(int32& OutNumTris) const;
+	const FServerRecastGeometryFileArea* GetAreas(int32& OutNumAreas) const;
+	const float* GetAreaPoints(int32& OutNumPoints) const;
+	FServerRecastInstanceSet GetInstanceSet() const;
+	FServerRecastHeightfieldSet GetHeightfieldSet() const;
+
+	/** @return TileBucket sections in file order */
+	TArray<const FServerRecastGeometryFileTileBucket*> GetTileBuckets() const;
+
+	/** @return VoxelTile sections in file order */
+	TArray<const FServerRecastGeometryFileVoxelTile*> GetVoxelTiles() const;
+
+private:
+	bool Validate() const;
+
+	/** @return false when counts don't fit their sections or prototype and instance indices are out of range */
+	static bool ValidateInstanceSet(const FServerRecastInstanceSet& InstanceSet, uint32 NumInstances, uint32 NumPrototypes, uint32 NumVerts, uint32 NumTris,
+		uint64 InstancesSize, uint64 PrototypesSize, uint64 VertsSize, uint64 TrisSize);
+
+	/** @return false when counts don't fit their sections or a grid reaches past the samples or masks */
+	static bool ValidateHeightfieldSet(const FServerRecastHeightfieldSet& HeightfieldSet, uint32 NumHeightfields, uint32 NumSamples, uint32 NumMaskWords,
+		uint64 HeightfieldsSize, uint64 SamplesSize, uint64 MasksSize);
+
+	/** @return false when counts don't fit the section or triangle indices are out of range */
+	static bool ValidateTileBucket(const FServerRecastGeometryFileTileBucket& Bucket, uint64 SectionSize);
+
+	IMappedFileHandle* MappedHandle;
+	IMappedFileRegion* MappedRegion;
+	/** fallback storage when the file can't be mapped */
+	TArray<uint8> LoadedData;
+
+	const uint8* Data;
+	int64 DataSize;
+};
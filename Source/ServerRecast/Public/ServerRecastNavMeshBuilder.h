@@ -0,0 +1,241 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Navmesh/RecastNavMeshGenerator.h"
+#include "ServerRecastGeometryFile.h"
+#include "ServerRecastExportProgress.h"
+
+class dtNavMesh;
+class rcContext;
+struct rcHeightfield;
+class FServerRecastTileCache;
+class FSHAHash;
+
+/** Area flag set on every walkable poly of the built navmesh */
+#define SERVERRECAST_POLYFLAG_WALK	0x01
+
+/** Geometry and config for a navmesh build, nothing is copied so sources must outlive the builder */
+struct SERVERRECAST_API FServerRecastBuildInput
+{
+	FRecastBuildConfig Config;
+
+	/** navigable bounds, recast coords */
+	FBox Bounds;
+
+	const float* Coords;
+	int32 NumVerts;
+	const int32* Tris;
+	int32 NumTris;
+
+	FServerRecastInstanceSet Instances;
+
+	/** landscapes, rasterized straight from the grid */
+	FServerRecastHeightfieldSet Heightfields;
+
+	const FServerRecastGeometryFileArea* Areas;
+	int32 NumAreas;
+	const float* AreaPoints;
+
+	/** per-tile geometry of tiled files, any order, used together with the global triangles */
+	TArray<const FServerRecastGeometryFileTileBucket*> TileBuckets;
+
+	/** rasterized and filtered tiles of voxel files, when set geometry is ignored and tiles without one are empty */
+	TArray<const FServerRecastGeometryFileVoxelTile*> VoxelTiles;
+
+	FServerRecastBuildInput();
+
+	void InitFromFile(const FServerRecastGeometryFileView& View);
+};
+
+/** Splits recast space navigable bounds into Detour tiles of tileSize * cs, origin at bounds min */
+struct SERVERRECAST_API FServerRecastTileGrid
+{
+	FBox Bounds;
+	float TileWorldSize;
+	/** recast border in world units, tiles rasterize geometry this far outside their bounds */
+	float BorderSize;
+	int32 TilesWidth;
+	int32 TilesHeight;
+
+	FServerRecastTileGrid();
+	FServerRecastTileGrid(const FRecastBuildConfig& Config, const FBox& RecastBounds);
+
+	bool IsValid() const { return TilesWidth > 0 && TilesHeight > 0; }
+	int32 GetNumTiles() const { return TilesWidth * TilesHeight; }
+
+	FBox GetTileBounds(int32 TileX, int32 TileY, bool bWithBorder) const;
+
+	/**
+	* Inclusive range of tiles whose bordered bounds overlap RecastBox on XZ plane.
+	* @return false when RecastBox misses the grid
+	*/
+	bool GetTileRange(const FBox& RecastBox, FIntPoint& OutMin, FIntPoint& OutMax) const;
+};
+
+struct FServerRecastTileBuildStats
+{
+	int32 TileX;
+	int32 TileY;
+	/** static and instanced triangles rasterized into the tile */
+	int32 NumTris;
+	int32 DataSize;
+	int32 WorkerIndex;
+	/** milliseconds */
+	float BuildTime;
+	/** copied from the tile cache instead of built */
+	bool bFromCache;
+};
+
+/**
+* Builds a tiled Detour navmesh straight from exported geometry, replaces the RecastDemo round trip.
+* Tile data uses the engine's Detour layout, load it with the same Detour version.
+*/
+class SERVERRECAST_API FServerRecastNavMeshBuilder
+{
+public:
+	explicit FServerRecastNavMeshBuilder(const FServerRecastBuildInput& InInput);
+	~FServerRecastNavMeshBuilder();
+
+	/**
+	* Tiles are built concurrently, each worker keeps its own rcContext and scratch buffers and pulls the next
+	* tile from a shared queue sorted by triangle count. Tiles are added to dtNavMesh in row order afterwards,
+	* so output doesn't depend on scheduling.
+	* @param NumWorkers - 0 uses every task graph worker plus the calling thread, 1 builds on calling thread only
+	*/
+	bool Build(int32 NumWorkers = 0);
+
+	/**
+	* Loads navmesh saved by a previous build and rebuilds only given tiles, the rest is kept as is.
+	* Falls back to a full build when the file is missing or its tile grid doesn't match.
+	*/
+	bool Rebuild(const FString& ExistingFileName, const TArray<FIntPoint>& Tiles, int32 NumWorkers = 0);
+
+	/**
+	* Rasterizes and filters all tiles in parallel and streams their spans to a voxel file (*.srvox), tile by tile.
+	* Building from that file starts at the compact heightfield, rasterization is skipped.
+	* @return false when writing failed or was cancelled
+	*/
+	bool Voxelize(const FString& FileName, int32 NumWorkers = 0);
+
+	/** Build stops picking up tiles once cancel is requested and leaves the navmesh untouched, tiles report rasterized triangles */
+	void SetProgress(FServerRecastExportProgress* InProgress) { Progress = InProgress; }
+
+	/** Tiles whose input hash is in the cache are copied from it, built tiles are added to it, nullptr disables */
+	void SetTileCache(FServerRecastTileCache* InTileCache) { TileCache = InTileCache; }
+
+	bool WasCancelled() const { return Progress && Progress->IsCancelled(); }
+
+	/** Writes all tiles in RecastDemo's all_tiles_navmesh.bin layout */
+	bool Save(const FString& FileName) const;
+
+	const dtNavMesh* GetNavMesh() const { return NavMesh; }
+
+	const FServerRecastTileGrid& GetTileGrid() const { return Grid; }
+	int32 GetTilesWidth() const { return Grid.TilesWidth; }
+	int32 GetTilesHeight() const { return Grid.TilesHeight; }
+
+	const TArray<FServerRecastTileBuildStats>& GetTileStats() const { return TileStats; }
+
+	/** Logs totals and the slowest tiles */
+	void LogTileReport(int32 NumSlowestTiles = 10) const;
+
+	/** Writes per-tile build stats as CSV */
+	bool SaveTileReport(const FString& FileName) const;
+
+	static bool SaveNavMeshSet(const dtNavMesh& InNavMesh, const FString& FileName);
+
+	/** @return navmesh owning its tiles, free with dtFreeNavMesh, or nullptr when file can't be read */
+	static dtNavMesh* LoadNavMeshSet(const FString& FileName);
+
+	/**
+	* SHA1 of build settings and navigation bounds (recast bounds and NavMeshBoundsVolumes in unreal space),
+	* tiles of a navmesh built with another key can't be patched in.
+	*/
+	static FString GetBuildKey(const FRecastBuildConfig& Config, const FBox& RecastBounds, const TArray<FBox>& InclusionBounds);
+
+	/** key of a navmesh set is saved next to it as <FileName>.buildkey */
+	static FString GetBuildKeyFileName(const FString& NavMeshFileName) { return NavMeshFileName + TEXT(".buildkey"); }
+
+	/** @return empty string when navmesh set has no key */
+	static FString LoadBuildKey(const FString& NavMeshFileName);
+	static bool SaveBuildKey(const FString& NavMeshFileName, const FString& Key);
+
+protected:
+	/** Reusable per-tile buffers */
+	struct FTileScratch
+	{
+		TArray<int32> Tris;
+		TArray<uint8> TriAreas;
+		TArray<float> InstanceCoords;
+		TArray<int32> InstanceTris;
+		TArray<float> HeightfieldCorners;
+		/** tile cache key and entry buffers */
+		TArray<float> KeyCoords;
+		TArray<uint8> KeyBytes;
+		TArray<uint8> CachedTile;
+
+		/** set by GatherTile */
+		const FServerRecastGeometryFileTileBucket* Bucket;
+		const FServerRecastGeometryFileVoxelTile* VoxelTile;
+		bool bHasHeightfields;
+
+		FTileScratch() : Bucket(nullptr), VoxelTile(nullptr), bHasHeightfields(false) {}
+	};
+
+	/** Collects static and instanced triangles, bucket, heightfields or voxel tile of the bordered tile into Scratch, @return false for empty tiles */
+	bool GatherTile(int32 TileX, int32 TileY, FTileScratch& Scratch) const;
+
+	/** SHA1 of everything gathered for the tile plus config, grid and overlapping areas, the tile cache key */
+	void HashTileInput(int32 TileX, int32 TileY, FTileScratch& Scratch, FSHAHash& OutKey) const;
+
+	/**
+	* Builds gathered tile, @return tile blob allocated with dtAlloc or nullptr for empty tiles
+	* @param bOutFailed - set when a Recast or Detour step failed, nullptr doesn't mean the tile is empty then
+	*/
+	uint8* BuildTile(int32 TileX, int32 TileY, rcContext& Context, FTileScratch& Scratch, int32& OutDataSize, bool& bOutFailed) const;
+
+	/** Creates empty solid heightfield of the bordered tile */
+	bool CreateTileHeightfield(int32 TileX, int32 TileY, rcContext& Context, rcHeightfield& Solid) const;
+
+	/** Rasterizes gathered geometry into Solid and runs span filters, @return false for empty tiles */
+	bool RasterizeTile(int32 TileX, int32 TileY, rcContext& Context, FTileScratch& Scratch, rcHeightfield& Solid) const;
+
+	/**
+	* Adds one span per voxel column covered by a height grid, from the lowest to the highest surface point of the column.
+	* @return false when no column was covered
+	*/
+	bool RasterizeHeightfields(rcContext& Context, rcHeightfield& Solid, const FBox& TileBounds, FTileScratch& Scratch) const;
+
+	bool InitNavMesh();
+
+	void BinTriangles();
+
+	/** triangles (static, bucket, instance and height grid) or voxel spans rasterized for a tile, orders the build queue */
+	int64 GetTileInputCost(int32 TileIndex) const { return TileInputCost[TileIndex]; }
+
+	/** Builds tiles in parallel and replaces them in NavMesh in row order, TileIndices must be sorted, @return false when cancelled */
+	bool BuildTiles(const TArray<int32>& TileIndices, int32 NumWorkers);
+
+	const FServerRecastBuildInput& Input;
+	const FServerRecastTileGrid Grid;
+	dtNavMesh* NavMesh;
+
+	/** static triangles overlapping each tile, border included */
+	TArray<TArray<int32>> TileTriangles;
+	/** Input.TileBuckets by tile index, nullptr for tiles without bucket */
+	TArray<const FServerRecastGeometryFileTileBucket*> TileBuckets;
+	/** Input.VoxelTiles by tile index */
+	TArray<const FServerRecastGeometryFileVoxelTile*> VoxelTiles;
+	/** see GetTileInputCost */
+	TArray<int64> TileInputCost;
+
+	/** tiles of the last build in row order, empty tiles included */
+	TArray<FServerRecastTileBuildStats> TileStats;
+	double BuildTime;
+	int32 NumUsedWorkers;
+
+	FServerRecastExportProgress* Progress;
+	FServerRecastTileCache* TileCache;
+};
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+
+DECLARE_STATS_GROUP(TEXT("ServerRecast"), STATGROUP_ServerRecast, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Gather"), STAT_ServerRecast_Gather, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Area grow"), STAT_ServerRecast_AreaGrow, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Geometry buffers"), STAT_ServerRecast_GeometryBuffers, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Triangle filter"), STAT_ServerRecast_TriangleFilter, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Write geometry file"), STAT_ServerRecast_WriteGeometry, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Write OBJ"), STAT_ServerRecast_WriteOBJ, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Write tiled geometry file"), STAT_ServerRecast_WriteTiledGeometry, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Voxelize"), STAT_ServerRecast_Voxelize, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build navmesh"), STAT_ServerRecast_BuildNavMesh, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build tile"), STAT_ServerRecast_BuildTile, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save navmesh"), STAT_ServerRecast_SaveNavMesh, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build tile graph"), STAT_ServerRecast_BuildTileGraph, STATGROUP_ServerRecast, SERVERRECAST_API);
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Geometry buffers"), STAT_ServerRecast_GeometryBufferMemory, STATGROUP_ServerRecast, SERVERRECAST_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Geometry buffers peak"), STAT_ServerRecast_GeometryBufferPeak, STATGROUP_ServerRecast, SERVERRECAST_API);
+
+/** Cycle counter for stat ServerRecast plus named event for external profilers */
+#define SERVERRECAST_SCOPE_STAT(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	SCOPED_NAMED_EVENT(Stat, FColor::Emerald)
+
+/** Export phase, SERVERRECAST_SCOPE_STAT and wall time added to Seconds (double) for the export report */
+#define SERVERRECAST_SCOPE_PHASE(Stat, Seconds) \
+	SERVERRECAST_SCOPE_STAT(Stat); \
+	FScopedDurationTimer ANONYMOUS_VARIABLE(ServerRecastPhaseTimer)(Seconds)
+
+namespace ServerRecastStats
+{
+	/** Coord and index buffers of exports, updates memory stats and peak, Delta is negative when buffers are released */
+	SERVERRECAST_API void AddGeometryBufferMemory(int64 Delta);
+
+	/** @return highest geometry buffer total since the last reset */
+	SERVERRECAST_API int64 GetGeometryBufferPeak();
+
+	SERVERRECAST_API void ResetGeometryBufferPeak();
+}
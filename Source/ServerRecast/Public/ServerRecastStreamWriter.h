@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "Async/Future.h"
+
+class IFileHandle;
+class FEvent;
+struct FServerRecastCompressedChunk;
+
+/**
+* Sequential file writer with a fixed set of reusable buffers. Producer formats into the current buffer,
+* full buffers are written by a background I/O thread, so formatting and disk writes overlap and memory
+* use is bounded by BufferSize * NumBuffers no matter how big the file gets.
+* With compression every buffer becomes one zlib chunk of FServerRecastCompressedFileReader format,
+* chunks are compressed in parallel on the task graph and written in order.
+*/
+class SERVERRECAST_API FServerRecastStreamWriter
+{
+public:
+	explicit FServerRecastStreamWriter(int32 InBufferSize = 4 * 1024 * 1024, int32 InNumBuffers = 4);
+	~FServerRecastStreamWriter();
+
+	bool Open(const FString& FileName, bool bCompress = false);
+
+	/**
+	* Flushes everything and waits for the I/O thread, @return false if any write failed
+	* @param HeadData - optional bytes that overwrite the start of an uncompressed file, for headers known only at the end
+	*/
+	bool Close(const void* HeadData = nullptr, int64 HeadSize = 0);
+
+	void Write(const void* Data, int64 Size);
+
+	/** a background write already failed, Close will return false */
+	bool HasFailed() const { return bIOError; }
+
+	/** @return space for at least MaxBytes (must fit in one buffer), finish with Commit */
+	FORCEINLINE ANSICHAR* Reserve(int32 MaxBytes)
+	{
+		if (Cursor + MaxBytes > End)
+		{
+			Submit();
+		}
+		return (ANSICHAR*)Cursor;
+	}
+
+	/** @param NewCursor - first byte after data written into reserved space */
+	FORCEINLINE void Commit(ANSICHAR* NewCursor)
+	{
+		checkSlow((uint8*)NewCursor >= Cursor && (uint8*)NewCursor <= End);
+		Cursor = (uint8*)NewCursor;
+	}
+
+	/** uncompressed position */
+	int64 Tell() const { return SubmittedBytes + (Cursor - Begin); }
+
+private:
+	void Submit();
+	void AcquireBuffer();
+	void RunIOThread();
+
+	struct FBuffer
+	{
+		TArray<uint8> Data;
+		int32 Used;
+		TArray<uint8> Compressed;
+		TFuture<void> CompressTask;
+	};
+
+	const int32 BufferSize;
+	TArray<FBuffer> Buffers;
+
+	/** buffer indices ready to be written, INDEX_NONE stops the I/O thread */
+	TQueue<int32, EQueueMode::Spsc> PendingBuffers;
+	TQueue<int32, EQueueMode::Mpsc> FreeBuffers;
+	FEvent* PendingEvent;
+	FEvent* FreeEvent;
+
+	IFileHandle* File;
+	TFuture<void> IOThread;
+	volatile bool bIOError;
+
+	bool bCompress;
+	/** chunk table, owned by I/O thread until it stops */
+	TArray<FServerRecastCompressedChunk> ChunkTable;
+	int64 FileOffset;
+
+	int32 Current;
+	uint8* Begin;
+	uint8* Cursor;
+	uint8* End;
+	int64 SubmittedBytes;
+};
+
+namespace ServerRecastTextFormat
+{
+	/** Longest output of FormatFloat/FormatInt */
+	static const int32 MaxNumberLength = 64;
+
+	/**
+	* Same text as printf("%f"), without locale or allocations.
+	* Floats are exact after scaling by 1e6 in double precision, so rounding matches a correctly rounded printf.
+	* @return number of characters written, no terminator
+	*/
+	SERVERRECAST_API int32 FormatFloat(float Value, ANSICHAR* Out);
+
+	SERVERRECAST_API int32 FormatInt(int64 Value, ANSICHAR* Out);
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/SecureHash.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+/** bump when tile build code changes its output for the same input, old entries are then never hit */
+#define SERVERRECAST_TILECACHE_KEY_VERSION	1
+
+/**
+* On-disk store of built Detour tiles keyed by SHA1 of everything the tile is built from:
+* overlapping geometry, area convexes, build config and tile position, see FServerRecastNavMeshBuilder::HashTileInput.
+* Entries are never invalidated, changed input gives a new key, so one directory can be shared
+* by branches and machines. Entries are written to a temporary file and renamed, readers never see partial ones.
+* Hits refresh the entry time stamp, Prune drops least recently used entries over the size budget.
+* All methods are thread safe.
+*/
+class SERVERRECAST_API FServerRecastTileCache
+{
+public:
+	/** @param InMaxSize - directory size budget in bytes enforced by Prune, 0 is unlimited */
+	explicit FServerRecastTileCache(const FString& InDirectory, int64 InMaxSize = 0);
+
+	/** @return true on hit, OutData stays empty for tiles that built no polys. Corrupted entries are deleted and miss */
+	bool Load(const FSHAHash& Key, TArray<uint8>& OutData);
+
+	/** @param Data - tile blob, nullptr stores an empty tile */
+	void Store(const FSHAHash& Key, const uint8* Data, int32 DataSize);
+
+	/** Deletes least recently used entries until the directory fits the size budget */
+	void Prune();
+
+	const FString& GetDirectory() const { return Directory; }
+
+	int32 GetNumHits() const { return NumHits.GetValue(); }
+	int32 GetNumMisses() const { return NumMisses.GetValue(); }
+	int32 GetNumStores() const { return NumStores.GetValue(); }
+	int64 GetBytesRead() const { return BytesRead.GetValue(); }
+	int64 GetBytesWritten() const { return BytesWritten.GetValue(); }
+	int32 GetNumPruned() const { return NumPruned.GetValue(); }
+
+	void LogStats() const;
+
+private:
+	/** <Directory>/<first two hex digits>/<hex key>.tile, keeps directories small */
+	FString GetEntryFileName(const FSHAHash& Key) const;
+
+	FString Directory;
+	int64 MaxSize;
+
+	FThreadSafeCounter NumHits;
+	FThreadSafeCounter NumMisses;
+	FThreadSafeCounter NumStores;
+	FThreadSafeCounter64 BytesRead;
+	FThreadSafeCounter64 BytesWritten;
+	FThreadSafeCounter NumPruned;
+};
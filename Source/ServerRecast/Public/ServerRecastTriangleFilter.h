@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/ArrayView.h"
+
+struct FRecastBuildConfig;
+
+struct FServerRecastTriangleFilterStats
+{
+	int32 NumInput;
+	int32 NumOutsideBounds;
+	int32 NumDegenerate;
+	int32 NumUnwalkable;
+
+	FServerRecastTriangleFilterStats() : NumInput(0), NumOutsideBounds(0), NumDegenerate(0), NumUnwalkable(0) {}
+
+	int32 GetNumCulled() const { return NumOutsideBounds + NumDegenerate + NumUnwalkable; }
+
+	FServerRecastTriangleFilterStats& operator+=(const FServerRecastTriangleFilterStats& Other)
+	{
+		NumInput += Other.NumInput;
+		NumOutsideBounds += Other.NumOutsideBounds;
+		NumDegenerate += Other.NumDegenerate;
+		NumUnwalkable += Other.NumUnwalkable;
+		return *this;
+	}
+};
+
+/**
+* Drops exported triangles that can't change the built navmesh, before they are written or rasterized.
+* Vertex bounds tests run on SSE in blocks of 4 vertices, with a scalar tail.
+*/
+struct SERVERRECAST_API FServerRecastTriangleFilter
+{
+	/** at most this many boxes are tested separately, more are merged into their union */
+	static const int32 MaxBounds = 10;
+
+	/**
+	* @param InclusionBounds - unreal space, usually NavMeshBoundsVolumes. They are grown by the recast border
+	*                          on the ground plane and by agent height/climb vertically, empty keeps everything.
+	* @param bCullUnwalkable - also drop steep triangles no higher than walkableClimb. Recast would merge their
+	*                          spans into the walkable ground below, so the navmesh stays nearly the same.
+	*/
+	FServerRecastTriangleFilter(const FRecastBuildConfig& Config, TArrayView<const FBox> InclusionBounds, bool bCullUnwalkable);
+
+	/**
+	* Removes culled triangles from Indices in place, kept triangles stay in order and vertices are not touched.
+	* @return number of kept triangles
+	*/
+	int32 Filter(const float* Coords, int32 NumVerts, int32* Indices, int32 NumTris, FServerRecastTriangleFilterStats& InOutStats) const;
+
+	/** Filters whole buffers and shrinks Indices, runs in parallel */
+	template<typename IndexArrayType>
+	void FilterBuffer(const float* Coords, int32 NumVerts, IndexArrayType& Indices, FServerRecastTriangleFilterStats& InOutStats) const
+	{
+		const int32 NumKept = FilterParallel(Coords, NumVerts, Indices.GetData(), Indices.Num() / 3, InOutStats);
+		Indices.SetNum(NumKept * 3, false);
+	}
+
+private:
+	int32 FilterParallel(const float* Coords, int32 NumVerts, int32* Indices, int32 NumTris, FServerRecastTriangleFilterStats& InOutStats) const;
+
+	/** @param OutCodes - per vertex codes from ComputeOutcodes, nullptr skips the bounds test */
+	int32 FilterRange(const float* Coords, const uint64* OutCodes, int32* Indices, int32 NumTris, FServerRecastTriangleFilterStats& InOutStats) const;
+
+	/** per box 6 bits: below min x, y, z, above max x, y, z */
+	void ComputeOutcodes(const float* Coords, int32 NumVerts, uint64* OutCodes) const;
+
+	/** recast space */
+	TArray<FBox, TInlineAllocator<MaxBounds>> Bounds;
+
+	/** cos(walkableSlopeAngle), same threshold as rcMarkWalkableTriangles */
+	float WalkableThreshold;
+	/** world units, 0 disables unwalkable culling */
+	float MaxUnwalkableHeight;
+};
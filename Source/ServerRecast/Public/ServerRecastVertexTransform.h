@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Recast -> Unreal -> instance -> Recast conversion folded into one 3x4 matrix.
+* Row is output component, columns are coefficients of source recast X, Y, Z and translation.
+*/
+struct SERVERRECAST_API FServerRecastAffine3x4
+{
+	float M[3][4];
+
+	/** @param InstanceTransform - instance to world transform, as returned by NavDataPerInstanceTransformDelegate */
+	static FServerRecastAffine3x4 MakeInstanceToRecast(const FTransform& InstanceTransform);
+	static FServerRecastAffine3x4 MakeFromLocalToRecastWorld(const FMatrix& LocalToRecastWorld);
+
+	FORCEINLINE void TransformPoint(const float* Src, float* Dest) const
+	{
+		// evaluation order matches FMatrix::TransformPosition, results are bitwise identical to the per-vertex path
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			Dest[Axis] = (Src[0] * M[Axis][0] + Src[2] * M[Axis][2]) + (Src[1] * M[Axis][1] + M[Axis][3]);
+		}
+	}
+};
+
+namespace ServerRecastVertexTransform
+{
+	/**
+	* Transforms NumVerts recast points (float[3 * NumVerts]) with SSE or AVX, in blocks of 4 or 8 vertices
+	* deinterleaved to SoA registers. Tail and platforms without vector intrinsics use the scalar path.
+	* Src and Dest must not overlap.
+	*/
+	SERVERRECAST_API void TransformPoints(const FServerRecastAffine3x4& Transform, const float* Src, float* Dest, int32 NumVerts);
+
+	SERVERRECAST_API void TransformPointsScalar(const FServerRecastAffine3x4& Transform, const float* Src, float* Dest, int32 NumVerts);
+}
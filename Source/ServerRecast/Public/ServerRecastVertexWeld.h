@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AI/Navigation/NavigationTypes.h"
+
+namespace ServerRecastVertexWeld
+{
+	/**
+	* Turns a triangle soup into an indexed mesh with shared vertices.
+	* Vertices are keyed by position quantized to WeldEpsilon, so points closer than epsilon may stay apart
+	* when they fall into neighbouring cells. Kept vertex is the first one in soup order, output is deterministic.
+	* Triangles collapsed by welding are dropped, face winding is reversed like in TransformVertexSoupToRecast.
+	*
+	* @param VertexSoup - unreal coords, 3 vertices per triangle
+	* @param Verts - receives unique recast coords
+	* @param Faces - receives vert indices, offset by Verts.Num() on entry
+	*/
+	SERVERRECAST_API void WeldVertexSoupToRecast(const TArray<FVector>& VertexSoup, float WeldEpsilon, TNavStatArray<FVector>& Verts, TNavStatArray<int32>& Faces);
+}
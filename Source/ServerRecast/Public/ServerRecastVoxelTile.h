@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerRecastGeometryFile.h"
+
+struct rcHeightfield;
+class rcContext;
+
+/**
+* Run-length encoding of a tile's solid heightfield.
+*
+* Columns are stored in row order as runs: empty column count, filled column count, then every filled column.
+* A filled column is its span count followed by (gap below span, span height, area) per span, bottom up.
+* Counts, gaps and heights are LEB128 varints, area is one byte, a column of flat ground takes a few bytes.
+*/
+namespace ServerRecastVoxelTile
+{
+	/** Appends FServerRecastGeometryFileVoxelTile header followed by encoded spans of Solid */
+	SERVERRECAST_API void Encode(const rcHeightfield& Solid, int32 TileX, int32 TileY, TArray<uint8>& OutData);
+
+	/**
+	* Adds encoded spans to Solid, which must be created empty with the tile's size.
+	* @return false when sizes don't match or data is corrupt
+	*/
+	SERVERRECAST_API bool Decode(const FServerRecastGeometryFileVoxelTile& Tile, rcContext& Context, rcHeightfield& Solid);
+}
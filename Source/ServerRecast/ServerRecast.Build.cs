@@ -49,7 +49,10 @@ public class ServerRecast : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
-                "NavigationSystem"
+                "NavigationSystem",
+				"Json",
+				"Landscape",
+				"ServerRecastRuntime"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastPathBatch.h"
+#include "Runtime/Navmesh/Public/Detour/DetourCommon.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+
+FServerRecastPathQueryPool::FServerRecastPathQueryPool(const dtNavMesh& InNavMesh, int32 NumWorkers, int32 InMaxNodes, int32 InMaxPathPolys)
+	: NavMesh(&InNavMesh)
+	, MaxNodes(InMaxNodes)
+	, MaxPathPolys(FMath::Max(1, InMaxPathPolys))
+	, IterationsPerSlice(64)
+	, PathCache(nullptr)
+	, Requests(nullptr)
+	, Results(nullptr)
+	, NumRequests(0)
+{
+	SetPolySearchExtent(50.f, 250.f, 50.f);
+
+	const int32 NumUsedWorkers = NumWorkers > 0 ? NumWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	Workers.SetNum(NumUsedWorkers);
+	for (FWorker& Worker : Workers)
+	{
+		Worker.Query = dtAllocNavMeshQuery();
+		Worker.Query->init(NavMesh, MaxNodes);
+		Worker.Path.SetNumZeroed(MaxPathPolys);
+		// straight path has at most two corners per corridor poly, reserve keeps capacity on reuse
+		Worker.StraightPath.reserve(MaxPathPolys * 2 + 2);
+		Worker.RequestIndex = INDEX_NONE;
+	}
+}
+
+FServerRecastPathQueryPool::~FServerRecastPathQueryPool()
+{
+	for (FWorker& Worker : Workers)
+	{
+		dtFreeNavMeshQuery(Worker.Query);
+	}
+}
+
+void FServerRecastPathQueryPool::SetNavMesh(const dtNavMesh& InNavMesh)
+{
+	BeginBatch(nullptr, nullptr, 0);
+
+	// same node count, init keeps the pools and only clears them
+	NavMesh = &InNavMesh;
+	for (FWorker& Worker : Workers)
+	{
+		Worker.Query->init(NavMesh, MaxNodes);
+	}
+}
+
+void FServerRecastPathQueryPool::SetPolySearchExtent(float X, float Y, float Z)
+{
+	PolySearchExtent[0] = X;
+	PolySearchExtent[1] = Y;
+	PolySearchExtent[2] = Z;
+}
+
+void FServerRecastPathQueryPool::BeginBatch(const FServerRecastPathRequest* InRequests, FServerRecastPathResult* InResults, int32 InNumRequests)
+{
+	Requests = InRequests;
+	Results = InResults;
+	NumRequests = InNumRequests;
+	NextRequest.Reset();
+
+	for (FWorker& Worker : Workers)
+	{
+		Worker.RequestIndex = INDEX_NONE;
+	}
+	for (int32 Index = 0; Index < NumRequests; ++Index)
+	{
+		Results[Index] = FServerRecastPathResult();
+		Results[Index].Status = DT_IN_PROGRESS;
+	}
+}
+
+bool FServerRecastPathQueryPool::IsBatchDone() const
+{
+	if (NextRequest.GetValue() < NumRequests)
+	{
+		return false;
+	}
+	for (const FWorker& Worker : Workers)
+	{
+		if (Worker.RequestIndex != INDEX_NONE)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FServerRecastPathQueryPool::Tick(double TimeBudget)
+{
+	if (IsBatchDone())
+	{
+		return true;
+	}
+
+	const double Deadline = TimeBudget > 0. ? FPlatformTime::Seconds() + TimeBudget : 0.;
+	ParallelFor(Workers.Num(), [this, Deadline](int32 WorkerIndex)
+		{
+			RunWorker(Workers[WorkerIndex], Deadline);
+		}, Workers.Num() == 1);
+
+	return IsBatchDone();
+}
+
+void FServerRecastPathQueryPool::Execute(const FServerRecastPathRequest* InRequests, FServerRecastPathResult* InResults, int32 InNumRequests)
+{
+	BeginBatch(InRequests, InResults, InNumRequests);
+	Tick();
+}
+
+bool FServerRecastPathQueryPool::RunWorker(FWorker& Worker, double Deadline)
+{
+	for (;;)
+	{
+		if (Deadline > 0. && FPlatformTime::Seconds() >= Deadline)
+		{
+			return false;
+		}
+
+		// search cut by the last tick goes on first
+		if (Worker.RequestIndex == INDEX_NONE)
+		{
+			const int32 RequestIndex = NextRequest.Increment() - 1;
+			if (RequestIndex >= NumRequests)
+			{
+				return true;
+			}
+
+			StartRequest(Worker, RequestIndex);
+			if (Worker.RequestIndex == INDEX_NONE)
+			{
+				continue;
+			}
+		}
+
+		int32 DoneIterations = 0;
+		const dtStatus Status = Worker.Query->updateSlicedFindPath(IterationsPerSlice, &DoneIterations);
+		if (!dtStatusInProgress(Status))
+		{
+			FinishRequest(Worker);
+		}
+	}
+}
+
+void FServerRecastPathQueryPool::StartRequest(FWorker& Worker, int32 RequestIndex) const
+{
+	const FServerRecastPathRequest& Request = Requests[RequestIndex];
+	FServerRecastPathResult& Result = Results[RequestIndex];
+	const dtQueryFilter* Filter = Request.Filter ? Request.Filter : &DefaultFilter;
+
+	dtPolyRef StartRef = 0;
+	dtPolyRef EndRef = 0;
+	Worker.Query->findNearestPoly(Request.StartPos, PolySearchExtent, Filter, &StartRef, Worker.StartPos);
+	Worker.Query->findNearestPoly(Request.EndPos, PolySearchExtent, Filter, &EndRef, Worker.EndPos);
+	if (StartRef == 0 || EndRef == 0)
+	{
+		Result.Status = DT_FAILURE;
+		return;
+	}
+
+	Worker.CacheKey = FServerRecastPathCacheKey(StartRef, EndRef, Request.FilterHash ? Request.FilterHash : FServerRecastPathCache::HashFilter(*Filter));
+	int32 NumPolys = 0;
+	if (PathCache && PathCache->Find(Worker.CacheKey, Worker.Path.GetData(), MaxPathPolys, NumPolys))
+	{
+		Result.Status = DT_SUCCESS;
+		Result.NumPolys = NumPolys;
+		Result.bFromCache = true;
+		WriteStraightPath(Worker, Request, Result, NumPolys);
+		return;
+	}
+
+	if (dtStatusFailed(Worker.Query->initSlicedFindPath(StartRef, EndRef, Worker.StartPos, Worker.EndPos, Filter)))
+	{
+		Result.Status = DT_FAILURE;
+		return;
+	}
+
+	Worker.RequestIndex = RequestIndex;
+}
+
+void FServerRecastPathQueryPool::FinishRequest(FWorker& Worker) const
+{
+	const FServerRecastPathRequest& Request = Requests[Worker.RequestIndex];
+	FServerRecastPathResult& Result = Results[Worker.RequestIndex];
+	Worker.RequestIndex = INDEX_NONE;
+
+	int32 NumPolys = 0;
+	Result.Status = Worker.Query->finalizeSlicedFindPath(Worker.Path.GetData(), &NumPolys, MaxPathPolys);
+	Result.NumPolys = NumPolys;
+	if (dtStatusFailed(Result.Status) || NumPolys == 0)
+	{
+		Result.Status = DT_FAILURE;
+		return;
+	}
+
+	// only complete corridors, a partial one may get through once more tiles are loaded
+	if (PathCache && !dtStatusDetail(Result.Status, DT_PARTIAL_RESULT | DT_BUFFER_TOO_SMALL | DT_OUT_OF_NODES))
+	{
+		PathCache->Add(Worker.CacheKey, Worker.Path.GetData(), NumPolys);
+	}
+
+	WriteStraightPath(Worker, Request, Result, NumPolys);
+}
+
+void FServerRecastPathQueryPool::WriteStraightPath(FWorker& Worker, const FServerRecastPathRequest& Request, FServerRecastPathResult& Result, int32 NumPolys) const
+{
+	if (Request.PathPoints == nullptr || Request.MaxPoints <= 0)
+	{
+		return;
+	}
+
+	// partial corridor ends at the poly closest to the goal, straight path ends on it too
+	float PathEnd[3];
+	dtVcopy(PathEnd, Worker.EndPos);
+	if (dtStatusDetail(Result.Status, DT_PARTIAL_RESULT))
+	{
+		Worker.Query->closestPointOnPoly(Worker.Path[NumPolys - 1], Worker.EndPos, PathEnd);
+	}
+
+	Worker.StraightPath.reserve(MaxPathPolys * 2 + 2);
+	if (dtStatusFailed(Worker.Query->findStraightPath(Worker.StartPos, PathEnd, Worker.Path.GetData(), NumPolys, Worker.StraightPath)))
+	{
+		Result.Status = DT_FAILURE;
+		return;
+	}
+
+	Result.NumPoints = FMath::Min(Worker.StraightPath.size(), Request.MaxPoints);
+	for (int32 PointIndex = 0; PointIndex < Result.NumPoints; ++PointIndex)
+	{
+		Worker.StraightPath.getPos(PointIndex, &Request.PathPoints[PointIndex * 3]);
+	}
+	if (Result.NumPoints < Worker.StraightPath.size())
+	{
+		Result.Status |= DT_BUFFER_TOO_SMALL;
+	}
+}
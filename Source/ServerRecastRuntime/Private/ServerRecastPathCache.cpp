@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastPathCache.h"
+#include "ServerRecastRuntime.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMeshQuery.h"
+#include "Misc/Crc.h"
+#include "Misc/ScopeLock.h"
+
+FServerRecastPathCache::FServerRecastPathCache(const dtNavMesh& InNavMesh, int64 InMemoryBudget, int32 NumShards)
+	: NavMesh(&InNavMesh)
+	, NavMeshVersion(0)
+	, MemoryBudget(InMemoryBudget)
+{
+	NumShards = FMath::Max(1, NumShards);
+	ShardBudget = MemoryBudget / NumShards;
+	for (int32 Index = 0; Index < NumShards; ++Index)
+	{
+		Shards.Add(MakeUnique<FShard>());
+	}
+}
+
+FServerRecastPathCache::~FServerRecastPathCache()
+{
+	Clear();
+}
+
+void FServerRecastPathCache::SetNavMesh(const dtNavMesh& InNavMesh, uint32 InNavMeshVersion)
+{
+	// corridor refs mean nothing on another navmesh, and a reopened one has none of its tiles loaded
+	if (NavMesh != &InNavMesh || NavMeshVersion != InNavMeshVersion)
+	{
+		Clear();
+		NavMesh = &InNavMesh;
+		NavMeshVersion = InNavMeshVersion;
+	}
+}
+
+uint32 FServerRecastPathCache::HashFilter(const dtQueryFilter& Filter)
+{
+	float Costs[DT_MAX_AREAS * 2 + 1];
+	for (int32 Area = 0; Area < DT_MAX_AREAS; ++Area)
+	{
+		Costs[Area * 2] = Filter.getAreaCost(Area);
+		Costs[Area * 2 + 1] = Filter.getAreaFixedCost(Area);
+	}
+	Costs[DT_MAX_AREAS * 2] = Filter.getHeuristicScale();
+
+	const uint16 Flags[] = { Filter.getIncludeFlags(), Filter.getExcludeFlags() };
+	return FCrc::MemCrc32(Flags, sizeof(Flags), FCrc::MemCrc32(Costs, sizeof(Costs)));
+}
+
+bool FServerRecastPathCache::Find(const FServerRecastPathCacheKey& Key, dtPolyRef* OutPath, int32 MaxPath, int32& OutNumPolys)
+{
+	FShard& Shard = GetShard(Key);
+	{
+		FScopeLock ScopeLock(&Shard.Lock);
+		FEntryList::TDoubleLinkedListNode** NodePtr = Shard.EntriesByKey.Find(Key);
+		if (NodePtr && (*NodePtr)->GetValue().Path.Num() <= MaxPath)
+		{
+			FEntryList::TDoubleLinkedListNode* Node = *NodePtr;
+			const TArray<dtPolyRef>& Path = Node->GetValue().Path;
+			FMemory::Memcpy(OutPath, Path.GetData(), Path.Num() * sizeof(dtPolyRef));
+			OutNumPolys = Path.Num();
+
+			Shard.Entries.RemoveNode(Node, false);
+			Shard.Entries.AddHead(Node);
+
+			NumHits.Increment();
+			return true;
+		}
+	}
+
+	NumMisses.Increment();
+	return false;
+}
+
+void FServerRecastPathCache::Add(const FServerRecastPathCacheKey& Key, const dtPolyRef* Path, int32 NumPolys)
+{
+	if (NumPolys <= 0)
+	{
+		return;
+	}
+
+	FEntryList::TDoubleLinkedListNode* Node = new FEntryList::TDoubleLinkedListNode(FEntry());
+	FEntry& Entry = Node->GetValue();
+	Entry.Key = Key;
+	Entry.Path.Append(Path, NumPolys);
+	for (int32 Index = 0; Index < NumPolys; ++Index)
+	{
+		Entry.Tiles.AddUnique(NavMesh->decodePolyIdTile(Path[Index]));
+	}
+	Entry.Size = sizeof(FEntryList::TDoubleLinkedListNode) + Entry.Path.GetAllocatedSize() + Entry.Tiles.GetAllocatedSize() +
+		Entry.Tiles.Num() * (sizeof(uint32) + sizeof(FServerRecastPathCacheKey));
+
+	FShard& Shard = GetShard(Key);
+	FScopeLock ScopeLock(&Shard.Lock);
+
+	if (FEntryList::TDoubleLinkedListNode** NodePtr = Shard.EntriesByKey.Find(Key))
+	{
+		RemoveEntry(Shard, *NodePtr);
+	}
+
+	for (uint32 Tile : Entry.Tiles)
+	{
+		Shard.KeysByTile.Add(Tile, Key);
+	}
+	Shard.MemoryBytes += Entry.Size;
+	Shard.Entries.AddHead(Node);
+	Shard.EntriesByKey.Add(Key, Node);
+
+	while (Shard.MemoryBytes > ShardBudget && Shard.Entries.Num() > 1)
+	{
+		RemoveEntry(Shard, Shard.Entries.GetTail());
+		NumEvictions.Increment();
+	}
+}
+
+void FServerRecastPathCache::RemoveEntry(FShard& Shard, FEntryList::TDoubleLinkedListNode* Node)
+{
+	const FEntry& Entry = Node->GetValue();
+	for (uint32 Tile : Entry.Tiles)
+	{
+		Shard.KeysByTile.RemoveSingle(Tile, Entry.Key);
+	}
+	Shard.EntriesByKey.Remove(Entry.Key);
+	Shard.MemoryBytes -= Entry.Size;
+	Shard.Entries.RemoveNode(Node);
+}
+
+void FServerRecastPathCache::InvalidateTile(dtTileRef TileRef)
+{
+	const uint32 Tile = NavMesh->decodePolyIdTile((dtPolyRef)TileRef);
+
+	TArray<FServerRecastPathCacheKey, TInlineAllocator<64>> Keys;
+	for (TUniquePtr<FShard>& Shard : Shards)
+	{
+		FScopeLock ScopeLock(&Shard->Lock);
+		Keys.Reset();
+		Shard->KeysByTile.MultiFind(Tile, Keys);
+		for (const FServerRecastPathCacheKey& Key : Keys)
+		{
+			if (FEntryList::TDoubleLinkedListNode** NodePtr = Shard->EntriesByKey.Find(Key))
+			{
+				RemoveEntry(*Shard, *NodePtr);
+				NumInvalidations.Increment();
+			}
+		}
+	}
+}
+
+void FServerRecastPathCache::Clear()
+{
+	for (TUniquePtr<FShard>& Shard : Shards)
+	{
+		FScopeLock ScopeLock(&Shard->Lock);
+		Shard->Entries.Empty();
+		Shard->EntriesByKey.Empty();
+		Shard->KeysByTile.Empty();
+		Shard->MemoryBytes = 0;
+	}
+}
+
+FServerRecastPathCacheStats FServerRecastPathCache::GetStats() const
+{
+	FServerRecastPathCacheStats Stats;
+	Stats.NumHits = NumHits.GetValue();
+	Stats.NumMisses = NumMisses.GetValue();
+	Stats.NumEvictions = NumEvictions.GetValue();
+	Stats.NumInvalidations = NumInvalidations.GetValue();
+	Stats.NumEntries = 0;
+	Stats.MemoryBytes = 0;
+	Stats.MemoryBudget = MemoryBudget;
+	for (const TUniquePtr<FShard>& Shard : Shards)
+	{
+		FScopeLock ScopeLock(&Shard->Lock);
+		Stats.NumEntries += Shard->Entries.Num();
+		Stats.MemoryBytes += Shard->MemoryBytes;
+	}
+	return Stats;
+}
+
+void FServerRecastPathCache::LogStats() const
+{
+	const FServerRecastPathCacheStats Stats = GetStats();
+	UE_LOG(LogServerRecastRuntime, Log, TEXT("Path cache: %lld hits, %lld misses (%.1f%% hit rate), %d entries, %lld of %lld KB, %lld evicted, %lld invalidated"),
+		Stats.NumHits, Stats.NumMisses, 100.f * Stats.GetHitRate(), Stats.NumEntries, Stats.MemoryBytes / 1024, Stats.MemoryBudget / 1024,
+		Stats.NumEvictions, Stats.NumInvalidations);
+}
@@ -0,0 +1,7 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastRuntime.h"
+#include "Modules/ModuleManager.h"
+
+DEFINE_LOG_CATEGORY(LogServerRecastRuntime);
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, ServerRecastRuntime)
@@ -0,0 +1,269 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastRuntimeNavMesh.h"
+#include "ServerRecastRuntime.h"
+#include "ServerRecastPathCache.h"
+#include "Runtime/Navmesh/Public/Detour/DetourAlloc.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+
+FServerRecastRuntimeNavMesh::FServerRecastRuntimeNavMesh()
+	: MappedHandle(nullptr)
+	, MappedRegion(nullptr)
+	, Data(nullptr)
+	, Header(nullptr)
+	, Entries(nullptr)
+	, NavMesh(nullptr)
+	, NumLoadedTiles(0)
+	, LoadedBytes(0)
+	, PathCache(nullptr)
+{
+}
+
+FServerRecastRuntimeNavMesh::~FServerRecastRuntimeNavMesh()
+{
+	Close();
+}
+
+bool FServerRecastRuntimeNavMesh::Open(const FString& FileName)
+{
+	Close();
+
+	int64 DataSize = 0;
+	MappedHandle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FileName);
+	if (MappedHandle)
+	{
+		MappedRegion = MappedHandle->MapRegion();
+	}
+
+	if (MappedRegion)
+	{
+		Data = MappedRegion->GetMappedPtr();
+		DataSize = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedData, *FileName, FILEREAD_Silent))
+	{
+		Data = LoadedData.GetData();
+		DataSize = LoadedData.Num();
+	}
+
+	if (!ServerRecastTilePack::Validate(Data, DataSize))
+	{
+		UE_LOG(LogServerRecastRuntime, Error, TEXT("%s is not a valid ServerRecast tile pack"), *FileName);
+		Close();
+		return false;
+	}
+
+	Header = reinterpret_cast<const FServerRecastTilePackHeader*>(Data);
+	Entries = reinterpret_cast<const FServerRecastTilePackEntry*>(Data + sizeof(FServerRecastTilePackHeader));
+
+	NavMesh = dtAllocNavMesh();
+	if (NavMesh == nullptr || dtStatusFailed(NavMesh->init(&Header->Params)))
+	{
+		UE_LOG(LogServerRecastRuntime, Error, TEXT("Failed to init navmesh of %s"), *FileName);
+		Close();
+		return false;
+	}
+
+	LoadedRefs.SetNumZeroed(Header->NumTiles);
+	if (PathCache)
+	{
+		PathCache->SetNavMesh(*NavMesh, Header->PackHash);
+	}
+
+	UE_LOG(LogServerRecastRuntime, Log, TEXT("%s opened, %d tiles, %s"), *FileName, Header->NumTiles, MappedRegion ? TEXT("mapped") : TEXT("loaded to memory"));
+	return true;
+}
+
+void FServerRecastRuntimeNavMesh::SetPathCache(FServerRecastPathCache* InPathCache)
+{
+	PathCache = InPathCache;
+	if (PathCache && NavMesh)
+	{
+		PathCache->SetNavMesh(*NavMesh, GetPackHash());
+	}
+}
+
+void FServerRecastRuntimeNavMesh::Close()
+{
+	// corridors of the old navmesh must not outlive it
+	if (PathCache && NavMesh)
+	{
+		PathCache->Clear();
+	}
+
+	// tile copies are owned by the navmesh (DT_TILE_FREE_DATA)
+	dtFreeNavMesh(NavMesh);
+	NavMesh = nullptr;
+	LoadedRefs.Empty();
+	NumLoadedTiles = 0;
+	LoadedBytes = 0;
+
+	delete MappedRegion;
+	MappedRegion = nullptr;
+	delete MappedHandle;
+	MappedHandle = nullptr;
+	LoadedData.Empty();
+
+	Data = nullptr;
+	Header = nullptr;
+	Entries = nullptr;
+}
+
+int32 FServerRecastRuntimeNavMesh::FindEntry(int32 TileX, int32 TileY) const
+{
+	// entries are sorted by (TileY, TileX, Layer), lower bound of (TileY, TileX)
+	int32 First = 0;
+	int32 Count = GetNumTiles();
+	while (Count > 0)
+	{
+		const int32 Step = Count / 2;
+		const FServerRecastTilePackEntry& Entry = Entries[First + Step];
+		if (Entry.TileY < TileY || (Entry.TileY == TileY && Entry.TileX < TileX))
+		{
+			First += Step + 1;
+			Count -= Step + 1;
+		}
+		else
+		{
+			Count = Step;
+		}
+	}
+
+	return First < GetNumTiles() && Entries[First].TileX == TileX && Entries[First].TileY == TileY ? First : INDEX_NONE;
+}
+
+bool FServerRecastRuntimeNavMesh::LoadEntry(int32 EntryIndex)
+{
+	if (LoadedRefs[EntryIndex])
+	{
+		return true;
+	}
+
+	// first touch of these pages faults them in from the shared page cache
+	const FServerRecastTilePackEntry& Entry = Entries[EntryIndex];
+	const dtMeshHeader* TileHeader = reinterpret_cast<const dtMeshHeader*>(Data + Entry.DataOffset);
+	if (Entry.DataSize < (int32)sizeof(dtMeshHeader) || TileHeader->magic != DT_NAVMESH_MAGIC || TileHeader->version != DT_NAVMESH_VERSION ||
+		TileHeader->x != Entry.TileX || TileHeader->y != Entry.TileY || TileHeader->layer != Entry.Layer)
+	{
+		UE_LOG(LogServerRecastRuntime, Warning, TEXT("Tile (%d, %d) layer %d doesn't match its pack entry"), Entry.TileX, Entry.TileY, Entry.Layer);
+		return false;
+	}
+
+	uint8* TileData = (uint8*)dtAlloc(Entry.DataSize, DT_ALLOC_PERM);
+	if (TileData == nullptr)
+	{
+		UE_LOG(LogServerRecastRuntime, Warning, TEXT("Out of memory loading tile (%d, %d) layer %d"), Entry.TileX, Entry.TileY, Entry.Layer);
+		return false;
+	}
+	FMemory::Memcpy(TileData, Data + Entry.DataOffset, Entry.DataSize);
+
+	dtTileRef TileRef = 0;
+	if (dtStatusFailed(NavMesh->addTile(TileData, Entry.DataSize, DT_TILE_FREE_DATA, Entry.TileRef, &TileRef)))
+	{
+		UE_LOG(LogServerRecastRuntime, Warning, TEXT("Failed to add tile (%d, %d) layer %d"), Entry.TileX, Entry.TileY, Entry.Layer);
+		dtFree(TileData);
+		return false;
+	}
+
+	LoadedRefs[EntryIndex] = TileRef;
+	++NumLoadedTiles;
+	LoadedBytes += Entry.DataSize;
+	return true;
+}
+
+bool FServerRecastRuntimeNavMesh::LoadTile(int32 TileX, int32 TileY)
+{
+	const int32 FirstEntry = IsOpen() ? FindEntry(TileX, TileY) : INDEX_NONE;
+	if (FirstEntry == INDEX_NONE)
+	{
+		return false;
+	}
+
+	bool bLoaded = true;
+	for (int32 EntryIndex = FirstEntry; EntryIndex < GetNumTiles() && Entries[EntryIndex].TileX == TileX && Entries[EntryIndex].TileY == TileY; ++EntryIndex)
+	{
+		bLoaded = LoadEntry(EntryIndex) && bLoaded;
+	}
+	return bLoaded;
+}
+
+int32 FServerRecastRuntimeNavMesh::LoadTilesInBounds(const float* BMin, const float* BMax)
+{
+	if (!IsOpen())
+	{
+		return 0;
+	}
+
+	int32 MinX, MinY, MaxX, MaxY;
+	NavMesh->calcTileLoc(BMin, &MinX, &MinY);
+	NavMesh->calcTileLoc(BMax, &MaxX, &MaxY);
+
+	const int32 NumLoadedBefore = NumLoadedTiles;
+	for (int32 TileY = FMath::Min(MinY, MaxY); TileY <= FMath::Max(MinY, MaxY); ++TileY)
+	{
+		for (int32 TileX = FMath::Min(MinX, MaxX); TileX <= FMath::Max(MinX, MaxX); ++TileX)
+		{
+			LoadTile(TileX, TileY);
+		}
+	}
+	return NumLoadedTiles - NumLoadedBefore;
+}
+
+int32 FServerRecastRuntimeNavMesh::LoadTilesForPath(const float* StartPos, const float* EndPos, float Extent)
+{
+	float BMin[3], BMax[3];
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		BMin[Axis] = FMath::Min(StartPos[Axis], EndPos[Axis]) - Extent;
+		BMax[Axis] = FMath::Max(StartPos[Axis], EndPos[Axis]) + Extent;
+	}
+	return LoadTilesInBounds(BMin, BMax);
+}
+
+int32 FServerRecastRuntimeNavMesh::LoadAllTiles()
+{
+	const int32 NumLoadedBefore = NumLoadedTiles;
+	for (int32 EntryIndex = 0; EntryIndex < LoadedRefs.Num(); ++EntryIndex)
+	{
+		LoadEntry(EntryIndex);
+	}
+	return NumLoadedTiles - NumLoadedBefore;
+}
+
+void FServerRecastRuntimeNavMesh::UnloadTile(int32 TileX, int32 TileY)
+{
+	const int32 FirstEntry = IsOpen() ? FindEntry(TileX, TileY) : INDEX_NONE;
+	for (int32 EntryIndex = FirstEntry; EntryIndex != INDEX_NONE && EntryIndex < GetNumTiles() && Entries[EntryIndex].TileX == TileX && Entries[EntryIndex].TileY == TileY; ++EntryIndex)
+	{
+		if (LoadedRefs[EntryIndex])
+		{
+			if (PathCache)
+			{
+				PathCache->InvalidateTile(LoadedRefs[EntryIndex]);
+			}
+			NavMesh->removeTile(LoadedRefs[EntryIndex], nullptr, nullptr);
+			LoadedRefs[EntryIndex] = 0;
+			--NumLoadedTiles;
+			LoadedBytes -= Entries[EntryIndex].DataSize;
+		}
+	}
+}
+
+bool FServerRecastRuntimeNavMesh::IsTileLoaded(int32 TileX, int32 TileY) const
+{
+	const int32 FirstEntry = IsOpen() ? FindEntry(TileX, TileY) : INDEX_NONE;
+	if (FirstEntry == INDEX_NONE)
+	{
+		return false;
+	}
+
+	for (int32 EntryIndex = FirstEntry; EntryIndex < GetNumTiles() && Entries[EntryIndex].TileX == TileX && Entries[EntryIndex].TileY == TileY; ++EntryIndex)
+	{
+		if (LoadedRefs[EntryIndex] == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
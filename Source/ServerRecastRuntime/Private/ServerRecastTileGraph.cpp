@@ -0,0 +1,750 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastTileGraph.h"
+#include "ServerRecastRuntime.h"
+#include "ServerRecastTilePack.h"
+#include "Runtime/Navmesh/Public/Detour/DetourCommon.h"
+#include "HAL/FileManager.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/FileHelper.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Algo/Reverse.h"
+
+namespace ServerRecastTileGraph
+{
+	struct FFileHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		int32 MinTileX;
+		int32 MinTileY;
+		int32 TilesWidth;
+		int32 TilesHeight;
+		int32 NumPortals;
+		int32 NumTilePortals;
+		int32 NumEdges;
+		uint32 PackHash;
+		dtNavMeshParams NavMeshParams;
+	};
+
+	/** Offsets must start at 0, never decrease and end at NumItems */
+	static bool IsValidRanges(const TArray<int32>& FirstItem, int32 NumItems)
+	{
+		if (FirstItem[0] != 0 || FirstItem.Last() != NumItems)
+		{
+			return false;
+		}
+		for (int32 Index = 1; Index < FirstItem.Num(); ++Index)
+		{
+			if (FirstItem[Index] < FirstItem[Index - 1])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** poly edge on the +x or +z border of a tile */
+	struct FBorderEdge
+	{
+		/** extent along the border */
+		float AlongMin;
+		float AlongMax;
+		float Mid[3];
+		dtPolyRef PolyRef;
+	};
+
+	struct FBorderRun
+	{
+		float AlongMin;
+		float AlongMax;
+		float Height;
+	};
+
+	struct FPendingEdge
+	{
+		int32 FromPortal;
+		int32 ToPortal;
+		float Cost;
+	};
+
+	template <typename T>
+	static void WriteArray(FArchive& Ar, const TArray<T>& Array)
+	{
+		Ar.Serialize(const_cast<T*>(Array.GetData()), Array.Num() * sizeof(T));
+	}
+
+	template <typename T>
+	static bool ReadArray(const uint8*& Cursor, const uint8* End, int32 Num, TArray<T>& OutArray)
+	{
+		if (Num < 0 || End - Cursor < (int64)Num * (int64)sizeof(T))
+		{
+			return false;
+		}
+		OutArray.SetNumUninitialized(Num);
+		FMemory::Memcpy(OutArray.GetData(), Cursor, Num * sizeof(T));
+		Cursor += Num * sizeof(T);
+		return true;
+	}
+}
+
+FServerRecastTileGraph::FServerRecastTileGraph()
+	: PackHash(0)
+	, MinTileX(0)
+	, MinTileY(0)
+	, TilesWidth(0)
+	, TilesHeight(0)
+{
+	FMemory::Memzero(NavMeshParams);
+}
+
+bool FServerRecastTileGraph::IsBuiltFor(const dtNavMesh& NavMesh) const
+{
+	return FMemory::Memcmp(NavMesh.getParams(), &NavMeshParams, sizeof(NavMeshParams)) == 0;
+}
+
+int32 FServerRecastTileGraph::GetTileIndex(int32 TileX, int32 TileY) const
+{
+	const int64 X = (int64)TileX - MinTileX;
+	const int64 Y = (int64)TileY - MinTileY;
+	return X >= 0 && Y >= 0 && X < TilesWidth && Y < TilesHeight ? (int32)(Y * TilesWidth + X) : INDEX_NONE;
+}
+
+const int32* FServerRecastTileGraph::GetTilePortals(int32 TileIndex, int32& OutNum) const
+{
+	OutNum = TileFirstPortal[TileIndex + 1] - TileFirstPortal[TileIndex];
+	return TilePortals.GetData() + TileFirstPortal[TileIndex];
+}
+
+const FServerRecastTileGraphEdge* FServerRecastTileGraph::GetEdges(int32 PortalIndex, int32& OutNum) const
+{
+	OutNum = PortalFirstEdge[PortalIndex + 1] - PortalFirstEdge[PortalIndex];
+	return Edges.GetData() + PortalFirstEdge[PortalIndex];
+}
+
+bool FServerRecastTileGraph::Build(const dtNavMesh& NavMesh, const FServerRecastTileGraphSettings& Settings)
+{
+	*this = FServerRecastTileGraph();
+
+	const double StartTime = FPlatformTime::Seconds();
+	int32 MaxTileX = MIN_int32;
+	int32 MaxTileY = MIN_int32;
+	MinTileX = MAX_int32;
+	MinTileY = MAX_int32;
+	for (int32 Index = 0; Index < NavMesh.getMaxTiles(); ++Index)
+	{
+		const dtMeshTile* Tile = NavMesh.getTile(Index);
+		if (Tile && Tile->header)
+		{
+			MinTileX = FMath::Min(MinTileX, Tile->header->x);
+			MinTileY = FMath::Min(MinTileY, Tile->header->y);
+			MaxTileX = FMath::Max(MaxTileX, Tile->header->x);
+			MaxTileY = FMath::Max(MaxTileY, Tile->header->y);
+		}
+	}
+	if (MaxTileX < MinTileX)
+	{
+		*this = FServerRecastTileGraph();
+		return false;
+	}
+	TilesWidth = MaxTileX - MinTileX + 1;
+	TilesHeight = MaxTileY - MinTileY + 1;
+	PackHash = ServerRecastTilePack::GetPackHash(NavMesh);
+	NavMeshParams = *NavMesh.getParams();
+
+	BuildPortals(NavMesh, Settings);
+	BuildEdges(NavMesh, Settings);
+
+	UE_LOG(LogServerRecastRuntime, Log, TEXT("Tile graph: %d portals, %d edges over %dx%d tiles in %.3f sec"),
+		Portals.Num(), Edges.Num(), TilesWidth, TilesHeight, FPlatformTime::Seconds() - StartTime);
+	return true;
+}
+
+void FServerRecastTileGraph::BuildPortals(const dtNavMesh& NavMesh, const FServerRecastTileGraphSettings& Settings)
+{
+	using namespace ServerRecastTileGraph;
+
+	const int32 NumTiles = TilesWidth * TilesHeight;
+	TBitArray<> OccupiedTiles(false, NumTiles);
+	for (int32 Index = 0; Index < NavMesh.getMaxTiles(); ++Index)
+	{
+		const dtMeshTile* Tile = NavMesh.getTile(Index);
+		if (Tile && Tile->header)
+		{
+			OccupiedTiles[GetTileIndex(Tile->header->x, Tile->header->y)] = true;
+		}
+	}
+
+	// border edges by tile and side, +x border is shared with tile x + 1 and +z border with tile y + 1
+	TArray<TArray<FBorderEdge>> Borders;
+	Borders.SetNum(NumTiles * 2);
+	for (int32 Index = 0; Index < NavMesh.getMaxTiles(); ++Index)
+	{
+		const dtMeshTile* Tile = NavMesh.getTile(Index);
+		if (Tile == nullptr || Tile->header == nullptr)
+		{
+			continue;
+		}
+
+		const dtPolyRef PolyRefBase = NavMesh.getPolyRefBase(Tile);
+		const int32 TileIndex = GetTileIndex(Tile->header->x, Tile->header->y);
+		for (int32 PolyIndex = 0; PolyIndex < Tile->header->polyCount; ++PolyIndex)
+		{
+			const dtPoly& Poly = Tile->polys[PolyIndex];
+			if (Poly.getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			{
+				continue;
+			}
+
+			for (int32 Edge = 0; Edge < Poly.vertCount; ++Edge)
+			{
+				// negative sides are positive sides of the neighbour, each border is collected once
+				const int32 Side = (Poly.neis[Edge] & DT_EXT_LINK) ? (Poly.neis[Edge] & 0xff) : -1;
+				if (Side != 0 && Side != 2)
+				{
+					continue;
+				}
+
+				const int32 NeighbourIndex = GetTileIndex(Tile->header->x + (Side == 0 ? 1 : 0), Tile->header->y + (Side == 2 ? 1 : 0));
+				if (NeighbourIndex == INDEX_NONE || !OccupiedTiles[NeighbourIndex])
+				{
+					continue;
+				}
+
+				const float* VertA = &Tile->verts[Poly.verts[Edge] * 3];
+				const float* VertB = &Tile->verts[Poly.verts[(Edge + 1) % Poly.vertCount] * 3];
+				const int32 AlongAxis = Side == 0 ? 2 : 0;
+
+				FBorderEdge BorderEdge;
+				BorderEdge.AlongMin = FMath::Min(VertA[AlongAxis], VertB[AlongAxis]);
+				BorderEdge.AlongMax = FMath::Max(VertA[AlongAxis], VertB[AlongAxis]);
+				dtVlerp(BorderEdge.Mid, VertA, VertB, 0.5f);
+				BorderEdge.PolyRef = PolyRefBase | (dtPolyRef)PolyIndex;
+				Borders[TileIndex * 2 + (Side == 2 ? 1 : 0)].Add(BorderEdge);
+			}
+		}
+	}
+
+	// runs of edges along each border become portals
+	TArray<TArray<int32>> PortalsByTile;
+	PortalsByTile.SetNum(NumTiles);
+	TArray<FBorderRun> Runs;
+	for (int32 BorderIndex = 0; BorderIndex < Borders.Num(); ++BorderIndex)
+	{
+		TArray<FBorderEdge>& BorderEdges = Borders[BorderIndex];
+		if (BorderEdges.Num() == 0)
+		{
+			continue;
+		}
+
+		BorderEdges.Sort([](const FBorderEdge& A, const FBorderEdge& B) { return A.AlongMin < B.AlongMin; });
+
+		// open runs of several floors can overlap along the border
+		Runs.Reset();
+		TArray<int32> EdgeRuns;
+		EdgeRuns.SetNumUninitialized(BorderEdges.Num());
+		for (int32 EdgeIndex = 0; EdgeIndex < BorderEdges.Num(); ++EdgeIndex)
+		{
+			const FBorderEdge& BorderEdge = BorderEdges[EdgeIndex];
+			int32 RunIndex = INDEX_NONE;
+			for (int32 Candidate = 0; Candidate < Runs.Num() && RunIndex == INDEX_NONE; ++Candidate)
+			{
+				const FBorderRun& Run = Runs[Candidate];
+				if (BorderEdge.AlongMin - Run.AlongMax <= Settings.PortalMergeDistance &&
+					FMath::Abs(BorderEdge.Mid[1] - Run.Height) <= Settings.PortalMaxHeightDifference &&
+					BorderEdge.AlongMax - Run.AlongMin <= Settings.MaxPortalWidth)
+				{
+					RunIndex = Candidate;
+				}
+			}
+
+			if (RunIndex == INDEX_NONE)
+			{
+				FBorderRun& Run = Runs[Runs.AddUninitialized()];
+				Run.AlongMin = BorderEdge.AlongMin;
+				Run.AlongMax = BorderEdge.AlongMax;
+				Run.Height = BorderEdge.Mid[1];
+				RunIndex = Runs.Num() - 1;
+			}
+
+			FBorderRun& Run = Runs[RunIndex];
+			Run.AlongMax = FMath::Max(Run.AlongMax, BorderEdge.AlongMax);
+			EdgeRuns[EdgeIndex] = RunIndex;
+		}
+
+		const int32 TileIndex = BorderIndex / 2;
+		const int32 NeighbourIndex = TileIndex + (BorderIndex % 2 == 0 ? 1 : TilesWidth);
+		const int32 AlongAxis = BorderIndex % 2 == 0 ? 2 : 0;
+		for (int32 RunIndex = 0; RunIndex < Runs.Num(); ++RunIndex)
+		{
+			// edge closest to the middle of the run represents the portal
+			const FBorderRun& Run = Runs[RunIndex];
+			const float Center = (Run.AlongMin + Run.AlongMax) * 0.5f;
+			int32 BestEdge = INDEX_NONE;
+			for (int32 EdgeIndex = 0; EdgeIndex < BorderEdges.Num(); ++EdgeIndex)
+			{
+				if (EdgeRuns[EdgeIndex] == RunIndex &&
+					(BestEdge == INDEX_NONE || FMath::Abs(BorderEdges[EdgeIndex].Mid[AlongAxis] - Center) < FMath::Abs(BorderEdges[BestEdge].Mid[AlongAxis] - Center)))
+				{
+					BestEdge = EdgeIndex;
+				}
+			}
+
+			FServerRecastTileGraphPortal& Portal = Portals[Portals.AddUninitialized()];
+			Portal.PolyRef = BorderEdges[BestEdge].PolyRef;
+			dtVcopy(Portal.Pos, BorderEdges[BestEdge].Mid);
+			Portal.TileIndices[0] = TileIndex;
+			Portal.TileIndices[1] = NeighbourIndex;
+			PortalsByTile[TileIndex].Add(Portals.Num() - 1);
+			PortalsByTile[NeighbourIndex].Add(Portals.Num() - 1);
+		}
+	}
+
+	TileFirstPortal.SetNumUninitialized(NumTiles + 1);
+	TilePortals.Reset();
+	for (int32 TileIndex = 0; TileIndex < NumTiles; ++TileIndex)
+	{
+		TileFirstPortal[TileIndex] = TilePortals.Num();
+		TilePortals.Append(PortalsByTile[TileIndex]);
+	}
+	TileFirstPortal[NumTiles] = TilePortals.Num();
+}
+
+void FServerRecastTileGraph::BuildEdges(const dtNavMesh& NavMesh, const FServerRecastTileGraphSettings& Settings)
+{
+	using namespace ServerRecastTileGraph;
+
+	const int32 NumTiles = TilesWidth * TilesHeight;
+	// paths between portals of one tile shouldn't wander far, detours around a wall stay within a few tiles
+	const float CostLimit = 4.f * FMath::Max(NavMesh.getParams()->tileWidth, NavMesh.getParams()->tileHeight);
+
+	TArray<TArray<FPendingEdge>> TileEdges;
+	TileEdges.SetNum(NumTiles);
+
+	int32 NumWorkers = Settings.NumWorkers > 0 ? Settings.NumWorkers : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+	NumWorkers = FMath::Clamp(NumWorkers, 1, FMath::Max(NumTiles, 1));
+
+	FThreadSafeCounter NextTile;
+	ParallelFor(NumWorkers, [&](int32 WorkerIndex)
+		{
+			dtNavMeshQuery* Query = dtAllocNavMeshQuery();
+			Query->init(&NavMesh, Settings.MaxNodes);
+			dtQueryFilter Filter;
+
+			for (int32 TileIndex = NextTile.Increment() - 1; TileIndex < NumTiles; TileIndex = NextTile.Increment() - 1)
+			{
+				int32 NumTilePortals = 0;
+				const int32* TilePortalIndices = GetTilePortals(TileIndex, NumTilePortals);
+				for (int32 A = 0; A < NumTilePortals; ++A)
+				{
+					for (int32 B = A + 1; B < NumTilePortals; ++B)
+					{
+						const FServerRecastTileGraphPortal& PortalA = Portals[TilePortalIndices[A]];
+						const FServerRecastTileGraphPortal& PortalB = Portals[TilePortalIndices[B]];
+
+						dtQueryResult Result;
+						float Cost = 0.f;
+						const dtStatus Status = Query->findPath(PortalA.PolyRef, PortalB.PolyRef, PortalA.Pos, PortalB.Pos, CostLimit, &Filter, Result, &Cost);
+						if (dtStatusSucceed(Status) && !dtStatusDetail(Status, DT_PARTIAL_RESULT))
+						{
+							TileEdges[TileIndex].Add({ TilePortalIndices[A], TilePortalIndices[B], Cost });
+						}
+					}
+				}
+			}
+
+			dtFreeNavMeshQuery(Query);
+		}, NumWorkers == 1);
+
+	// portals on a shared border are paired in both tiles, keep the cheaper edge
+	TArray<FPendingEdge> PendingEdges;
+	for (const TArray<FPendingEdge>& Pending : TileEdges)
+	{
+		for (const FPendingEdge& Edge : Pending)
+		{
+			PendingEdges.Add(Edge);
+			PendingEdges.Add({ Edge.ToPortal, Edge.FromPortal, Edge.Cost });
+		}
+	}
+	PendingEdges.Sort([](const FPendingEdge& A, const FPendingEdge& B)
+		{
+			return A.FromPortal != B.FromPortal ? A.FromPortal < B.FromPortal : (A.ToPortal != B.ToPortal ? A.ToPortal < B.ToPortal : A.Cost < B.Cost);
+		});
+
+	PortalFirstEdge.SetNumZeroed(Portals.Num() + 1);
+	Edges.Reset(PendingEdges.Num());
+	for (int32 Index = 0; Index < PendingEdges.Num(); ++Index)
+	{
+		const FPendingEdge& Edge = PendingEdges[Index];
+		if (Index > 0 && PendingEdges[Index - 1].FromPortal == Edge.FromPortal && PendingEdges[Index - 1].ToPortal == Edge.ToPortal)
+		{
+			continue;
+		}
+		Edges.Add({ Edge.ToPortal, Edge.Cost });
+		PortalFirstEdge[Edge.FromPortal + 1]++;
+	}
+	for (int32 PortalIndex = 0; PortalIndex < Portals.Num(); ++PortalIndex)
+	{
+		PortalFirstEdge[PortalIndex + 1] += PortalFirstEdge[PortalIndex];
+	}
+}
+
+bool FServerRecastTileGraph::Save(const FString& FileName) const
+{
+	using namespace ServerRecastTileGraph;
+
+	FArchive* FileAr = IFileManager::Get().CreateFileWriter(*FileName);
+	if (FileAr == nullptr)
+	{
+		UE_LOG(LogServerRecastRuntime, Error, TEXT("Failed to open %s for writing"), *FileName);
+		return false;
+	}
+
+	FFileHeader Header;
+	Header.Magic = SERVERRECAST_TILEGRAPH_MAGIC;
+	Header.Version = SERVERRECAST_TILEGRAPH_VERSION;
+	Header.MinTileX = MinTileX;
+	Header.MinTileY = MinTileY;
+	Header.TilesWidth = TilesWidth;
+	Header.TilesHeight = TilesHeight;
+	Header.NumPortals = Portals.Num();
+	Header.NumTilePortals = TilePortals.Num();
+	Header.NumEdges = Edges.Num();
+	Header.PackHash = PackHash;
+	Header.NavMeshParams = NavMeshParams;
+	FileAr->Serialize(&Header, sizeof(Header));
+
+	WriteArray(*FileAr, Portals);
+	WriteArray(*FileAr, TileFirstPortal);
+	WriteArray(*FileAr, TilePortals);
+	WriteArray(*FileAr, PortalFirstEdge);
+	WriteArray(*FileAr, Edges);
+
+	const bool bSuccess = !FileAr->IsError();
+	FileAr->Close();
+	delete FileAr;
+
+	if (!bSuccess)
+	{
+		UE_LOG(LogServerRecastRuntime, Error, TEXT("Failed to write %s"), *FileName);
+	}
+	return bSuccess;
+}
+
+bool FServerRecastTileGraph::Load(const FString& FileName, uint32 ExpectedPackHash)
+{
+	using namespace ServerRecastTileGraph;
+	*this = FServerRecastTileGraph();
+
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *FileName, FILEREAD_Silent) || FileData.Num() < (int32)sizeof(FFileHeader))
+	{
+		return false;
+	}
+
+	FFileHeader Header;
+	FMemory::Memcpy(&Header, FileData.GetData(), sizeof(Header));
+	const uint8* Cursor = FileData.GetData() + sizeof(Header);
+	const uint8* End = FileData.GetData() + FileData.Num();
+
+	bool bValid = Header.Magic == SERVERRECAST_TILEGRAPH_MAGIC && Header.Version == SERVERRECAST_TILEGRAPH_VERSION &&
+		Header.TilesWidth > 0 && Header.TilesHeight > 0 && (int64)Header.TilesWidth * Header.TilesHeight < MAX_int32 &&
+		Header.NumPortals >= 0 && Header.NumPortals < MAX_int32;
+	const int32 NumTiles = bValid ? Header.TilesWidth * Header.TilesHeight : 0;
+	bValid = bValid &&
+		ReadArray(Cursor, End, Header.NumPortals, Portals) &&
+		ReadArray(Cursor, End, NumTiles + 1, TileFirstPortal) &&
+		ReadArray(Cursor, End, Header.NumTilePortals, TilePortals) &&
+		ReadArray(Cursor, End, Header.NumPortals + 1, PortalFirstEdge) &&
+		ReadArray(Cursor, End, Header.NumEdges, Edges) &&
+		IsValidRanges(TileFirstPortal, TilePortals.Num()) && IsValidRanges(PortalFirstEdge, Edges.Num());
+
+	// queries index with these without checks
+	for (int32 Index = 0; bValid && Index < Portals.Num(); ++Index)
+	{
+		const FServerRecastTileGraphPortal& Portal = Portals[Index];
+		bValid = Portal.TileIndices[0] >= 0 && Portal.TileIndices[0] < NumTiles && Portal.TileIndices[1] >= 0 && Portal.TileIndices[1] < NumTiles;
+	}
+	for (int32 Index = 0; bValid && Index < TilePortals.Num(); ++Index)
+	{
+		bValid = TilePortals[Index] >= 0 && TilePortals[Index] < Portals.Num();
+	}
+	for (int32 Index = 0; bValid && Index < Edges.Num(); ++Index)
+	{
+		bValid = Edges[Index].TargetPortal >= 0 && Edges[Index].TargetPortal < Portals.Num() && Edges[Index].Cost >= 0.f;
+	}
+
+	if (bValid && ExpectedPackHash != 0 && Header.PackHash != ExpectedPackHash)
+	{
+		UE_LOG(LogServerRecastRuntime, Error, TEXT("%s was built for another navmesh, rebuild it with the navpack"), *FileName);
+		*this = FServerRecastTileGraph();
+		return false;
+	}
+	if (!bValid)
+	{
+		UE_LOG(LogServerRecastRuntime, Error, TEXT("%s is not a valid ServerRecast tile graph"), *FileName);
+		*this = FServerRecastTileGraph();
+		return false;
+	}
+
+	PackHash = Header.PackHash;
+	NavMeshParams = Header.NavMeshParams;
+	MinTileX = Header.MinTileX;
+	MinTileY = Header.MinTileY;
+	TilesWidth = Header.TilesWidth;
+	TilesHeight = Header.TilesHeight;
+	return true;
+}
+
+FServerRecastHierarchicalPathfinder::FServerRecastHierarchicalPathfinder(const dtNavMesh& InNavMesh, const FServerRecastTileGraph& InGraph, int32 MaxNodes)
+	: NavMesh(InNavMesh)
+	, Graph(InGraph)
+	, Tolerance(0.1f)
+	, FlatSearchTileDistance(1)
+	, VisitId(0)
+{
+	Query = dtAllocNavMeshQuery();
+	Query->init(&NavMesh, MaxNodes);
+
+	ResizeNodes();
+}
+
+void FServerRecastHierarchicalPathfinder::ResizeNodes()
+{
+	const int32 NumNodes = Graph.GetNumPortals() + 2;
+	if (NodeVisit.Num() != NumNodes)
+	{
+		NodeCost.SetNumUninitialized(NumNodes);
+		NodeParent.SetNumUninitialized(NumNodes);
+		NodeVisit.Reset();
+		NodeVisit.SetNumZeroed(NumNodes);
+		VisitId = 0;
+	}
+}
+
+FServerRecastHierarchicalPathfinder::~FServerRecastHierarchicalPathfinder()
+{
+	dtFreeNavMeshQuery(Query);
+}
+
+float FServerRecastHierarchicalPathfinder::GetLinkCost(dtPolyRef StartRef, dtPolyRef EndRef, const float* StartPos, const float* EndPos, const dtQueryFilter& Filter, float CostLimit) const
+{
+	dtQueryResult Result;
+	float Cost = 0.f;
+	const dtStatus Status = Query->findPath(StartRef, EndRef, StartPos, EndPos, CostLimit, &Filter, Result, &Cost);
+	return dtStatusSucceed(Status) && !dtStatusDetail(Status, DT_PARTIAL_RESULT) ? Cost : -1.f;
+}
+
+dtStatus FServerRecastHierarchicalPathfinder::FindFlatPath(dtPolyRef StartRef, dtPolyRef EndRef, const float* StartPos, const float* EndPos, const dtQueryFilter& Filter, float CostLimit,
+	dtPolyRef* OutPath, int32 MaxPath, int32& InOutNumPolys, float* OutCost)
+{
+	dtQueryResult Result;
+	float Cost = 0.f;
+	dtStatus Status = Query->findPath(StartRef, EndRef, StartPos, EndPos, CostLimit, &Filter, Result, &Cost);
+	if (dtStatusFailed(Status))
+	{
+		return Status;
+	}
+
+	// segments meet in the portal poly, it's written once
+	for (int32 Index = 0; Index < Result.size(); ++Index)
+	{
+		const dtPolyRef PolyRef = Result.getRef(Index);
+		if (InOutNumPolys > 0 && OutPath[InOutNumPolys - 1] == PolyRef)
+		{
+			continue;
+		}
+		if (InOutNumPolys >= MaxPath)
+		{
+			Status |= DT_BUFFER_TOO_SMALL;
+			break;
+		}
+		OutPath[InOutNumPolys++] = PolyRef;
+	}
+
+	if (OutCost)
+	{
+		*OutCost = Cost;
+	}
+	return Status;
+}
+
+bool FServerRecastHierarchicalPathfinder::SearchPortals(dtPolyRef StartRef, dtPolyRef EndRef, const float* StartPos, const float* EndPos, int32 StartTile, int32 EndTile,
+	const dtQueryFilter& Filter, FServerRecastHierarchicalPathStats& Stats)
+{
+	// graph may have been rebuilt or reloaded since the last query
+	ResizeNodes();
+
+	const int32 StartNode = Graph.GetNumPortals();
+	const int32 EndNode = StartNode + 1;
+	const float HeuristicScale = 1.f + Tolerance;
+	const float LinkCostLimit = 4.f * FMath::Max(NavMesh.getParams()->tileWidth, NavMesh.getParams()->tileHeight);
+
+	// visit stamps spare clearing scratch of the whole graph per query
+	if (++VisitId == 0)
+	{
+		FMemory::Memzero(NodeVisit.GetData(), NodeVisit.Num() * sizeof(uint32));
+		VisitId = 1;
+	}
+	auto TouchNode = [this](int32 Node)
+	{
+		if (NodeVisit[Node] != VisitId)
+		{
+			NodeVisit[Node] = VisitId;
+			NodeCost[Node] = MAX_FLT;
+			NodeParent[Node] = INDEX_NONE;
+		}
+	};
+	auto Relax = [this, &TouchNode](int32 Node, int32 Parent, float Cost, float Heuristic)
+	{
+		TouchNode(Node);
+		if (Cost < NodeCost[Node])
+		{
+			NodeCost[Node] = Cost;
+			NodeParent[Node] = Parent;
+			OpenList.HeapPush({ Cost + Heuristic, Cost, Node });
+		}
+	};
+
+	EndLinks.Reset();
+	int32 NumEndPortals = 0;
+	const int32* EndPortalIndices = Graph.GetTilePortals(EndTile, NumEndPortals);
+	for (int32 Index = 0; Index < NumEndPortals; ++Index)
+	{
+		const FServerRecastTileGraphPortal& Portal = Graph.GetPortal(EndPortalIndices[Index]);
+		const float Cost = GetLinkCost(Portal.PolyRef, EndRef, Portal.Pos, EndPos, Filter, LinkCostLimit);
+		Stats.NumDetourSearches++;
+		if (Cost >= 0.f)
+		{
+			EndLinks.Add(TPair<int32, float>(EndPortalIndices[Index], Cost));
+		}
+	}
+	if (EndLinks.Num() == 0)
+	{
+		return false;
+	}
+
+	OpenList.Reset();
+	TouchNode(StartNode);
+	NodeCost[StartNode] = 0.f;
+
+	int32 NumStartPortals = 0;
+	const int32* StartPortalIndices = Graph.GetTilePortals(StartTile, NumStartPortals);
+	for (int32 Index = 0; Index < NumStartPortals; ++Index)
+	{
+		const FServerRecastTileGraphPortal& Portal = Graph.GetPortal(StartPortalIndices[Index]);
+		const float Cost = GetLinkCost(StartRef, Portal.PolyRef, StartPos, Portal.Pos, Filter, LinkCostLimit);
+		Stats.NumDetourSearches++;
+		if (Cost >= 0.f)
+		{
+			Relax(StartPortalIndices[Index], StartNode, Cost, dtVdist(Portal.Pos, EndPos) * HeuristicScale);
+		}
+	}
+
+	while (OpenList.Num())
+	{
+		FOpenNode Open;
+		OpenList.HeapPop(Open, false);
+		if (Open.Cost > NodeCost[Open.Node])
+		{
+			continue;
+		}
+		if (Open.Node == EndNode)
+		{
+			Route.Reset();
+			for (int32 Node = NodeParent[EndNode]; Node != StartNode; Node = NodeParent[Node])
+			{
+				Route.Add(Node);
+			}
+			Algo::Reverse(Route);
+			return true;
+		}
+
+		Stats.NumExpandedPortals++;
+		for (const TPair<int32, float>& EndLink : EndLinks)
+		{
+			if (EndLink.Key == Open.Node)
+			{
+				Relax(EndNode, Open.Node, Open.Cost + EndLink.Value, 0.f);
+			}
+		}
+
+		int32 NumEdges = 0;
+		const FServerRecastTileGraphEdge* PortalEdges = Graph.GetEdges(Open.Node, NumEdges);
+		for (int32 Index = 0; Index < NumEdges; ++Index)
+		{
+			const FServerRecastTileGraphEdge& Edge = PortalEdges[Index];
+			Relax(Edge.TargetPortal, Open.Node, Open.Cost + Edge.Cost, dtVdist(Graph.GetPortal(Edge.TargetPortal).Pos, EndPos) * HeuristicScale);
+		}
+	}
+
+	return false;
+}
+
+dtStatus FServerRecastHierarchicalPathfinder::FindPath(const float* StartPos, const float* EndPos, const float* Extent, const dtQueryFilter& Filter,
+	dtPolyRef* OutPath, int32 MaxPath, int32& OutNumPolys, FServerRecastHierarchicalPathStats* OutStats)
+{
+	FServerRecastHierarchicalPathStats Stats;
+	FMemory::Memzero(Stats);
+	OutNumPolys = 0;
+
+	dtPolyRef StartRef = 0;
+	dtPolyRef EndRef = 0;
+	float StartPoint[3], EndPoint[3];
+	Query->findNearestPoly(StartPos, Extent, &Filter, &StartRef, StartPoint);
+	Query->findNearestPoly(EndPos, Extent, &Filter, &EndRef, EndPoint);
+	if (StartRef == 0 || EndRef == 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	int32 StartX, StartY, EndX, EndY;
+	NavMesh.calcTileLoc(StartPoint, &StartX, &StartY);
+	NavMesh.calcTileLoc(EndPoint, &EndX, &EndY);
+	const bool bUseGraph = Graph.IsValid() && Graph.IsBuiltFor(NavMesh);
+	const int32 StartTile = bUseGraph ? Graph.GetTileIndex(StartX, StartY) : INDEX_NONE;
+	const int32 EndTile = bUseGraph ? Graph.GetTileIndex(EndX, EndY) : INDEX_NONE;
+	const bool bNearby = FMath::Max(FMath::Abs(StartX - EndX), FMath::Abs(StartY - EndY)) <= FlatSearchTileDistance;
+
+	dtStatus Status = DT_SUCCESS;
+	if (bNearby || StartTile == INDEX_NONE || EndTile == INDEX_NONE || !SearchPortals(StartRef, EndRef, StartPoint, EndPoint, StartTile, EndTile, Filter, Stats))
+	{
+		Stats.bFlatSearch = true;
+		Stats.NumDetourSearches++;
+		Status = FindFlatPath(StartRef, EndRef, StartPoint, EndPoint, Filter, MAX_FLT, OutPath, MaxPath, OutNumPolys, nullptr);
+	}
+	else
+	{
+		// refine only the corridor: one short search per pair of consecutive waypoints
+		dtPolyRef FromRef = StartRef;
+		const float* FromPos = StartPoint;
+		for (int32 Waypoint = 0; Waypoint <= Route.Num(); ++Waypoint)
+		{
+			const bool bLast = Waypoint == Route.Num();
+			const dtPolyRef ToRef = bLast ? EndRef : Graph.GetPortal(Route[Waypoint]).PolyRef;
+			const float* ToPos = bLast ? EndPoint : Graph.GetPortal(Route[Waypoint]).Pos;
+
+			Stats.NumDetourSearches++;
+			const dtStatus SegmentStatus = FindFlatPath(FromRef, ToRef, FromPos, ToPos, Filter, MAX_FLT, OutPath, MaxPath, OutNumPolys, nullptr);
+			if (dtStatusFailed(SegmentStatus))
+			{
+				Status = OutNumPolys > 0 ? (DT_SUCCESS | DT_PARTIAL_RESULT) : SegmentStatus;
+				break;
+			}
+			if (dtStatusDetail(SegmentStatus, DT_PARTIAL_RESULT | DT_BUFFER_TOO_SMALL))
+			{
+				Status |= dtStatusDetail(SegmentStatus, DT_BUFFER_TOO_SMALL) ? DT_BUFFER_TOO_SMALL : DT_PARTIAL_RESULT;
+				break;
+			}
+
+			FromRef = ToRef;
+			FromPos = ToPos;
+		}
+	}
+
+	if (OutStats)
+	{
+		*OutStats = Stats;
+	}
+	return Status;
+}
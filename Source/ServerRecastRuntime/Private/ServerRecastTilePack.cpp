@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+#include "ServerRecastTilePack.h"
+#include "ServerRecastRuntime.h"
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+
+namespace ServerRecastTilePack
+{
+	/** tiles with data in (TileY, TileX, Layer) order */
+	static void GetSortedTiles(const dtNavMesh& NavMesh, TArray<const dtMeshTile*>& OutTiles)
+	{
+		for (int32 Index = 0; Index < NavMesh.getMaxTiles(); ++Index)
+		{
+			const dtMeshTile* Tile = NavMesh.getTile(Index);
+			if (Tile && Tile->header && Tile->dataSize)
+			{
+				OutTiles.Add(Tile);
+			}
+		}
+
+		OutTiles.Sort([](const dtMeshTile& A, const dtMeshTile& B)
+			{
+				if (A.header->y != B.header->y)
+				{
+					return A.header->y < B.header->y;
+				}
+				return A.header->x != B.header->x ? A.header->x < B.header->x : A.header->layer < B.header->layer;
+			});
+	}
+
+	static uint32 HashTiles(const dtNavMesh& NavMesh, const TArray<const dtMeshTile*>& Tiles)
+	{
+		uint32 Hash = FCrc::MemCrc32(NavMesh.getParams(), sizeof(dtNavMeshParams));
+		for (const dtMeshTile* Tile : Tiles)
+		{
+			const uint64 TileRef = NavMesh.getTileRef(Tile);
+			Hash = FCrc::MemCrc32(&TileRef, sizeof(TileRef), Hash);
+			Hash = FCrc::MemCrc32(Tile->data, Tile->dataSize, Hash);
+		}
+		return Hash;
+	}
+
+	uint32 GetPackHash(const dtNavMesh& NavMesh)
+	{
+		TArray<const dtMeshTile*> Tiles;
+		GetSortedTiles(NavMesh, Tiles);
+		return HashTiles(NavMesh, Tiles);
+	}
+
+	bool Save(const dtNavMesh& NavMesh, const FString& FileName)
+	{
+		TArray<FServerRecastTilePackEntry> Entries;
+		TArray<const dtMeshTile*> Tiles;
+		GetSortedTiles(NavMesh, Tiles);
+
+		uint64 Offset = Align(sizeof(FServerRecastTilePackHeader) + Tiles.Num() * sizeof(FServerRecastTilePackEntry), SERVERRECAST_TILEPACK_ALIGNMENT);
+		for (const dtMeshTile* Tile : Tiles)
+		{
+			FServerRecastTilePackEntry& Entry = Entries[Entries.AddZeroed()];
+			Entry.TileRef = NavMesh.getTileRef(Tile);
+			Entry.DataOffset = Offset;
+			Entry.DataSize = Tile->dataSize;
+			Entry.TileX = Tile->header->x;
+			Entry.TileY = Tile->header->y;
+			Entry.Layer = Tile->header->layer;
+			FMemory::Memcpy(Entry.BMin, Tile->header->bmin, sizeof(Entry.BMin));
+			FMemory::Memcpy(Entry.BMax, Tile->header->bmax, sizeof(Entry.BMax));
+			Offset = Align(Offset + Tile->dataSize, SERVERRECAST_TILEPACK_ALIGNMENT);
+		}
+
+		FServerRecastTilePackHeader Header;
+		FMemory::Memzero(Header);
+		Header.Magic = SERVERRECAST_TILEPACK_MAGIC;
+		Header.Version = SERVERRECAST_TILEPACK_VERSION;
+		Header.DetourVersion = DT_NAVMESH_VERSION;
+		Header.NumTiles = Entries.Num();
+		Header.FileSize = Offset;
+		Header.Params = *NavMesh.getParams();
+		Header.PackHash = HashTiles(NavMesh, Tiles);
+
+		FArchive* FileAr = IFileManager::Get().CreateFileWriter(*FileName);
+		if (FileAr == nullptr)
+		{
+			UE_LOG(LogServerRecastRuntime, Error, TEXT("Failed to open %s for writing"), *FileName);
+			return false;
+		}
+
+		uint8 Padding[SERVERRECAST_TILEPACK_ALIGNMENT] = { 0 };
+		auto WritePadding = [FileAr, &Padding]()
+		{
+			const int64 Position = FileAr->Tell();
+			FileAr->Serialize(Padding, Align(Position, SERVERRECAST_TILEPACK_ALIGNMENT) - Position);
+		};
+
+		FileAr->Serialize(&Header, sizeof(Header));
+		FileAr->Serialize(Entries.GetData(), Entries.Num() * sizeof(FServerRecastTilePackEntry));
+		WritePadding();
+		for (const dtMeshTile* Tile : Tiles)
+		{
+			FileAr->Serialize(Tile->data, Tile->dataSize);
+			WritePadding();
+		}
+
+		const bool bSuccess = !FileAr->IsError() && (uint64)FileAr->Tell() == Header.FileSize;
+		FileAr->Close();
+		delete FileAr;
+
+		if (bSuccess)
+		{
+			UE_LOG(LogServerRecastRuntime, Log, TEXT("%d navmesh tiles packed to %s, %llu bytes"), Header.NumTiles, *FileName, Header.FileSize);
+		}
+		else
+		{
+			UE_LOG(LogServerRecastRuntime, Error, TEXT("Failed to write %s"), *FileName);
+		}
+		return bSuccess;
+	}
+
+	bool Validate(const uint8* Data, int64 DataSize)
+	{
+		if (Data == nullptr || DataSize < (int64)sizeof(FServerRecastTilePackHeader))
+		{
+			return false;
+		}
+
+		const FServerRecastTilePackHeader& Header = *reinterpret_cast<const FServerRecastTilePackHeader*>(Data);
+		if (Header.Magic != SERVERRECAST_TILEPACK_MAGIC || Header.Version != SERVERRECAST_TILEPACK_VERSION || Header.DetourVersion != DT_NAVMESH_VERSION ||
+			Header.FileSize != (uint64)DataSize || Header.NumTiles < 0 ||
+			sizeof(FServerRecastTilePackHeader) + (uint64)Header.NumTiles * sizeof(FServerRecastTilePackEntry) > (uint64)DataSize)
+		{
+			return false;
+		}
+
+		// tile data lies between the index and the end of the file, lookups rely on strict (TileY, TileX, Layer) order
+		const uint64 IndexEnd = sizeof(FServerRecastTilePackHeader) + (uint64)Header.NumTiles * sizeof(FServerRecastTilePackEntry);
+		const FServerRecastTilePackEntry* Entries = reinterpret_cast<const FServerRecastTilePackEntry*>(Data + sizeof(FServerRecastTilePackHeader));
+		for (int32 Index = 0; Index < Header.NumTiles; ++Index)
+		{
+			const FServerRecastTilePackEntry& Entry = Entries[Index];
+			if (Entry.DataSize <= 0 || Entry.DataOffset % SERVERRECAST_TILEPACK_ALIGNMENT != 0 ||
+				Entry.DataOffset < IndexEnd || Entry.DataOffset > (uint64)DataSize || (uint64)Entry.DataSize > (uint64)DataSize - Entry.DataOffset)
+			{
+				return false;
+			}
+
+			if (Index > 0)
+			{
+				const FServerRecastTilePackEntry& Prev = Entries[Index - 1];
+				const bool bOrdered = Prev.TileY != Entry.TileY ? Prev.TileY < Entry.TileY :
+					(Prev.TileX != Entry.TileX ? Prev.TileX < Entry.TileX : Prev.Layer < Entry.Layer);
+				if (!bOrdered)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
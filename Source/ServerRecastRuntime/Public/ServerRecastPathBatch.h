@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMeshQuery.h"
+#include "ServerRecastPathCache.h"
+
+/** One path of a batch, positions in recast coords */
+struct FServerRecastPathRequest
+{
+	float StartPos[3];
+	float EndPos[3];
+	/** nullptr uses the pool's filter */
+	const dtQueryFilter* Filter;
+	/** path cache key of the filter, 0 hashes its costs and flags, see FServerRecastPathCache::HashFilter */
+	uint32 FilterHash;
+	/** caller owned, receives up to MaxPoints straight path corners (3 floats each), nullptr computes only the corridor */
+	float* PathPoints;
+	int32 MaxPoints;
+
+	FServerRecastPathRequest()
+		: Filter(nullptr), FilterHash(0), PathPoints(nullptr), MaxPoints(0)
+	{
+		FMemory::Memzero(StartPos);
+		FMemory::Memzero(EndPos);
+	}
+};
+
+struct FServerRecastPathResult
+{
+	/** DT_SUCCESS, DT_FAILURE or DT_IN_PROGRESS while the batch still works on it, plus DT_PARTIAL_RESULT when the end wasn't reached */
+	dtStatus Status;
+	/** corners written to PathPoints */
+	int32 NumPoints;
+	/** corridor came from the path cache, no search was run */
+	bool bFromCache;
+	/** polys of the corridor, at most the pool's MaxPathPolys */
+	int32 NumPolys;
+
+	FServerRecastPathResult() : Status(DT_FAILURE), NumPoints(0), bFromCache(false), NumPolys(0) {}
+
+	bool IsDone() const { return !dtStatusInProgress(Status); }
+	bool IsPartial() const { return dtStatusDetail(Status, DT_PARTIAL_RESULT); }
+};
+
+/**
+* Runs batches of path requests on several threads, each with its own dtNavMeshQuery.
+*
+* Node pools, corridor and straight path buffers are allocated once in the constructor, executing a batch
+* writes only to caller's buffers and allocates only when a completed search is added to the path cache.
+* Searches run sliced, so a batch can be spread over several ticks with a time budget: a search cut by
+* the budget keeps its state in the worker's query and continues on the next Tick. The navmesh must not change while a batch is running.
+*/
+class SERVERRECASTRUNTIME_API FServerRecastPathQueryPool
+{
+public:
+	/**
+	* @param NumWorkers - queries and threads used by batches, 0 uses every task graph worker plus the calling thread
+	* @param MaxNodes - search nodes of each query
+	* @param MaxPathPolys - longest corridor, longer paths end partial
+	*/
+	FServerRecastPathQueryPool(const dtNavMesh& InNavMesh, int32 NumWorkers = 0, int32 MaxNodes = 2048, int32 MaxPathPolys = 256);
+	~FServerRecastPathQueryPool();
+
+	/** Points every query to another navmesh, e.g. after FServerRecastRuntimeNavMesh::Open, node pools are reused. Drops the current batch */
+	void SetNavMesh(const dtNavMesh& InNavMesh);
+
+	/** used for requests without own filter */
+	dtQueryFilter& GetDefaultFilter() { return DefaultFilter; }
+
+	/** recast half extents of the box searched for start and end polys */
+	void SetPolySearchExtent(float X, float Y, float Z);
+
+	/** search iterations between budget checks */
+	void SetIterationsPerSlice(int32 InIterationsPerSlice) { IterationsPerSlice = FMath::Max(1, InIterationsPerSlice); }
+
+	/** Corridors are looked up there before searching and completed searches are added, nullptr disables */
+	void SetPathCache(FServerRecastPathCache* InPathCache) { PathCache = InPathCache; }
+
+	/**
+	* Starts a batch, previous one is dropped. Requests and Results must stay valid until the batch is done.
+	* Every result is DT_IN_PROGRESS until its search finishes.
+	*/
+	void BeginBatch(const FServerRecastPathRequest* InRequests, FServerRecastPathResult* InResults, int32 InNumRequests);
+
+	/**
+	* Works on the current batch on all workers until it's done or the budget runs out.
+	* @param TimeBudget - seconds, 0 runs the batch to the end
+	* @return true when every request of the batch is done
+	*/
+	bool Tick(double TimeBudget = 0.);
+
+	bool IsBatchDone() const;
+
+	/** BeginBatch and Tick without budget */
+	void Execute(const FServerRecastPathRequest* InRequests, FServerRecastPathResult* InResults, int32 InNumRequests);
+
+	int32 GetNumWorkers() const { return Workers.Num(); }
+
+private:
+	struct FWorker
+	{
+		dtNavMeshQuery* Query;
+		/** corridor of the current search */
+		TArray<dtPolyRef> Path;
+		dtQueryResult StraightPath;
+		/** request being searched, INDEX_NONE when idle */
+		int32 RequestIndex;
+		float StartPos[3];
+		float EndPos[3];
+		FServerRecastPathCacheKey CacheKey;
+	};
+
+	/** Finds start and end polys and starts a sliced search, writes result right away when there's nothing to search */
+	void StartRequest(FWorker& Worker, int32 RequestIndex) const;
+
+	/** Ends the worker's search and writes corridor and straight path to the request's result */
+	void FinishRequest(FWorker& Worker) const;
+
+	/** String-pulls the worker's corridor into the request's points */
+	void WriteStraightPath(FWorker& Worker, const FServerRecastPathRequest& Request, FServerRecastPathResult& Result, int32 NumPolys) const;
+
+	/** @return false when stopped by the deadline with work left */
+	bool RunWorker(FWorker& Worker, double Deadline);
+
+	const dtNavMesh* NavMesh;
+	int32 MaxNodes;
+	TArray<FWorker> Workers;
+	dtQueryFilter DefaultFilter;
+	float PolySearchExtent[3];
+	int32 MaxPathPolys;
+	int32 IterationsPerSlice;
+	FServerRecastPathCache* PathCache;
+
+	const FServerRecastPathRequest* Requests;
+	FServerRecastPathResult* Results;
+	int32 NumRequests;
+	FThreadSafeCounter NextRequest;
+};
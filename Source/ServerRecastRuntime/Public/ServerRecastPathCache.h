@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Containers/List.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
+
+class dtQueryFilter;
+
+struct FServerRecastPathCacheKey
+{
+	dtPolyRef StartRef;
+	dtPolyRef EndRef;
+	uint32 FilterHash;
+
+	FServerRecastPathCacheKey() : StartRef(0), EndRef(0), FilterHash(0) {}
+	FServerRecastPathCacheKey(dtPolyRef InStartRef, dtPolyRef InEndRef, uint32 InFilterHash) : StartRef(InStartRef), EndRef(InEndRef), FilterHash(InFilterHash) {}
+
+	bool operator==(const FServerRecastPathCacheKey& Other) const
+	{
+		return StartRef == Other.StartRef && EndRef == Other.EndRef && FilterHash == Other.FilterHash;
+	}
+
+	friend uint32 GetTypeHash(const FServerRecastPathCacheKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.StartRef), GetTypeHash(Key.EndRef)), Key.FilterHash);
+	}
+};
+
+struct FServerRecastPathCacheStats
+{
+	int64 NumHits;
+	int64 NumMisses;
+	int64 NumEvictions;
+	/** entries dropped because a tile they pass through was removed */
+	int64 NumInvalidations;
+	int32 NumEntries;
+	int64 MemoryBytes;
+	int64 MemoryBudget;
+
+	float GetHitRate() const { return NumHits + NumMisses > 0 ? (float)NumHits / (NumHits + NumMisses) : 0.f; }
+};
+
+/**
+* Complete poly corridors of earlier searches keyed by start poly, end poly and filter.
+* Straight path depends on exact positions, so only the A* part is cached, callers still string-pull the corridor.
+*
+* Entries are split into shards by key, each shard has its own lock and LRU list, so concurrent workers rarely wait.
+* Least recently used entries are evicted once the shard goes over its part of the memory budget.
+* InvalidateTile drops exactly the entries whose corridor crosses the tile, call it before the tile is removed
+* or replaced (FServerRecastRuntimeNavMesh does it on unload). Partial corridors are never cached,
+* so tiles added later can't leave a dead end in the cache.
+* Entries belong to one navmesh and version, SetNavMesh drops them when either changes.
+*/
+class SERVERRECASTRUNTIME_API FServerRecastPathCache
+{
+public:
+	/** @param MemoryBudget - bytes of entries and their bookkeeping */
+	FServerRecastPathCache(const dtNavMesh& InNavMesh, int64 InMemoryBudget = 16 * 1024 * 1024, int32 NumShards = 16);
+	~FServerRecastPathCache();
+
+	/**
+	* Rebinds the cache, entries are kept only when both navmesh and version stay the same. No search may run meanwhile.
+	* @param InNavMeshVersion - identifies navmesh content, e.g. FServerRecastRuntimeNavMesh::GetPackHash
+	*/
+	void SetNavMesh(const dtNavMesh& InNavMesh, uint32 InNavMeshVersion);
+	uint32 GetNavMeshVersion() const { return NavMeshVersion; }
+
+	/** Hash of area costs and flags, filters overriding passFilter or getCost need their own hash */
+	static uint32 HashFilter(const dtQueryFilter& Filter);
+
+	/**
+	* Copies cached corridor to OutPath without allocating.
+	* @return false on miss or when the corridor is longer than MaxPath
+	*/
+	bool Find(const FServerRecastPathCacheKey& Key, dtPolyRef* OutPath, int32 MaxPath, int32& OutNumPolys);
+
+	/**
+	* Adds or replaces corridor of a completed search, Path runs from Key.StartRef to Key.EndRef.
+	* The entry is allocated before the shard is locked, only index growth may allocate under the lock.
+	*/
+	void Add(const FServerRecastPathCacheKey& Key, const dtPolyRef* Path, int32 NumPolys);
+
+	/** Drops entries crossing the tile */
+	void InvalidateTile(dtTileRef TileRef);
+
+	void Clear();
+
+	FServerRecastPathCacheStats GetStats() const;
+
+	void LogStats() const;
+
+private:
+	struct FEntry
+	{
+		FServerRecastPathCacheKey Key;
+		TArray<dtPolyRef> Path;
+		/** distinct tile indices of Path */
+		TArray<uint32, TInlineAllocator<8>> Tiles;
+		int64 Size;
+	};
+
+	typedef TDoubleLinkedList<FEntry> FEntryList;
+
+	struct FShard
+	{
+		FCriticalSection Lock;
+		/** most recently used at head */
+		FEntryList Entries;
+		TMap<FServerRecastPathCacheKey, FEntryList::TDoubleLinkedListNode*> EntriesByKey;
+		TMultiMap<uint32, FServerRecastPathCacheKey> KeysByTile;
+		int64 MemoryBytes;
+
+		FShard() : MemoryBytes(0) {}
+	};
+
+	FShard& GetShard(const FServerRecastPathCacheKey& Key) { return *Shards[GetTypeHash(Key) % (uint32)Shards.Num()]; }
+
+	/** Unlinks and deletes entry, shard must be locked */
+	void RemoveEntry(FShard& Shard, FEntryList::TDoubleLinkedListNode* Node);
+
+	const dtNavMesh* NavMesh;
+	uint32 NavMeshVersion;
+	TArray<TUniquePtr<FShard>> Shards;
+	int64 MemoryBudget;
+	int64 ShardBudget;
+
+	FThreadSafeCounter64 NumHits;
+	FThreadSafeCounter64 NumMisses;
+	FThreadSafeCounter64 NumEvictions;
+	FThreadSafeCounter64 NumInvalidations;
+};
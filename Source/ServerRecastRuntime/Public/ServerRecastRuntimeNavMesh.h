@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerRecastTilePack.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class FServerRecastPathCache;
+
+/**
+* Navmesh of a dedicated server backed by a mapped tile pack.
+*
+* Open maps the file read-only and creates an empty dtNavMesh, startup costs the same for any world size.
+* Page cache of the file is shared by all server processes on the machine. Tiles are added only when asked for:
+* Detour links tiles by writing into their data, so a loaded tile is copied out of the mapping once,
+* the rest of the file stays in shared clean pages.
+*
+* Loading and unloading change the navmesh, call them from the thread owning it while no query runs.
+* Every Open creates a new dtNavMesh: the attached path cache is rebound, query pools and other users
+* of GetNavMesh must be pointed to the new one (FServerRecastPathQueryPool::SetNavMesh).
+*/
+class SERVERRECASTRUNTIME_API FServerRecastRuntimeNavMesh
+{
+public:
+	FServerRecastRuntimeNavMesh();
+	~FServerRecastRuntimeNavMesh();
+
+	/** @return false when the file is missing or not a valid pack */
+	bool Open(const FString& FileName);
+	void Close();
+
+	bool IsOpen() const { return NavMesh != nullptr; }
+
+	/** tiles loaded so far, not owned */
+	dtNavMesh* GetNavMesh() const { return NavMesh; }
+
+	int32 GetNumTiles() const { return Header ? Header->NumTiles : 0; }
+	/** content hash of the open pack, 0 when closed */
+	uint32 GetPackHash() const { return Header ? Header->PackHash : 0; }
+	int32 GetNumLoadedTiles() const { return NumLoadedTiles; }
+	/** heap taken by loaded tile copies */
+	int64 GetLoadedBytes() const { return LoadedBytes; }
+
+	/** Loads every layer of the tile, @return false when the pack has no such tile or Detour rejects it */
+	bool LoadTile(int32 TileX, int32 TileY);
+
+	/** Loads tiles overlapping the box on XZ plane, recast coords. @return number of tiles loaded by this call */
+	int32 LoadTilesInBounds(const float* BMin, const float* BMax);
+
+	/** Loads tiles under both points and every tile of the box between them, enough for most path queries */
+	int32 LoadTilesForPath(const float* StartPos, const float* EndPos, float Extent);
+
+	int32 LoadAllTiles();
+
+	/** Removes every layer of the tile from the navmesh, refs of its polys become invalid until it's loaded again */
+	void UnloadTile(int32 TileX, int32 TileY);
+
+	/** @return true when every layer of the tile is loaded */
+	bool IsTileLoaded(int32 TileX, int32 TileY) const;
+
+	/** corridors crossing a tile are dropped from the cache when the tile is unloaded, all of them on Close, nullptr disables */
+	void SetPathCache(FServerRecastPathCache* InPathCache);
+
+private:
+	/** @return index of the first entry of the tile or INDEX_NONE */
+	int32 FindEntry(int32 TileX, int32 TileY) const;
+
+	bool LoadEntry(int32 EntryIndex);
+
+	IMappedFileHandle* MappedHandle;
+	IMappedFileRegion* MappedRegion;
+	/** fallback storage when the file can't be mapped */
+	TArray<uint8> LoadedData;
+
+	const uint8* Data;
+	const FServerRecastTilePackHeader* Header;
+	const FServerRecastTilePackEntry* Entries;
+
+	dtNavMesh* NavMesh;
+	/** ref of each loaded entry, 0 when not loaded */
+	TArray<dtTileRef> LoadedRefs;
+	int32 NumLoadedTiles;
+	int64 LoadedBytes;
+
+	FServerRecastPathCache* PathCache;
+};
@@ -0,0 +1,199 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMeshQuery.h"
+
+/**
+* Abstract graph over navmesh tiles for long distance queries (*.navgraph).
+*
+* Nodes are portals: runs of border poly edges shared by two neighbouring tiles, split at gaps, floor changes
+* and MaxPortalWidth. Each portal touches two tiles. Portals touching the same tile are connected by
+* the cost of a Detour path between them, computed offline for every tile in parallel.
+* Poly refs are stored, so the graph belongs to the navmesh it was built from (refs survive .navmesh and .navpack loads):
+* its navmesh params and pack hash are saved along and checked on load and by the pathfinder.
+* Costs are those of the default dtQueryFilter.
+*/
+
+#define SERVERRECAST_TILEGRAPH_MAGIC	0x47485253	// 'SRHG'
+#define SERVERRECAST_TILEGRAPH_VERSION	2
+
+struct FServerRecastTileGraphSettings
+{
+	/** border edges closer than this along the border join one portal */
+	float PortalMergeDistance;
+	/** height difference splitting a border run into portals, keeps floors apart */
+	float PortalMaxHeightDifference;
+	/** longer runs are split, narrower portals give paths closer to optimal and more nodes */
+	float MaxPortalWidth;
+	/** search nodes of intra-tile path queries */
+	int32 MaxNodes;
+	/** threads computing intra-tile costs, 0 uses every task graph worker plus the calling thread */
+	int32 NumWorkers;
+
+	FServerRecastTileGraphSettings()
+		: PortalMergeDistance(20.f)
+		, PortalMaxHeightDifference(100.f)
+		, MaxPortalWidth(1000.f)
+		, MaxNodes(4096)
+		, NumWorkers(0)
+	{
+	}
+};
+
+struct FServerRecastTileGraphPortal
+{
+	dtPolyRef PolyRef;
+	/** middle of the run, recast coords */
+	float Pos[3];
+	/** tiles on both sides of the border */
+	int32 TileIndices[2];
+};
+
+struct FServerRecastTileGraphEdge
+{
+	int32 TargetPortal;
+	float Cost;
+};
+
+class SERVERRECASTRUNTIME_API FServerRecastTileGraph
+{
+public:
+	FServerRecastTileGraph();
+
+	/** Finds portals and intra-tile costs of every tile, @return false for navmesh without tiles */
+	bool Build(const dtNavMesh& NavMesh, const FServerRecastTileGraphSettings& Settings = FServerRecastTileGraphSettings());
+
+	bool Save(const FString& FileName) const;
+
+	/**
+	* Every index of the file is range checked, damaged files are rejected as a whole.
+	* @param ExpectedPackHash - FServerRecastRuntimeNavMesh::GetPackHash of the navmesh it will be used with, 0 skips the check
+	*/
+	bool Load(const FString& FileName, uint32 ExpectedPackHash = 0);
+
+	bool IsValid() const { return TilesWidth > 0 && TilesHeight > 0; }
+
+	/** ServerRecastTilePack::GetPackHash of the navmesh the graph was built from */
+	uint32 GetPackHash() const { return PackHash; }
+
+	/** @return true when NavMesh has the tile layout the graph was built for */
+	bool IsBuiltFor(const dtNavMesh& NavMesh) const;
+
+	/** @return grid index of tile or INDEX_NONE outside the graph */
+	int32 GetTileIndex(int32 TileX, int32 TileY) const;
+
+	int32 GetNumPortals() const { return Portals.Num(); }
+	const FServerRecastTileGraphPortal& GetPortal(int32 PortalIndex) const { return Portals[PortalIndex]; }
+
+	/** portals on the border of the tile */
+	const int32* GetTilePortals(int32 TileIndex, int32& OutNum) const;
+
+	const FServerRecastTileGraphEdge* GetEdges(int32 PortalIndex, int32& OutNum) const;
+
+	int32 GetNumEdges() const { return Edges.Num(); }
+
+private:
+	void BuildPortals(const dtNavMesh& NavMesh, const FServerRecastTileGraphSettings& Settings);
+	void BuildEdges(const dtNavMesh& NavMesh, const FServerRecastTileGraphSettings& Settings);
+
+	uint32 PackHash;
+	dtNavMeshParams NavMeshParams;
+
+	/** tile grid covering all tiles of the navmesh */
+	int32 MinTileX;
+	int32 MinTileY;
+	int32 TilesWidth;
+	int32 TilesHeight;
+
+	TArray<FServerRecastTileGraphPortal> Portals;
+	/** TilePortals[TileFirstPortal[T] .. TileFirstPortal[T + 1]) are portals of tile T */
+	TArray<int32> TileFirstPortal;
+	TArray<int32> TilePortals;
+	/** Edges[PortalFirstEdge[P] .. PortalFirstEdge[P + 1]) leave portal P */
+	TArray<int32> PortalFirstEdge;
+	TArray<FServerRecastTileGraphEdge> Edges;
+};
+
+struct FServerRecastHierarchicalPathStats
+{
+	/** abstract graph nodes taken from the open list */
+	int32 NumExpandedPortals;
+	/** Detour searches linking start and end to portals and refining the corridor */
+	int32 NumDetourSearches;
+	/** fell back to a plain Detour search */
+	bool bFlatSearch;
+};
+
+/**
+* Long distance path queries over FServerRecastTileGraph: start and end are linked to portals of their tiles,
+* the portal graph is searched with A*, then Detour refines the corridor between consecutive portals only.
+* Nearby points, points the graph can't connect and graphs built for another navmesh use a plain Detour search.
+* Scratch buffers are kept between queries and follow the graph when it's rebuilt or reloaded, use one instance per thread.
+*/
+class SERVERRECASTRUNTIME_API FServerRecastHierarchicalPathfinder
+{
+public:
+	FServerRecastHierarchicalPathfinder(const dtNavMesh& InNavMesh, const FServerRecastTileGraph& InGraph, int32 MaxNodes = 4096);
+	~FServerRecastHierarchicalPathfinder();
+
+	/**
+	* Portal heuristic is weighted by 1 + Tolerance, so the abstract route costs at most that many times the best one
+	* while far fewer portals are expanded. 0 gives the shortest route through portals.
+	*/
+	void SetOptimalityTolerance(float InTolerance) { Tolerance = FMath::Max(0.f, InTolerance); }
+
+	/** points at most this many tiles apart are searched without the graph */
+	void SetFlatSearchTileDistance(int32 InTileDistance) { FlatSearchTileDistance = FMath::Max(0, InTileDistance); }
+
+	/**
+	* Writes poly corridor from StartPos to EndPos (recast coords), string-pull it with findStraightPath.
+	* @return Detour status, DT_PARTIAL_RESULT when the end wasn't reached, DT_BUFFER_TOO_SMALL when the corridor was cut at MaxPath
+	*/
+	dtStatus FindPath(const float* StartPos, const float* EndPos, const float* Extent, const dtQueryFilter& Filter,
+		dtPolyRef* OutPath, int32 MaxPath, int32& OutNumPolys, FServerRecastHierarchicalPathStats* OutStats = nullptr);
+
+	dtNavMeshQuery& GetQuery() const { return *Query; }
+
+private:
+	/** @return cost of a Detour path not longer than CostLimit, negative when there's none */
+	float GetLinkCost(dtPolyRef StartRef, dtPolyRef EndRef, const float* StartPos, const float* EndPos, const dtQueryFilter& Filter, float CostLimit) const;
+
+	/** Plain Detour search, appends to OutPath */
+	dtStatus FindFlatPath(dtPolyRef StartRef, dtPolyRef EndRef, const float* StartPos, const float* EndPos, const dtQueryFilter& Filter, float CostLimit,
+		dtPolyRef* OutPath, int32 MaxPath, int32& InOutNumPolys, float* OutCost);
+
+	/** Sizes node scratch to the current graph */
+	void ResizeNodes();
+
+	/** Fills Route with portals from start to end, @return false when the graph doesn't connect them */
+	bool SearchPortals(dtPolyRef StartRef, dtPolyRef EndRef, const float* StartPos, const float* EndPos, int32 StartTile, int32 EndTile,
+		const dtQueryFilter& Filter, FServerRecastHierarchicalPathStats& Stats);
+
+	const dtNavMesh& NavMesh;
+	const FServerRecastTileGraph& Graph;
+	dtNavMeshQuery* Query;
+	float Tolerance;
+	int32 FlatSearchTileDistance;
+
+	/** abstract search scratch, indexed by portal, start and end are the last two nodes */
+	TArray<float> NodeCost;
+	TArray<int32> NodeParent;
+	TArray<uint32> NodeVisit;
+	uint32 VisitId;
+	struct FOpenNode
+	{
+		float TotalCost;
+		float Cost;
+		int32 Node;
+
+		bool operator<(const FOpenNode& Other) const { return TotalCost < Other.TotalCost; }
+	};
+	TArray<FOpenNode> OpenList;
+	/** portals of the end tile and their cost to the end */
+	TArray<TPair<int32, float>> EndLinks;
+	/** portals of the found route, start to end */
+	TArray<int32> Route;
+};
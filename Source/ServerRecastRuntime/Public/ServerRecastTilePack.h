@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Runtime/Navmesh/Public/Detour/DetourNavMesh.h"
+
+/**
+* Navmesh tile pack (*.navpack), the server side counterpart of the .navmesh set.
+*
+* Header, then the tile index sorted by (TileY, TileX, Layer), then tile blobs aligned to SERVERRECAST_TILEPACK_ALIGNMENT.
+* Readers map the file and find any tile by binary search without touching other tiles, see FServerRecastRuntimeNavMesh.
+* Little endian, tile data is the engine's Detour layout.
+*/
+
+#define SERVERRECAST_TILEPACK_MAGIC		0x50545253	// 'SRTP'
+#define SERVERRECAST_TILEPACK_VERSION	2
+#define SERVERRECAST_TILEPACK_ALIGNMENT	16
+
+struct FServerRecastTilePackHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	/** DT_NAVMESH_VERSION of the tiles */
+	int32 DetourVersion;
+	int32 NumTiles;
+	/** whole file, truncated copies are rejected */
+	uint64 FileSize;
+	/** CRC of params, tile refs and tile data, see ServerRecastTilePack::GetPackHash */
+	uint32 PackHash;
+	dtNavMeshParams Params;
+};
+
+struct FServerRecastTilePackEntry
+{
+	/** ref the tile had when saved, reused on load so poly refs stay the same across loads */
+	uint64 TileRef;
+	uint64 DataOffset;
+	int32 DataSize;
+	int32 TileX;
+	int32 TileY;
+	int32 Layer;
+	float BMin[3];
+	float BMax[3];
+};
+
+namespace ServerRecastTilePack
+{
+	/** Writes all tiles of NavMesh, tile blobs are streamed from the navmesh without copies */
+	SERVERRECASTRUNTIME_API bool Save(const dtNavMesh& NavMesh, const FString& FileName);
+
+	/** Stored as FServerRecastTilePackHeader::PackHash, data built from a navmesh records it to be matched with the pack later */
+	SERVERRECASTRUNTIME_API uint32 GetPackHash(const dtNavMesh& NavMesh);
+
+	/** @return false when Data doesn't start with a complete pack with sorted entries pointing past the index, tile blobs are not touched */
+	SERVERRECASTRUNTIME_API bool Validate(const uint8* Data, int64 DataSize);
+}
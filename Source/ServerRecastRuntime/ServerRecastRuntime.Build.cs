@@ -0,0 +1,26 @@
+// Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class ServerRecastRuntime : ModuleRules
+{
+	public ServerRecastRuntime(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// loaded by dedicated servers, nothing but Core and Detour so it links without Engine
+		PublicDependencyModuleNames.AddRange(
+			new string[] {
+				"Core",
+				"Navmesh"
+			}
+			);
+
+		PrivateIncludePaths.AddRange(
+			new string[] {
+				"ServerRecastRuntime/Public",
+				"ServerRecastRuntime/Private",
+			}
+			);
+	}
+}